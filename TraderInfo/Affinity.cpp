@@ -0,0 +1,152 @@
+#include "Affinity.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "Constants.h"
+
+
+// Инициализация логгера
+Logger Affinity::m_log("Affinity", LoggerSettings::TYPE_LOG);
+
+
+#if defined(__linux__)
+// Разбирает список процессоров вида "0-3,8-11"
+static std::vector<unsigned int> parseCpuList(const std::string& list)
+{
+	std::vector<unsigned int> cpus;
+	std::istringstream iss(list);
+	std::string range;
+	while (std::getline(iss, range, ','))
+	{
+		size_t dash = range.find('-');
+		unsigned int first = std::stoul(range.substr(0, dash));
+		unsigned int last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+		for (unsigned int cpu = first; cpu <= last; ++cpu)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+
+	return cpus;
+}
+
+// Возвращает процессоры каждого узла NUMA
+static std::vector<std::vector<unsigned int>> getNumaNodes()
+{
+	std::vector<std::vector<unsigned int>> nodes;
+	for (unsigned int node = 0; ; ++node)
+	{
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string list;
+		if (!file || !std::getline(file, list))
+		{
+			break;
+		}
+		nodes.push_back(parseCpuList(list));
+	}
+
+	return nodes;
+}
+
+// Возвращает процессоры, доступные процессу
+static std::vector<unsigned int> getAllowedCpus()
+{
+	std::vector<unsigned int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0)
+	{
+		for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		{
+			if (CPU_ISSET(cpu, &set))
+			{
+				cpus.push_back(cpu);
+			}
+		}
+	}
+
+	return cpus;
+}
+
+// Привязывает текущий поток к набору процессоров
+static bool setAffinity(const std::vector<unsigned int>& cpus)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (unsigned int cpu : cpus)
+	{
+		CPU_SET(cpu, &set);
+	}
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#endif
+
+
+// Привязывает поток цикла с порядковым номером index
+std::string Affinity::pin(		unsigned int index, 
+								PinMode mode, 
+								const std::string& context)
+{
+	if (mode == PinMode::PIN_NONE)
+	{
+		return "not pinned";
+	}
+
+#if defined(__linux__)
+	if (mode == PinMode::PIN_NUMA)
+	{
+		std::vector<std::vector<unsigned int>> nodes = getNumaNodes();
+		if (!nodes.empty())
+		{
+			unsigned int node = index % nodes.size();
+			if (setAffinity(nodes[node]))
+			{
+				return "NUMA node " + std::to_string(node);
+			}
+		}
+		m_log.warn("Failed to pin the thread to a NUMA node, falling back to a CPU.", 
+			context, "Affinity::pin " + std::to_string(__LINE__));
+	}
+
+	std::vector<unsigned int> cpus = getAllowedCpus();
+	if (!cpus.empty())
+	{
+		unsigned int cpu = cpus[index % cpus.size()];
+		if (setAffinity({ cpu }))
+		{
+			return "CPU " + std::to_string(cpu);
+		}
+	}
+#elif defined(_WIN32)
+	if (mode == PinMode::PIN_NUMA)
+	{
+		m_log.warn("NUMA pinning is not supported on this platform, falling back to a CPU.", 
+			context, "Affinity::pin " + std::to_string(__LINE__));
+	}
+
+	unsigned int count = std::thread::hardware_concurrency();
+	unsigned int cpu = (count ? index % count : 0) % (sizeof(DWORD_PTR) * 8);
+	if (SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu))
+	{
+		return "CPU " + std::to_string(cpu);
+	}
+#endif
+
+	m_log.warn("Failed to pin the thread.", context, "Affinity::pin " + std::to_string(__LINE__));
+
+	return "not pinned";
+}
@@ -0,0 +1,25 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <string>
+
+#include "Logger.h"
+#include "Constants.h"
+
+
+// Привязка потоков циклов событий к процессорам и узлам NUMA
+class Affinity
+{
+private:
+	static Logger m_log;
+
+
+public:
+	// Привязывает текущий поток и возвращает описание привязки
+	static std::string pin(	unsigned int index, 
+							PinMode mode, 
+							const std::string& context);
+
+};
+
+#endif // !AFFINITY_H
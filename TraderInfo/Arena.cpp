@@ -0,0 +1,228 @@
+#include "Arena.h"
+
+#include <memory_resource>
+#include <streambuf>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+
+#include "ArenaSettings.h"
+#include "Metrics.h"
+
+
+// Счётчик обращений текущего потока к глобальному распределителю
+// Простой тип без конструктора, поэтому доступен из operator new без рекурсии
+// Без замены operator new (CountingNew.cpp) остаётся нулевым
+static thread_local uint64_t s_allocations = 0;
+
+
+// Учитывает память, выделенную из кучи сверх буфера арены
+class OverflowResource : public std::pmr::memory_resource
+{
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		Metrics::increment(Metrics::ARENA_OVERFLOWS);
+
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override
+	{
+		std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+// Монотонная арена над буфером потока, считает занятые байты и невозвращённые блоки
+class ScratchResource : public std::pmr::memory_resource
+{
+private:
+	alignas(std::max_align_t) std::byte		m_buffer[ArenaSettings::BUFFER_SIZE];
+	OverflowResource						m_overflow;
+	std::pmr::monotonic_buffer_resource		m_arena{ m_buffer, sizeof(m_buffer), &m_overflow };
+	size_t									m_used = 0;
+	size_t									m_live = 0;
+
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		void* pointer = m_arena.allocate(bytes, alignment);
+		m_used += bytes;
+		++m_live;
+
+		return pointer;
+	}
+
+	void do_deallocate(void* /*pointer*/, size_t /*bytes*/, size_t /*alignment*/) override
+	{
+		// Память освобождается только целиком в release
+		--m_live;
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+public:
+	bool active = false;
+
+	size_t used() const
+	{
+		return m_used;
+	}
+
+	// Возвращает арену к началу буфера, если все её блоки освобождены
+	// Иначе объект из арены пережил сообщение, и память остаётся за ним до следующего Scope
+	bool release()
+	{
+		if (m_live)
+		{
+			return false;
+		}
+
+		m_arena.release();
+		m_used = 0;
+
+		return true;
+	}
+
+	// Записывает по байту на каждую страницу буфера
+	void prefault()
+	{
+		volatile std::byte* buffer = m_buffer;
+		for (size_t offset = 0; offset < sizeof(m_buffer); offset += ArenaSettings::PAGE_SIZE)
+		{
+			buffer[offset] = std::byte{ 0 };
+		}
+	}
+};
+
+// Арена текущего потока
+static ScratchResource& threadArena()
+{
+	thread_local ScratchResource arena;
+
+	return arena;
+}
+
+
+Arena::Scope::Scope()
+{
+	ScratchResource& arena = threadArena();
+	if (!arena.active)
+	{
+		arena.active = true;
+		m_outer = true;
+		m_allocations = s_allocations;
+	}
+}
+
+Arena::Scope::~Scope()
+{
+	if (!m_outer)
+	{
+		return;
+	}
+
+	ScratchResource& arena = threadArena();
+	Metrics::observe(Metrics::ARENA_BYTES, arena.used());
+	Metrics::observe(Metrics::MESSAGE_ALLOCATIONS, s_allocations - m_allocations);
+
+	if (!arena.release())
+	{
+		Metrics::increment(Metrics::ARENA_RETAINED);
+	}
+	arena.active = false;
+}
+
+
+// Арена потока внутри обработки сообщения, иначе - обычная куча
+std::pmr::memory_resource* Arena::resource()
+{
+	ScratchResource& arena = threadArena();
+
+	return arena.active ? static_cast<std::pmr::memory_resource*>(&arena) : std::pmr::new_delete_resource();
+}
+
+// Количество обращений текущего потока к глобальному распределителю
+uint64_t Arena::allocations()
+{
+	return s_allocations;
+}
+
+// Учитывает обращение к глобальному распределителю
+void Arena::countAllocation() noexcept
+{
+	++s_allocations;
+}
+
+// Прогревает арену и шард метрик текущего потока
+void Arena::warm()
+{
+	threadArena().prefault();
+	Metrics::increment(Metrics::ARENA_OVERFLOWS, 0);
+}
+
+
+// Буфер потока вывода: копит символы в своём блоке и дописывает их в строку арены
+class ArenaStreamBuffer : public std::streambuf
+{
+private:
+	char			m_chunk[ArenaSettings::DUMP_CHUNK];
+	ArenaString*	m_output = nullptr;
+
+	void flush()
+	{
+		m_output->append(pbase(), static_cast<size_t>(pptr() - pbase()));
+		setp(m_chunk, m_chunk + sizeof(m_chunk));
+	}
+
+protected:
+	int_type overflow(int_type character) override
+	{
+		flush();
+		if (!traits_type::eq_int_type(character, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(character);
+			pbump(1);
+		}
+
+		return traits_type::not_eof(character);
+	}
+
+	int sync() override
+	{
+		flush();
+
+		return 0;
+	}
+
+public:
+	void bind(ArenaString& output)
+	{
+		m_output = &output;
+		setp(m_chunk, m_chunk + sizeof(m_chunk));
+	}
+};
+
+// Сериализует JSON в строку в арене
+ArenaString dumpToArena(const MessageJson& value)
+{
+	// Поток создаётся один раз на поток: его конструктор копирует локаль
+	thread_local ArenaStreamBuffer buffer;
+	thread_local std::ostream stream(&buffer);
+
+	ArenaString output;
+	buffer.bind(output);
+	stream << value;
+	buffer.pubsync();
+
+	return output;
+}
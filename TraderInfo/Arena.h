@@ -0,0 +1,127 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+#include <memory_resource>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+
+
+// Временная память потока для обработки одного сообщения
+// Память выделяется последовательно из буфера потока и освобождается вся сразу в конце сообщения
+// Узлы JSON и строки сообщения берутся из арены, но рабочие буферы разборщика и сериализатора nlohmann
+// используют std::allocator, поэтому несколько обращений к куче на сообщение остаются (метрика message_heap_allocations)
+class Arena
+{
+public:
+	// Границы обработки сообщения, вложенные области не сбрасывают арену
+	class Scope
+	{
+	private:
+		uint64_t	m_allocations	= 0;
+		bool		m_outer			= false;
+
+	public:
+		Scope();
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+
+	// Арена потока внутри Scope, иначе - обычная куча
+	static std::pmr::memory_resource* resource();
+
+	// Количество обращений текущего потока к глобальному распределителю
+	// Считает замена operator new из CountingNew.cpp, без неё всегда 0
+	static uint64_t allocations();
+
+	// Учитывает обращение к глобальному распределителю, вызывается заменой operator new
+	static void countAllocation() noexcept;
+
+	// Создаёт арену потока и заранее отображает страницы её буфера,
+	// чтобы первые сообщения не платили за ошибки страниц
+	static void warm();
+
+};
+
+
+// Распределитель, привязанный в момент создания к арене текущего потока внутри Scope, иначе - к куче
+// nlohmann::json создаёт распределители узлов на месте, поэтому каждый блок хранит в заголовке свой ресурс
+// и возвращается туда, откуда взят, где бы ни разрушался объект
+// Объекты из арены не должны переходить в другой поток
+template <typename T>
+class ArenaAllocator
+{
+private:
+	// Заголовок блока, сохраняет выравнивание T
+	static constexpr size_t HEADER = alignof(T) > alignof(std::max_align_t) ? alignof(T) : alignof(std::max_align_t);
+
+	std::pmr::memory_resource* m_resource;
+
+public:
+	using value_type = T;
+	using is_always_equal = std::true_type;
+
+	ArenaAllocator() noexcept : m_resource(Arena::resource())
+	{
+	}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_resource(other.resource())
+	{
+	}
+
+	// Копия контейнера размещается там, где она создаётся, а не там, где живёт оригинал
+	ArenaAllocator select_on_container_copy_construction() const noexcept
+	{
+		return ArenaAllocator();
+	}
+
+	T* allocate(size_t count)
+	{
+		std::byte* block = static_cast<std::byte*>(m_resource->allocate(HEADER + count * sizeof(T), HEADER));
+		std::memcpy(block + HEADER - sizeof(m_resource), &m_resource, sizeof(m_resource));
+
+		return reinterpret_cast<T*>(block + HEADER);
+	}
+
+	void deallocate(T* pointer, size_t count) noexcept
+	{
+		std::byte* block = reinterpret_cast<std::byte*>(pointer) - HEADER;
+		std::pmr::memory_resource* owner = nullptr;
+		std::memcpy(&owner, block + HEADER - sizeof(owner), sizeof(owner));
+
+		owner->deallocate(block, HEADER + count * sizeof(T), HEADER);
+	}
+
+	std::pmr::memory_resource* resource() const noexcept
+	{
+		return m_resource;
+	}
+
+	// Любой распределитель освобождает любой блок по его заголовку
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& /*other*/) const noexcept
+	{
+		return true;
+	}
+};
+
+
+// Строка и JSON, узлы которых размещаются в арене
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+using MessageJson = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, ArenaAllocator>;
+
+// Сериализует JSON в строку в арене
+ArenaString dumpToArena(const MessageJson& value);
+
+#endif // !ARENA_H
@@ -0,0 +1,19 @@
+#ifndef ARENASETTINGS_H
+#define ARENASETTINGS_H
+
+#include <cstddef>
+
+
+// Настройки временной памяти обработки сообщений
+namespace ArenaSettings
+{
+	// Буфер арены потока, сверх него память берётся из кучи до конца сообщения
+	const size_t		BUFFER_SIZE	(64U * 1024U);
+	// Шаг записи при прогреве буфера
+	const size_t		PAGE_SIZE	(4096U);
+	// Блок потока вывода при сериализации в арену
+	const size_t		DUMP_CHUNK	(512U);
+
+}
+
+#endif // !ARENASETTINGS_H
@@ -0,0 +1,385 @@
+#include "ChannelRegistry.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <exception>
+#include <cstdint>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "Storage.h"
+#include "ChannelSettings.h"
+#include "DaoSettings.h"
+#include "EventsConst.h"
+#include "SignalBook.h"
+#include "LoopRegistry.h"
+#include "SnapshotFile.h"
+#include "StorageWorker.h"
+#include "Arena.h"
+
+
+// Инициализация статических членов
+Logger ChannelRegistry::m_log("ChannelRegistry", LoggerSettings::TYPE_LOG);
+std::mutex ChannelRegistry::m_mtx;
+std::atomic<std::shared_ptr<const ChannelRegistry::Directory>> ChannelRegistry::m_directory;
+
+
+// Ключ хранилища канала
+static std::string channelKey(	const std::string& name, 
+								const std::string& base)
+{
+	return ChannelSettings::KEY_PREFIX + name + ChannelSettings::KEY_SEP + base;
+}
+
+
+// Канал без имени работает на прежних ключах и теме
+Channel::Channel(				uint32_t channelId, 
+								const std::string& channelName) : 
+	id(channelId), 
+	name(channelName), 
+	topic(channelName.empty() ? ServerSettings::BROADCAST : ServerSettings::BROADCAST + ChannelSettings::TOPIC_SEP + channelName), 
+	keys(channelName.empty() ? ChannelKeys{} : ChannelKeys{ channelKey(channelName, DaoSettings::SIGNALS_DB), channelKey(channelName, DaoSettings::HISTORY_DB) }), 
+	usersDb(channelName.empty() ? std::string() : channelKey(channelName, ChannelSettings::USERS_SUFFIX)), 
+	adminsDb(channelName.empty() ? std::string() : channelKey(channelName, ChannelSettings::ADMINS_SUFFIX)), 
+	book(channelId, channelName, keys.signals), 
+	members(std::make_shared<const ChannelMembers>())
+{
+}
+
+// Добавляет имя канала в сообщение
+void Channel::tag(				MessageJson& message) const
+{
+	if (!name.empty())
+	{
+		message[JsonValue::CHANNEL] = name;
+	}
+}
+
+
+// Текущий список, канал по умолчанию существует до первой загрузки
+std::shared_ptr<const ChannelRegistry::Directory> ChannelRegistry::directory()
+{
+	std::shared_ptr<const Directory> current = m_directory.load();
+	if (current)
+	{
+		return current;
+	}
+
+	std::unique_lock ul(m_mtx);
+
+	current = m_directory.load();
+	if (!current)
+	{
+		auto created = std::make_shared<Directory>();
+		created->channels.push_back(std::make_shared<Channel>(0, std::string()));
+		created->ids.emplace(std::string(), 0);
+		m_directory.store(created);
+		current = created;
+	}
+
+	return current;
+}
+
+// Имя канала попадает в ключи хранилища и темы, поэтому допускаются только латиница, цифры, '_' и '-'
+bool ChannelRegistry::validName(const std::string& name)
+{
+	if (name.empty() || name.size() > ChannelSettings::MAX_NAME_LEN)
+	{
+		return false;
+	}
+
+	for (char symbol : name)
+	{
+		bool allowed = (symbol >= 'a' && symbol <= 'z') || (symbol >= 'A' && symbol <= 'Z') || 
+			(symbol >= '0' && symbol <= '9') || symbol == '_' || symbol == '-';
+		if (!allowed)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Добавляет каналы, которых ещё нет, и возвращает новый список
+std::shared_ptr<const ChannelRegistry::Directory> ChannelRegistry::add(const std::set<std::string>& names)
+{
+	std::shared_ptr<const Directory> current = directory();
+	{
+		std::unique_lock ul(m_mtx);
+
+		current = m_directory.load();
+		std::shared_ptr<Directory> updated;
+		for (const std::string& name : names)
+		{
+			if (current->ids.count(name) || (updated && updated->ids.count(name)))
+			{
+				continue;
+			}
+			if (!validName(name))
+			{
+				m_log.warn("Invalid channel name \"" + name + "\" is skipped.", 
+					m_log.getContext(), "ChannelRegistry::add " + std::to_string(__LINE__));
+
+				continue;
+			}
+
+			if (!updated)
+			{
+				updated = std::make_shared<Directory>(*current);
+			}
+			if (updated->channels.size() >= ChannelSettings::MAX_CHANNELS)
+			{
+				m_log.error("Channel limit " + std::to_string(ChannelSettings::MAX_CHANNELS) + " is reached, the channel \"" + name + "\" is skipped.", 
+					m_log.getContext(), "ChannelRegistry::add " + std::to_string(__LINE__));
+
+				continue;
+			}
+
+			uint32_t id = static_cast<uint32_t>(updated->channels.size());
+			updated->channels.push_back(std::make_shared<Channel>(id, name));
+			updated->ids.emplace(name, id);
+
+			m_log.info("Channel \"" + name + "\" is added with the number " + std::to_string(id), 
+				m_log.getContext(), "ChannelRegistry::add " + std::to_string(__LINE__));
+		}
+
+		if (updated)
+		{
+			m_directory.store(updated);
+			current = updated;
+		}
+	}
+
+	return current;
+}
+
+// Проверяет, остались ли в новом множестве все участники прежнего
+static bool keepsAll(			const std::unordered_set<std::string>& before, 
+								const std::unordered_set<std::string>& after)
+{
+	for (const std::string& login : before)
+	{
+		if (!after.count(login))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Добавляет новые каналы из хранилища, затем перечитывает участников и книги всех каналов
+// Ошибка одного канала не мешает перечитать остальные, у сессий удалённых участников права отбираются
+void ChannelRegistry::load(		Storage& storage)
+{
+	std::set<std::string> names;
+	storage.sMembers(ChannelSettings::CHANNELS_DB, names);
+
+	std::shared_ptr<const Directory> current = add(names);
+	bool removed = false;
+	for (const auto& channel : current->channels)
+	{
+		try
+		{
+			if (!channel->name.empty())
+			{
+				auto members = std::make_shared<ChannelMembers>();
+				std::set<std::string> logins;
+				storage.sMembers(channel->usersDb, logins);
+				members->users.insert(logins.begin(), logins.end());
+				logins.clear();
+				storage.sMembers(channel->adminsDb, logins);
+				members->admins.insert(logins.begin(), logins.end());
+
+				std::shared_ptr<const ChannelMembers> previous = channel->members.exchange(members);
+				removed = removed || !keepsAll(previous->users, members->users) || !keepsAll(previous->admins, members->admins);
+			}
+
+			// Циклы получают перечитанную книгу, подписчики - пакет изменённых мимо сервера сигналов
+			channel->book.load(storage, [&channel](const std::shared_ptr<const SignalBook::Book>& book, const std::string& message)
+				{
+					LoopRegistry::publish(BookUpdate{ channel->id, book, channel->topic, message });
+				}
+			);
+		}
+		catch (const StorageError& err)
+		{
+			m_log.error("Failed to load the channel \"" + channel->name + "\": " + std::string(err.what()), 
+				m_log.getContext(), "ChannelRegistry::load " + std::to_string(__LINE__));
+		}
+	}
+
+	if (removed)
+	{
+		LoopRegistry::revokeAll();
+	}
+}
+
+// Восстанавливает каналы, участников и книги из файла снимка
+// Данные, уже загруженные из хранилища, не заменяются
+bool ChannelRegistry::restore()
+{
+	std::vector<SnapshotFile::ChannelState> states;
+	if (!SnapshotFile::read(states))
+	{
+		return false;
+	}
+
+	std::set<std::string> names;
+	for (const auto& state : states)
+	{
+		if (!state.name.empty())
+		{
+			names.insert(state.name);
+		}
+	}
+	add(names);
+
+	size_t restored = 0;
+	for (const auto& state : states)
+	{
+		std::shared_ptr<Channel> channel = find(state.name);
+		if (!channel)
+		{
+			continue;
+		}
+
+		std::shared_ptr<const ChannelMembers> current = channel->members.load();
+		if (!channel->name.empty() && current->users.empty() && current->admins.empty())
+		{
+			auto members = std::make_shared<ChannelMembers>();
+			members->users.insert(state.users.begin(), state.users.end());
+			members->admins.insert(state.admins.begin(), state.admins.end());
+			channel->members.store(members);
+		}
+
+		channel->book.restore(state.signals, state.version, [&channel](const std::shared_ptr<const SignalBook::Book>& book, const std::string& message)
+			{
+				LoopRegistry::publish(BookUpdate{ channel->id, book, channel->topic, message });
+			}
+		);
+		++restored;
+	}
+
+	m_log.info("Restored " + std::to_string(restored) + " channel(s) from the snapshot file.", 
+		m_log.getContext(), "ChannelRegistry::restore " + std::to_string(__LINE__));
+
+	return true;
+}
+
+// Ищет канал по имени
+std::shared_ptr<Channel> ChannelRegistry::find(const std::string& name)
+{
+	std::shared_ptr<const Directory> current = directory();
+	auto found = current->ids.find(name);
+
+	return found == current->ids.end() ? nullptr : current->channels[found->second];
+}
+
+// Возвращает канал по номеру
+std::shared_ptr<Channel> ChannelRegistry::get(uint32_t id)
+{
+	std::shared_ptr<const Directory> current = directory();
+
+	return id < current->channels.size() ? current->channels[id] : nullptr;
+}
+
+// Возвращает все каналы
+std::vector<std::shared_ptr<Channel>> ChannelRegistry::all()
+{
+	return directory()->channels;
+}
+
+// Ставит задачу в очередь канала, выполнение очереди запускается, если она простаивала
+// Каналы не удаляются до перезапуска, поэтому ссылка на канал в задаче StorageWorker остаётся действительной
+void ChannelRegistry::write(	Channel& channel, 
+								std::function<void()>&& task)
+{
+	{
+		std::unique_lock ul(channel.writeMtx);
+		channel.writes.push_back(std::move(task));
+		if (channel.writing)
+		{
+			return;
+		}
+		channel.writing = true;
+	}
+
+	StorageWorker::post([&channel]() { drain(channel); });
+}
+
+// Выполняет задачи очереди по одной, ошибка задачи не останавливает очередь
+void ChannelRegistry::drain(	Channel& channel)
+{
+	std::unique_lock ul(channel.writeMtx);
+	while (!channel.writes.empty())
+	{
+		std::function<void()> task = std::move(channel.writes.front());
+		channel.writes.pop_front();
+		ul.unlock();
+
+		try
+		{
+			task();
+		}
+		catch (const std::exception& ex)
+		{
+			m_log.error("Standard error in the channel \"" + channel.name + "\": " + std::string(ex.what()), 
+				m_log.getContext(), "ChannelRegistry::drain " + std::to_string(__LINE__));
+		}
+
+		ul.lock();
+	}
+	channel.writing = false;
+}
+
+// Канал по умолчанию открыт всем, администраторы всех каналов управляют каждым,
+// в остальные каналы пускают их множества пользователей и администраторов
+void ChannelRegistry::entitle(	const std::string& login, 
+								bool isAdmin, 
+								uint64_t& channels, 
+								uint64_t& adminChannels)
+{
+	channels = 0;
+	adminChannels = 0;
+
+	for (const auto& channel : directory()->channels)
+	{
+		uint64_t mask = bit(channel->id);
+		if (isAdmin)
+		{
+			channels |= mask;
+			adminChannels |= mask;
+
+			continue;
+		}
+		if (channel->name.empty())
+		{
+			channels |= mask;
+
+			continue;
+		}
+
+		std::shared_ptr<const ChannelMembers> members = channel->members.load();
+		if (members->admins.count(login))
+		{
+			channels |= mask;
+			adminChannels |= mask;
+		}
+		else if (members->users.count(login))
+		{
+			channels |= mask;
+		}
+	}
+}
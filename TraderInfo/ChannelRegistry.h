@@ -0,0 +1,120 @@
+#ifndef CHANNELREGISTRY_H
+#define CHANNELREGISTRY_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include "Logger.h"
+#include "Storage.h"
+#include "Dao.h"
+#include "SignalBook.h"
+#include "Arena.h"
+
+
+// Пользователи и администраторы канала
+struct ChannelMembers
+{
+	std::unordered_set<std::string> users;
+	std::unordered_set<std::string> admins;
+};
+
+
+// Канал сигналов: своя книга, свои ключи хранилища и своя тема рассылки
+struct Channel
+{
+	const uint32_t		id;
+	const std::string	name;		// пустое у канала по умолчанию
+	const std::string	topic;
+	const ChannelKeys	keys;
+	const std::string	usersDb;
+	const std::string	adminsDb;
+
+	SignalBook			book;
+	std::atomic<std::shared_ptr<const ChannelMembers>> members;
+
+	// Очередь записей канала: запись изменения в хранилище и его применение к книге выполняются
+	// по одной задаче в потоке StorageWorker, поэтому книга получает изменения канала в том же порядке,
+	// что и хранилище, а циклы событий не ждут Redis
+	std::mutex			writeMtx;	// только очередь и признак её выполнения
+	std::deque<std::function<void()>> writes;
+	bool				writing	= false;
+
+	Channel(			uint32_t channelId, 
+						const std::string& channelName);
+
+	// Добавляет имя канала в сообщение, у канала по умолчанию поля нет
+	void tag(			MessageJson& message) const;
+};
+
+
+// Реестр каналов сигналов процесса
+// Каналы перечислены в хранилище и только добавляются до перезапуска, поэтому номер канала постоянен
+// Список неизменяем, добавление собирает новый и атомарно подменяет старый
+class ChannelRegistry
+{
+private:
+	struct Directory
+	{
+		std::vector<std::shared_ptr<Channel>>		channels;	// по номеру канала
+		std::unordered_map<std::string, uint32_t>	ids;
+	};
+
+	static Logger									m_log;
+	static std::mutex								m_mtx;
+	static std::atomic<std::shared_ptr<const Directory>> m_directory;
+
+
+	static std::shared_ptr<const Directory> directory();
+	static bool validName(		const std::string& name);
+
+	// Добавляет каналы, которых ещё нет, и возвращает новый список
+	static std::shared_ptr<const Directory> add(const std::set<std::string>& names);
+
+	// Выполняет очередь записей канала до её опустошения
+	static void drain(			Channel& channel);
+
+
+public:
+	// Загружает список каналов, их участников и книги, вызывается при запуске и периодически
+	static void load(			Storage& storage);
+
+	// Восстанавливает каналы и книги из файла снимка, если хранилище недоступно
+	// false - целого снимка нет
+	static bool restore();
+
+	// Канал по имени или номеру, nullptr - канала нет
+	static std::shared_ptr<Channel> find(const std::string& name);
+	static std::shared_ptr<Channel> get(uint32_t id);
+
+	// Все каналы по номеру
+	static std::vector<std::shared_ptr<Channel>> all();
+
+	// Ставит задачу в очередь записей канала, вызывается из любого потока
+	// Задачи канала выполняются по одной в порядке постановки, задачи разных каналов - параллельно
+	static void write(			Channel& channel, 
+								std::function<void()>&& task);
+
+	// Права пользователя на каналы, проверяются при входе
+	// uint64_t& channels, uint64_t& adminChannels - параметры вывода
+	static void entitle(		const std::string& login, 
+								bool isAdmin, 
+								uint64_t& channels, 
+								uint64_t& adminChannels);
+
+	static uint64_t bit(		uint32_t id)
+	{
+		return uint64_t{ 1 } << id;
+	}
+
+};
+
+#endif // !CHANNELREGISTRY_H
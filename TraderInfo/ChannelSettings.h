@@ -0,0 +1,30 @@
+#ifndef CHANNELSETTINGS_H
+#define CHANNELSETTINGS_H
+
+#include <string>
+
+
+// Настройки каналов сигналов
+// Канал без имени использует прежние ключи хранилища и тему рассылки и открыт всем пользователям
+namespace ChannelSettings
+{
+	// Множество имён каналов в хранилище
+	const std::string	CHANNELS_DB		{ "channels" };
+
+	// Ключи канала: "channel:<имя>:signals", "channel:<имя>:users", ...
+	const std::string	KEY_PREFIX		{ "channel:" };
+	const std::string	KEY_SEP			{ ":" };
+	// Множества пользователей и администраторов канала, глобальные администраторы управляют всеми каналами
+	const std::string	USERS_SUFFIX	{ "users" };
+	const std::string	ADMINS_SUFFIX	{ "admins" };
+
+	// Тема рассылки канала: "broadcast:<имя>"
+	const std::string	TOPIC_SEP		{ ":" };
+
+	// Права на каналы хранятся битовыми масками в данных соединения
+	const size_t		MAX_CHANNELS	(64U);
+	const size_t		MAX_NAME_LEN	(32U);
+
+}
+
+#endif // !CHANNELSETTINGS_H
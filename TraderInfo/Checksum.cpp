@@ -0,0 +1,34 @@
+#include "Checksum.h"
+
+#include <string_view>
+#include <array>
+#include <cstdint>
+
+
+// Контрольная сумма CRC-32 (полином 0xEDB88320)
+uint32_t Checksum::crc32(std::string_view data)
+{
+	static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> result{};
+			for (uint32_t index = 0; index < result.size(); ++index)
+			{
+				uint32_t value = index;
+				for (int bit = 0; bit < 8; ++bit)
+				{
+					value = (value & 1U) ? (0xEDB88320U ^ (value >> 1)) : (value >> 1);
+				}
+				result[index] = value;
+			}
+
+			return result;
+		}();
+
+	uint32_t crc = 0xFFFFFFFFU;
+	for (char byte : data)
+	{
+		crc = table[(crc ^ static_cast<uint8_t>(byte)) & 0xFFU] ^ (crc >> 8);
+	}
+
+	return crc ^ 0xFFFFFFFFU;
+}
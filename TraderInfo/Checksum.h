@@ -0,0 +1,16 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <string_view>
+#include <cstdint>
+
+
+// Контрольные суммы файлов данных
+namespace Checksum
+{
+	// CRC-32 (полином 0xEDB88320)
+	uint32_t crc32(std::string_view data);
+
+}
+
+#endif // !CHECKSUM_H
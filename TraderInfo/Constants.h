@@ -4,16 +4,42 @@
 #include <string>
 
 
+// Режим привязки потоков к процессорам
+enum PinMode
+{
+	PIN_NONE	= 0,
+	PIN_CPU		= 1,	// поток на отдельный процессор
+	PIN_NUMA	= 2		// поток на все процессоры узла NUMA
+};
+
 struct SettingsUWS
 {
 	unsigned int port;
 	unsigned int threads;
+	bool         reusePort;
+	PinMode      pinMode;
+	unsigned int spreadReportMs;
 };
 
 namespace ServerSettings
 {
 	const unsigned int	PORT(9001);
-	const std::string	PREFIX_CHANNEL{ "user_" };
+	// Количество циклов событий, 0 - по числу аппаратных потоков
+	const unsigned int	THREADS(0);
+	const PinMode		PIN_MODE(PinMode::PIN_NONE);
+	// Период отчёта о распределении соединений по циклам, 0 - отключён
+	const unsigned int	SPREAD_REPORT_MS(60000);
+	// Предел буфера отправки соединения, сверх него uWS отбрасывает сообщения
+	const unsigned int	MAX_BACKPRESSURE(100 * 1024 * 1024);
+
+	// Разделение порта с другими процессами (SO_REUSEPORT) для перезапуска без простоя
+	// Без него порт слушает один поток, поэтому сервер работает одним циклом событий независимо от THREADS
+	const bool			REUSE_PORT(true);
+
+	// Плавная остановка
+	const unsigned int	SIGNAL_POLL_MS(100);		// период проверки сигнала остановки
+	const unsigned int	RECONNECT_SPREAD_MS(10000);	// разброс задержки переподключения клиентов
+	const int			DRAIN_GRACE_MS(2000);		// время на отправку подсказок перед закрытием
 
 }
 
@@ -0,0 +1,154 @@
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#include "Arena.h"
+
+
+// Замена глобального распределителя со счётчиком вызовов для Arena::allocations()
+// Её подключают тесты и замеры, сервер - только при сборке с TRADERINFO_COUNT_ALLOCATIONS
+void* operator new(std::size_t size)
+{
+	Arena::countAllocation();
+
+	if (size == 0)
+	{
+		size = 1;
+	}
+	while (true)
+	{
+		void* pointer = std::malloc(size);
+		if (pointer)
+		{
+			return pointer;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+		{
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void* operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return ::operator new(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+
+// Выравнивание сверх alignof(std::max_align_t): тот же счётчик, память из выровненного распределителя
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	Arena::countAllocation();
+
+	const size_t align = static_cast<size_t>(alignment);
+	// aligned_alloc требует размер, кратный выравниванию
+	size = (size == 0 ? align : (size + align - 1) & ~(align - 1));
+	while (true)
+	{
+#if defined(_WIN32)
+		void* pointer = _aligned_malloc(size, align);
+#else
+		void* pointer = std::aligned_alloc(align, size);
+#endif
+		if (pointer)
+		{
+			return pointer;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+		{
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return ::operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return ::operator new(size, alignment);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return ::operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+#if defined(_WIN32)
+	_aligned_free(pointer);
+#else
+	std::free(pointer);
+#endif
+}
+
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept
+{
+	::operator delete(pointer, alignment);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+	::operator delete(pointer, alignment);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+	::operator delete(pointer, alignment);
+}
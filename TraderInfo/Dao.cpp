@@ -1,25 +1,41 @@
 #include "Dao.h"
 
-#include <iomanip>
 #include <string>
+#include <string_view>
 #include <map>
 #include <iterator>
-#include <sstream>
 #include <algorithm>
+#include <vector>
+#include <memory>
+#include <array>
+#include <span>
+#include <random>
+#include <chrono>
 
-#include <sw/redis++/redis++.h>
 #include <argon2.h>
 
 #include "Logger.h"
 #include "TypeLog.h"
 #include "DaoSettings.h"
+#include "Metrics.h"
+#include "Storage.h"
+#include "UserDirectory.h"
+#include "Signal.h"
 
 
-//  
+// Инициализация статических членов
 Logger Dao::m_log("Dao", LoggerSettings::TYPE_LOG);
+Argon2Cost Dao::m_argon2Cost{ DaoSettings::ARGON2_T_COST, DaoSettings::ARGON2_M_COST, DaoSettings::ARGON2_PARALLELISM };
 
 
-//      Redis
+// Параметры стоимости для журнала
+static std::string costToString(const Argon2Cost& cost)
+{
+	return "t=" + std::to_string(cost.tCost) + ", m=" + std::to_string(cost.mCost) + " KiB, p=" + std::to_string(cost.parallelism);
+}
+
+
+// Проверяет есть ли позиция в Redis
 bool Dao::hCheck(				const std::string& db, 
 								const std::string& key,
 								const std::string& postfixContext)
@@ -27,10 +43,11 @@ bool Dao::hCheck(				const std::string& db,
 	m_log.info("Check the key \"" + key + "\" into db \"" + db + '"', 
 		m_context + postfixContext, "Dao::hCheck " + std::to_string(__LINE__));
 
-	return m_redis.hexists(db, key);
+	Metrics::Timer timer(Metrics::REDIS_HCHECK);
+	return m_storage.hExists(db, key);
 }
 
-//   -   -       
+// Создат пару ключ-значение в указанной хеш-тиблице и возвращает значение о создании или изменении
 bool Dao::hSet(					const std::string& db, 
 								const std::string& key, 
 								const std::string& value,
@@ -39,10 +56,11 @@ bool Dao::hSet(					const std::string& db,
 	m_log.info("Set value for key \"" + key + "\" from DB \"" + db + '"', 
 		m_context + postfixContext, "Dao::hSet " + std::to_string(__LINE__));
 
-	return m_redis.hset(db, key, value);
+	Metrics::Timer timer(Metrics::REDIS_HSET);
+	return m_storage.hSet(db, key, value);
 }
 
-//    -        
+// Удаляет из указанной хеш-талицы значение по ключу и сообщает об успешности процесса
 bool Dao::hDel(					const std::string& db, 
 								const std::string& key,
 								const std::string& postfixContext)
@@ -50,35 +68,57 @@ bool Dao::hDel(					const std::string& db,
 	m_log.info("Delete value for key \"" + key + "\" from DB \"" + db + '"', 
 		m_context + postfixContext, "Dao::hDel " + std::to_string(__LINE__));
 
-	return m_redis.hdel(db, key);
+	Metrics::Timer timer(Metrics::REDIS_HDEL);
+	return m_storage.hDel(db, key);
+}
+
+// Атомарно применяет пакет операций с хеш-таблицами
+std::vector<bool> Dao::hBatch(	const std::vector<HashOp>& ops,
+								const std::string& postfixContext)
+{
+	m_log.info("Apply a batch of " + std::to_string(ops.size()) + " operation(s)", 
+		m_context + postfixContext, "Dao::hBatch " + std::to_string(__LINE__));
+
+	Metrics::Timer timer(Metrics::REDIS_HBATCH);
+	return m_storage.hBatch(ops);
+}
+
+// Увеличивает целое значение в хеш-таблице
+long long Dao::hIncrBy(			const std::string& db, 
+								const std::string& key, 
+								long long increment,
+								const std::string& postfixContext)
+{
+	m_log.info("Increment value for key \"" + key + "\" from DB \"" + db + '"', 
+		m_context + postfixContext, "Dao::hIncrBy " + std::to_string(__LINE__));
+
+	Metrics::Timer timer(Metrics::REDIS_HINCRBY);
+	return m_storage.hIncrBy(db, key, increment);
 }
 
-//        
+// Возвращает значение из указанной БД по предоставленному ключу
 std::string Dao::hGet(			const std::string& db, 
 								const std::string& key,
 								const std::string& postfixContext)
 {
 	m_log.info("Get value for key \"" + key + "\" from DB \"" + db + '"', 
 		m_context + postfixContext, "Dao::hGet " + std::to_string(__LINE__));
-	std::string value = *m_redis.hget(db, key);
+	Metrics::Timer timer(Metrics::REDIS_HGET);
+	std::string value = m_storage.hGet(db, key).value_or("");
 
 	return (value == "") ? ConstValue::NONE : value;
 }
 
-//     -  Redis         
-// std::map<std::string, std::string>& output -  
+// Возвращает все значения из хеш-таблицы в Redis через параметры вывода и количество пар через значение возврата
+// std::map<std::string, std::string>& output - параметры вывода
 int Dao::hGetAll(				const std::string& db, 
 								std::map<std::string, 
 								std::string>& output,
 								const std::string& postfixContext)
 {
-	//      -
-	int count = m_redis.hlen(DaoSettings::SIGNALS_DB);
-	
-	if (count)
-	{
-		m_redis.hscan(DaoSettings::SIGNALS_DB, 0, std::inserter(output, output.begin()));
-	}
+	Metrics::Timer timer(Metrics::REDIS_HGETALL);
+
+	int count = static_cast<int>(m_storage.hGetAll(db, output));
 
 	m_log.info("The database \"" + db + "\" contains " + std::to_string(count) + " object(s).", 
 		m_context + postfixContext, "Dao::hGetAll " + std::to_string(__LINE__));
@@ -87,7 +127,7 @@ int Dao::hGetAll(				const std::string& db,
 }
 
 
-//     
+// Проверяет множество на наличие элемента
 bool Dao::sCheck(				const std::string& db, 
 								const std::string& value,
 								const std::string& postfixContext)
@@ -95,124 +135,391 @@ bool Dao::sCheck(				const std::string& db,
 	m_log.info("Check the value \"" + value + "\" into the Set of the db \"" + db + '"', 
 		m_context + postfixContext, "Dao::sCheck " + std::to_string(__LINE__));
 
-	return m_redis.sismember(db, value);
+	Metrics::Timer timer(Metrics::REDIS_SCHECK);
+	return m_storage.sIsMember(db, value);
 }
 
 
-//   Argon2
-std::string Dao::encodeArgon2(	const std::string& password, 
-								const std::string& saltStr,
+// Добавляет запись в поток Redis Streams и возвращает её ИН
+std::string Dao::xAdd(			const std::string& db, 
+								const Storage::Fields& fields,
+								const std::string& postfixContext)
+{
+	m_log.info("Append an entry to the stream \"" + db + '"', 
+		m_context + postfixContext, "Dao::xAdd " + std::to_string(__LINE__));
+
+	Metrics::Timer timer(Metrics::REDIS_XADD);
+	return m_storage.xAdd(db, fields);
+}
+
+// Возвращает записи потока Redis Streams в диапазоне ИН [start, end] через параметры вывода
+// std::vector<HistoryEntry>& output - параметры вывода
+void Dao::xRange(				const std::string& db, 
+								const std::string& start,
+								const std::string& end,
+								long long count,
+								std::vector<HistoryEntry>& output,
 								const std::string& postfixContext)
 {
-	//  
+	std::vector<StreamItem> items;
+	{
+		Metrics::Timer timer(Metrics::REDIS_XRANGE);
+		m_storage.xRange(db, start, end, count, items);
+	}
+
+	for (const auto& item : items)
+	{
+		HistoryEntry entry;
+		entry.id = item.id;
+		for (const auto& [field, value] : item.fields)
+		{
+			if (field == DaoSettings::FIELD_ACTION)
+			{
+				entry.action = value;
+			}
+			else if (field == DaoSettings::FIELD_TICKER)
+			{
+				entry.tickerSymbol = value;
+			}
+			else if (field == DaoSettings::FIELD_LIMITS)
+			{
+				entry.limits = value;
+			}
+			else if (field == DaoSettings::FIELD_AUTHOR)
+			{
+				entry.author = value;
+			}
+		}
+		output.push_back(std::move(entry));
+	}
+
+	m_log.info("Read " + std::to_string(items.size()) + " entries from the stream \"" + db + '"', 
+		m_context + postfixContext, "Dao::xRange " + std::to_string(__LINE__));
+}
+
+
+// Подбирает стоимость Argon2id под целевое время проверки пароля
+// Вызывается при запуске до создания потоков
+void Dao::calibrate()
+{
+	Argon2Cost cost{ DaoSettings::ARGON2_T_COST, DaoSettings::ARGON2_MIN_M_COST, DaoSettings::ARGON2_PARALLELISM };
+	const std::string password{ "calibration" };
+	std::array<uint8_t, DaoSettings::SALT_LEN> salt{};
 	uint8_t hash[DaoSettings::HASH_LEN];
 
-	//   
-	size_t saltLen = saltStr.length();
-	if (saltLen < DaoSettings::MIN_SALT_LEN)
+	auto target = std::chrono::milliseconds(DaoSettings::ARGON2_TARGET_MS);
+	std::chrono::steady_clock::duration elapsed{};
+	while (true)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int result = argon2id_hash_raw(cost.tCost, cost.mCost, cost.parallelism, 
+			password.data(), password.size(), salt.data(), salt.size(), hash, DaoSettings::HASH_LEN);
+		elapsed = std::chrono::steady_clock::now() - start;
+		if (result != ARGON2_OK)
+		{
+			m_log.error("Argon2 calibration failed: " + std::string(argon2_error_message(result)) + ", keep " + costToString(m_argon2Cost), 
+				m_log.getContext(), "Dao::calibrate " + std::to_string(__LINE__));
+
+			return;
+		}
+
+		// Сначала удваивается память, после её предела добавляются проходы
+		if (elapsed >= target)
+		{
+			break;
+		}
+		if (cost.mCost < DaoSettings::ARGON2_MAX_M_COST)
+		{
+			cost.mCost = std::min(cost.mCost * 2, DaoSettings::ARGON2_MAX_M_COST);
+		}
+		else if (cost.tCost < DaoSettings::ARGON2_MAX_T_COST)
+		{
+			++cost.tCost;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	m_argon2Cost = cost;
+	m_log.info("Argon2 calibrated to " + costToString(cost) + ", " + 
+		std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) + " ms per hash.", 
+		m_log.getContext(), "Dao::calibrate " + std::to_string(__LINE__));
+}
+
+
+// Сравнивает байты за время, не зависящее от места первого расхождения
+static bool equalConstTime(		std::span<const uint8_t> left, 
+								std::span<const uint8_t> right)
+{
+	if (left.size() != right.size())
 	{
-		//    
-		m_log.warn("The salt: \"" + saltStr + "\" is less than the permissible value.", 
-			m_context + postfixContext, "Dao::encodeArgon2 " + std::to_string(__LINE__));
+		return false;
+	}
 
-		return ConstValue::NONE;
+	// volatile не даёт компилятору завершить цикл досрочно
+	volatile uint8_t diff = 0;
+	for (size_t index = 0; index < left.size(); ++index)
+	{
+		diff = diff | (left[index] ^ right[index]);
 	}
-	uint8_t* saltBin = new uint8_t[saltLen];
-	//     
-	std::copy(saltStr.begin(), saltStr.end(), saltBin);
 
-#pragma warning(suppress : 4996)  //  VS
-	uint8_t* pwd = (uint8_t*)strdup(password.c_str());
-	uint32_t pwdlen = strlen((char*)password.c_str());
+	return diff == 0;
+}
 
-	uint32_t t_cost = 2;            // 2-pass computation
-	uint32_t m_cost = (1 << 10);    // 64 mebibytes memory usage
-	uint32_t parallelism = 1;       // number of threads and lanes
 
-	// high-level API
-	argon2i_hash_raw(t_cost, m_cost, parallelism, pwd, pwdlen, saltBin, saltLen, hash, DaoSettings::HASH_LEN);
+// Сверяет пароль с двоичным хешем Argon2, хеш вычисляется в буфер на стеке
+bool Dao::verifyArgon2(			std::string_view password, 
+								std::span<const uint8_t> salt,
+								std::span<const uint8_t, DaoSettings::HASH_LEN> expected,
+								const std::string& postfixContext)
+{
+	if (salt.size() < DaoSettings::MIN_SALT_LEN)
+	{
+		// Соль короче допустимого значения
+		m_log.warn("The salt is less than the permissible value.", 
+			m_context + postfixContext, "Dao::verifyArgon2 " + std::to_string(__LINE__));
 
-	free(pwd);
-	delete[] saltBin;
+		return false;
+	}
 
-	//    
-	std::ostringstream oss;
-	oss << std::hex;
-	for (int index = 0; index < DaoSettings::HASH_LEN; ++index)
+	uint8_t hash[DaoSettings::HASH_LEN];
+	int result = ARGON2_OK;
 	{
-		oss << std::setfill('0') << std::setw(sizeof(uint8_t) * 2) << static_cast<int>(hash[index]);
+		Metrics::Timer timer(Metrics::ARGON2_TIME);
+		result = argon2i_hash_raw(DaoSettings::LEGACY_T_COST, DaoSettings::LEGACY_M_COST, DaoSettings::LEGACY_PARALLELISM, 
+			password.data(), password.size(), salt.data(), salt.size(), hash, DaoSettings::HASH_LEN);
 	}
+	if (result != ARGON2_OK)
+	{
+		m_log.warn("Argon2 error: " + std::string(argon2_error_message(result)), 
+			m_context + postfixContext, "Dao::verifyArgon2 " + std::to_string(__LINE__));
 
-	m_log.info("The password encoded.", m_context + postfixContext, "Dao::encodeArgon2 " + std::to_string(__LINE__));
+		return false;
+	}
 
-	return oss.str();
+	return equalConstTime(hash, expected);
 }
 
+// Сверяет пароль с хешем в формате $argon2id$..., параметры и соль берутся из строки хеша
+bool Dao::verifyEncoded(		const std::string& password, 
+								const std::string& encoded,
+								const std::string& postfixContext)
+{
+	int result = ARGON2_OK;
+	{
+		Metrics::Timer timer(Metrics::ARGON2_TIME);
+		if (encoded.starts_with(DaoSettings::ARGON2ID_PREFIX))
+		{
+			result = argon2id_verify(encoded.c_str(), password.data(), password.size());
+		}
+		else
+		{
+			result = argon2i_verify(encoded.c_str(), password.data(), password.size());
+		}
+	}
 
-//     
+	if (result != ARGON2_OK && result != ARGON2_VERIFY_MISMATCH)
+	{
+		m_log.warn("Argon2 error: " + std::string(argon2_error_message(result)), 
+			m_context + postfixContext, "Dao::verifyEncoded " + std::to_string(__LINE__));
+	}
+
+	return result == ARGON2_OK;
+}
+
+
+// Проверяет правильность пары логин пароль
+// После успешной проверки хеш с устаревшими параметрами пересчитывается с текущими
 bool Dao::checkPass(			const std::string& login, 
 								const std::string& password,
 								const std::string& postfixContext)
 {
 	try
 	{
-		//      
-		if (hCheck(DaoSettings::USERS_DB, login, postfixContext))
+		bool verified = false;
+		Argon2Cost cost;
+
+		// Пользователь из справочника проверяется без обращения к хранилищу
+		std::shared_ptr<const UserRecord> user = DaoSettings::USER_DIRECTORY ? UserDirectory::find(login) : nullptr;
+		if (user)
+		{
+			verified = checkHash(password, *user, postfixContext);
+			cost = user->cost;
+		}
+		// Проверяем наличия логина в БД пользователей
+		else if (hCheck(DaoSettings::USERS_DB, login, postfixContext))
 		{
 			m_log.info("Checking the username \"" + login + "\" is successful.", 
 				m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
 
-			//        ("hash:salt")
-			std::string passSalt = hGet(DaoSettings::USERS_DB, login, postfixContext);
-			if (passSalt == ConstValue::NONE)
-			{
-				//    
-				m_log.warn("Failed get a password from DB.", m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
+			verified = checkStored(login, password, cost, postfixContext);
+		}
+		else
+		{
+			m_log.info("Invalid username \"" + login + '"', m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
+		}
 
-				return false;
-			}
+		// Сбой пересчёта не отменяет вход, rehash сам обрабатывает ошибки хранилища
+		if (verified && DaoSettings::REHASH_ON_LOGIN && cost != m_argon2Cost)
+		{
+			rehash(login, password, postfixContext);
+		}
 
-			//    
-			unsigned int delimiter = passSalt.find(':');
-			if (delimiter == std::string::npos)
-			{
-				//   ,   passSalt
-				m_log.warn("Invalid password hash and salt in DB for username \"" + login + '\"', 
-					m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
+		return verified;
+	}
+	catch (const StorageError& err)
+	{
+		m_log.error("Storage error: " + std::string(err.what()), 
+			m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
+	}
 
-				return false;
-			}
-			std::string passHash(passSalt.begin(), passSalt.begin() + delimiter);
-			std::string salt(passSalt.begin() + delimiter + 1, passSalt.end());
+	return false;
+}
 
-			//    
-			std::string testHash = encodeArgon2(password, salt, postfixContext);
-			if (testHash == ConstValue::NONE)
-			{
-				//    
-				m_log.warn("Failed encoded the password hash for username \"" + login + '\"', 
-					m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
+// Сверяет пароль с хешем пользователя из хранилища и возвращает параметры этого хеша
+bool Dao::checkStored(			const std::string& login, 
+								const std::string& password,
+								Argon2Cost& cost,
+								const std::string& postfixContext)
+{
+	// Получаем хеш пароля и соль к нему ("hash:salt" или "$argon2id$...")
+	std::string passSalt = hGet(DaoSettings::USERS_DB, login, postfixContext);
+	if (passSalt == ConstValue::NONE)
+	{
+		// Не удалось получить занчени
+		m_log.warn("Failed get a password from DB.", m_context + postfixContext, "Dao::checkStored " + std::to_string(__LINE__));
 
-				return false;
-			}
+		return false;
+	}
+
+	if (UserDirectory::isEncoded(passSalt))
+	{
+		if (!UserDirectory::parseCost(passSalt, cost))
+		{
+			m_log.warn("Invalid Argon2 parameters in DB for username \"" + login + '\"', 
+				m_context + postfixContext, "Dao::checkStored " + std::to_string(__LINE__));
 
-			return passHash == testHash;
+			return false;
 		}
-		m_log.info("Invalid username \"" + login + '"', m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
+
+		return verifyEncoded(password, passSalt, postfixContext);
 	}
-	catch (const sw::redis::Error& err)
+
+	// Выделяем хеш и соль без копирования, хеш переводим в двоичный вид
+	std::string_view stored(passSalt);
+	size_t delimiter = stored.find(':');
+	std::array<uint8_t, DaoSettings::HASH_LEN> passHash;
+	if (delimiter == std::string_view::npos || !UserDirectory::decodeHex(stored.substr(0, delimiter), passHash))
 	{
-		m_log.error("Standard Redis error: " + std::string(err.what()), 
-			m_context + postfixContext, "Dao::checkPass " + std::to_string(__LINE__));
+		// Делитель не найден или хеш повреждён, неверное значение passSalt
+		m_log.warn("Invalid password hash and salt in DB for username \"" + login + '\"', 
+			m_context + postfixContext, "Dao::checkStored " + std::to_string(__LINE__));
+
+		return false;
 	}
+	std::string_view salt = stored.substr(delimiter + 1);
+	cost = { DaoSettings::LEGACY_T_COST, DaoSettings::LEGACY_M_COST, DaoSettings::LEGACY_PARALLELISM };
 
-	return false;
+	return verifyArgon2(password, std::span(reinterpret_cast<const uint8_t*>(salt.data()), salt.size()), passHash, postfixContext);
+}
+
+// Хеширует пароль Argon2id с новой солью, строка хеша содержит параметры и соль
+int Dao::encodeArgon2(			std::string_view password, 
+								const Argon2Cost& cost,
+								std::string& encoded)
+{
+	std::array<uint8_t, DaoSettings::SALT_LEN> salt;
+	std::random_device device;
+	for (uint8_t& byte : salt)
+	{
+		byte = static_cast<uint8_t>(device());
+	}
+
+	char buffer[DaoSettings::ENCODED_LEN];
+	int result = argon2id_hash_encoded(cost.tCost, cost.mCost, cost.parallelism, 
+		password.data(), password.size(), salt.data(), salt.size(), DaoSettings::HASH_LEN, buffer, sizeof(buffer));
+	if (result == ARGON2_OK)
+	{
+		encoded = buffer;
+	}
+
+	return result;
 }
 
-//     
+// Пересчитывает хеш пароля в формате Argon2id с текущими параметрами и новой солью
+// Запись справочника этого процесса заменяется сразу, версия списка пользователей увеличивается,
+// чтобы справочники других процессов перечитали её
+bool Dao::rehash(				const std::string& login, 
+								const std::string& password,
+								const std::string& postfixContext)
+{
+	std::string encoded;
+	int result = ARGON2_OK;
+	{
+		Metrics::Timer timer(Metrics::ARGON2_TIME);
+		result = encodeArgon2(password, m_argon2Cost, encoded);
+	}
+	if (result != ARGON2_OK)
+	{
+		m_log.warn("Argon2 error: " + std::string(argon2_error_message(result)), 
+			m_context + postfixContext, "Dao::rehash " + std::to_string(__LINE__));
+
+		return false;
+	}
+
+	// Пересчёт - обслуживание: сбой записи не должен отменять успешную проверку пароля,
+	// хеш пересчитается при следующем входе
+	// Справочник обновляется только после записи хеша в хранилище
+	try
+	{
+		hSet(DaoSettings::USERS_DB, login, encoded, postfixContext);
+		if (DaoSettings::USER_DIRECTORY)
+		{
+			UserDirectory::update(login, encoded);
+		}
+		hIncrBy(DaoSettings::META_DB, DaoSettings::USERS_VERSION, 1, postfixContext);
+	}
+	catch (const StorageError& err)
+	{
+		m_log.warn("Failed to store the rehashed password of the username \"" + login + "\": " + std::string(err.what()), 
+			m_context + postfixContext, "Dao::rehash " + std::to_string(__LINE__));
+
+		return false;
+	}
+
+	m_log.info("The password of the username \"" + login + "\" is rehashed with " + costToString(m_argon2Cost), 
+		m_context + postfixContext, "Dao::rehash " + std::to_string(__LINE__));
+
+	return true;
+}
+
+// Сверяет пароль с записью справочника
+bool Dao::checkHash(			const std::string& password, 
+								const UserRecord& user,
+								const std::string& postfixContext)
+{
+	if (!user.encoded.empty())
+	{
+		return verifyEncoded(password, user.encoded, postfixContext);
+	}
+
+	return verifyArgon2(password, user.salt, user.hash, postfixContext);
+}
+
+// Проверка статуса админа для пользователя
 bool Dao::checkAdminStatus(		const std::string& login,
 								const std::string& postfixContext)
 {
+	if (DaoSettings::USER_DIRECTORY)
+	{
+		if (std::shared_ptr<const UserRecord> user = UserDirectory::find(login))
+		{
+			return user->isAdmin;
+		}
+	}
+
 	bool status = sCheck(DaoSettings::ADMINS_DB, login, postfixContext);
 	m_log.info("The admin status of the username \"" + login + "\" is " + (status ? "true" : "false"), 
 		m_context + postfixContext, "Dao::checkAdminStatus " + std::to_string(__LINE__));
@@ -220,14 +527,16 @@ bool Dao::checkAdminStatus(		const std::string& login,
 	return status;
 }
 
-//    
-bool Dao::setSignal(			const std::string& tickerSybmol, 
+// Создаёт сигнал в БД
+bool Dao::setSignal(			const ChannelKeys& keys,
+								const std::string& tickerSybmol, 
+								const Signal& signal,
 								const std::string& limits,
 								const std::string& postfixContext)
 {
 	try
 	{
-		if (hSet(DaoSettings::SIGNALS_DB, tickerSybmol, limits, postfixContext))
+		if (hSet(keys.signals, tickerSybmol, SignalCodec::encode(signal, limits), postfixContext))
 		{
 			m_log.info("Created the new signal for the ticker \"" + tickerSybmol + '"', 
 				m_context + postfixContext, "Dao::setSignal " + std::to_string(__LINE__));
@@ -240,22 +549,23 @@ bool Dao::setSignal(			const std::string& tickerSybmol,
 
 		return true;
 	}
-	catch (const sw::redis::Error& err)
+	catch (const StorageError& err)
 	{
-		m_log.error("Standard Redis error: " + std::string(err.what()), 
+		m_log.error("Storage error: " + std::string(err.what()), 
 			m_context + postfixContext, "Dao::setSignal " + std::to_string(__LINE__));
 	}
 
 	return false;
 }
 
-//    
-bool Dao::delSignal(			const std::string& tickerSymbol,
+// Удаляет сигнал из БД
+bool Dao::delSignal(			const ChannelKeys& keys,
+								const std::string& tickerSymbol,
 								const std::string& postfixContext)
 {
 	try
 	{
-		if (hDel(DaoSettings::SIGNALS_DB, tickerSymbol, postfixContext))
+		if (hDel(keys.signals, tickerSymbol, postfixContext))
 		{
 			m_log.info("The signal with the ticker \"" + tickerSymbol + "\" is removed.", 
 				m_context + postfixContext, "Dao::setSignal " + std::to_string(__LINE__));
@@ -268,63 +578,179 @@ bool Dao::delSignal(			const std::string& tickerSymbol,
 				m_context + postfixContext, "Dao::setSignal " + std::to_string(__LINE__));
 		}
 	}
-	catch (const sw::redis::Error& err)
+	catch (const StorageError& err)
 	{
-		m_log.error("Standard Redis error: " + std::string(err.what()), 
+		m_log.error("Storage error: " + std::string(err.what()), 
 			m_context + postfixContext, "Dao::setSignal " + std::to_string(__LINE__));
 	}
 
 	return false;
 }
 
-//    
-std::string Dao::getSignal(		const std::string& tickerSymbol,
+// Создаёт и удаляет сигналы одной транзакцией
+// Результат каждого изменения возвращается через параметр вывода, добавление успешно всегда,
+// удаление - если сигнал был
+// std::vector<bool>& results - параметры вывода
+bool Dao::applySignals(			const ChannelKeys& keys,
+								const std::vector<SignalChange>& changes,
+								const std::string& author,
+								std::vector<bool>& results,
+								const std::string& postfixContext)
+{
+	results.assign(changes.size(), false);
+	if (changes.empty())
+	{
+		return true;
+	}
+
+	try
+	{
+		std::vector<HashOp> ops;
+		ops.reserve(changes.size());
+		for (const SignalChange& change : changes)
+		{
+			ops.push_back({ change.remove ? HashOpType::HASH_DEL : HashOpType::HASH_SET, keys.signals, change.tickerSymbol, 
+				change.remove ? std::string() : SignalCodec::encode(change.signal, change.limits) });
+		}
+
+		std::vector<bool> applied = hBatch(ops, postfixContext);
+		for (size_t index = 0; index < changes.size() && index < applied.size(); ++index)
+		{
+			results[index] = !changes[index].remove || applied[index];
+		}
+	}
+	catch (const StorageError& err)
+	{
+		m_log.error("Storage error: " + std::string(err.what()), 
+			m_context + postfixContext, "Dao::applySignals " + std::to_string(__LINE__));
+
+		return false;
+	}
+
+	// Журнал изменений пишется после транзакции, его сбой не отменяет изменения
+	size_t count = 0;
+	for (size_t index = 0; index < changes.size(); ++index)
+	{
+		if (results[index])
+		{
+			addHistory(keys, changes[index].action, changes[index].tickerSymbol, changes[index].limits, author, postfixContext);
+			++count;
+		}
+	}
+
+	m_log.info("Applied " + std::to_string(count) + " of " + std::to_string(changes.size()) + " signal change(s).", 
+		m_context + postfixContext, "Dao::applySignals " + std::to_string(__LINE__));
+
+	return true;
+}
+
+// Возвращает информацию о сигнале
+std::string Dao::getSignal(		const ChannelKeys& keys,
+								const std::string& tickerSymbol,
 								const std::string& postfixContext)
 {
 	std::string result{ ConstValue::NONE };
 	try
 	{
-		//     
-		if (hCheck(DaoSettings::SIGNALS_DB, tickerSymbol, postfixContext))
+		// Проверяем наличия сигнала в БД
+		if (hCheck(keys.signals, tickerSymbol, postfixContext))
 		{
 			m_log.info("Checking the ticker symbol \"" + tickerSymbol + "\" is successful.", 
 				m_context + postfixContext, "Dao::getSignal " + std::to_string(__LINE__));
 
-			//   
-			result = hGet(DaoSettings::SIGNALS_DB, tickerSymbol, postfixContext);
+			// Получаем значение сигнала
+			result = hGet(keys.signals, tickerSymbol, postfixContext);
 		}
 		else
 		{
-			//     
+			// Тикер в БД не найден
 			m_log.info("Invalid ticker symbol \"" + tickerSymbol + '"', 
 				m_context + postfixContext, "Dao::getSignal " + std::to_string(__LINE__));
 		}
 	}
-	catch (const sw::redis::Error& err)
+	catch (const StorageError& err)
 	{
-		m_log.error("Standard Redis error: " + std::string(err.what()), 
+		m_log.error("Storage error: " + std::string(err.what()), 
 			m_context + postfixContext, "Dao::getSignal " + std::to_string(__LINE__));
 	}
 
 	return result;
 }
 
-//             
-// std::map<std::string, std::string>& signals -  
-int Dao::getAllSignals(			std::map<std::string, std::string>& signals,
+// Возвращает список всех сигналов через параметр вывода и количество сигналов через возвращаемое значение
+// std::map<std::string, std::string>& signals - параметры вывода
+int Dao::getAllSignals(			const ChannelKeys& keys,
+								std::map<std::string, std::string>& signals,
 								const std::string& postfixContext)
 {
 	m_log.info("Get all keys and values of signals",  m_context + postfixContext, "Dao::getAllSignals " + std::to_string(__LINE__));
 
 	try
 	{
-		return hGetAll(DaoSettings::SIGNALS_DB, signals, postfixContext);
+		return hGetAll(keys.signals, signals, postfixContext);
 	}
-	catch (const sw::redis::Error& err)
+	catch (const StorageError& err)
 	{
-		m_log.error("Standard Redis error: " + std::string(err.what()), 
+		m_log.error("Storage error: " + std::string(err.what()), 
 			m_context + postfixContext, "Dao::getAllSignals " + std::to_string(__LINE__));
 	}
 
 	return 0;
 }
+
+// Записывает изменение сигнала в общий журнал и в журнал тикера
+bool Dao::addHistory(			const ChannelKeys& keys,
+								const std::string& action,
+								const std::string& tickerSymbol, 
+								const std::string& limits,
+								const std::string& author,
+								const std::string& postfixContext)
+{
+	try
+	{
+		Storage::Fields fields{
+			{ DaoSettings::FIELD_ACTION, action },
+			{ DaoSettings::FIELD_TICKER, tickerSymbol },
+			{ DaoSettings::FIELD_LIMITS, limits },
+			{ DaoSettings::FIELD_AUTHOR, author } };
+
+		xAdd(keys.history, fields, postfixContext);
+		xAdd(keys.history + DaoSettings::HISTORY_SEP + tickerSymbol, fields, postfixContext);
+
+		return true;
+	}
+	catch (const StorageError& err)
+	{
+		m_log.error("Storage error: " + std::string(err.what()), 
+			m_context + postfixContext, "Dao::addHistory " + std::to_string(__LINE__));
+	}
+
+	return false;
+}
+
+// Возвращает не более count записей журнала в диапазоне ИН [start, end]
+// Пустой тикер означает общий журнал
+// std::vector<HistoryEntry>& entries - параметры вывода
+bool Dao::getHistory(			const ChannelKeys& keys,
+								const std::string& tickerSymbol,
+								const std::string& start,
+								const std::string& end,
+								long long count,
+								std::vector<HistoryEntry>& entries,
+								const std::string& postfixContext)
+{
+	try
+	{
+		std::string db = tickerSymbol.empty() ? keys.history : keys.history + DaoSettings::HISTORY_SEP + tickerSymbol;
+		xRange(db, start, end, count, entries, postfixContext);
+
+		return true;
+	}
+	catch (const StorageError& err)
+	{
+		m_log.error("Storage error: " + std::string(err.what()), 
+			m_context + postfixContext, "Dao::getHistory " + std::to_string(__LINE__));
+	}
+
+	return false;
+}
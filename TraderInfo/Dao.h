@@ -3,19 +3,57 @@
 
 #include <string>
 #include <map>
-
-#include <sw/redis++/redis++.h>
+#include <vector>
+#include <string_view>
+#include <span>
+#include <cstdint>
 
 #include "Logger.h"
+#include "Storage.h"
+#include "UserDirectory.h"
+#include "DaoSettings.h"
+#include "Signal.h"
+
+
+// Запись журнала изменений сигналов
+struct HistoryEntry
+{
+	std::string id;				// ИН записи Redis Streams ("время_мс-номер")
+	std::string action;
+	std::string tickerSymbol;
+	std::string limits;
+	std::string author;
+};
+
 
+// Изменение сигнала в пакете
+struct SignalChange
+{
+	std::string action;			// команда для журнала изменений
+	std::string tickerSymbol;
+	std::string limits;			// пустые при удалении
+	Signal		signal;
+	bool		remove = false;
+};
+
+
+// Ключи хранилища канала сигналов, по умолчанию - ключи канала без имени
+struct ChannelKeys
+{
+	std::string signals	= DaoSettings::SIGNALS_DB;	// хеш сигналов
+	std::string history	= DaoSettings::HISTORY_DB;	// журнал изменений, общий и префикс журналов тикеров
+};
 
-// Data Access Object -       Redis
+
+// Data Access Object - Объект доступа к данным в хранилище
 class Dao
 {
 private:
 	static Logger		m_log;
+	// Параметры новых хешей, меняются только при запуске до приёма соединений
+	static Argon2Cost	m_argon2Cost;
 
-	sw::redis::Redis	m_redis;
+	Storage&			m_storage;
 	std::string			m_context;
 
 
@@ -36,6 +74,14 @@ private:
 							const std::string& key,
 							const std::string& postfixContext);
 	
+	std::vector<bool> hBatch(const std::vector<HashOp>& ops,
+							const std::string& postfixContext);
+	
+	long long hIncrBy(		const std::string& db, 
+							const std::string& key,
+							long long increment,
+							const std::string& postfixContext);
+	
 	int hGetAll(			const std::string& db, 
 							std::map<std::string, 
 							std::string>& output,
@@ -45,21 +91,65 @@ private:
 							const std::string& value,
 							const std::string& postfixContext);
 	
-	std::string encodeArgon2(const std::string& password, 
-							const std::string& saltStr,
+	std::string xAdd(		const std::string& db, 
+							const Storage::Fields& fields,
+							const std::string& postfixContext);
+	
+	void xRange(			const std::string& db, 
+							const std::string& start,
+							const std::string& end,
+							long long count,
+							std::vector<HistoryEntry>& output,
+							const std::string& postfixContext);
+	
+	bool verifyArgon2(		std::string_view password, 
+							std::span<const uint8_t> salt,
+							std::span<const uint8_t, DaoSettings::HASH_LEN> expected,
+							const std::string& postfixContext);
+
+	bool verifyEncoded(		const std::string& password, 
+							const std::string& encoded,
+							const std::string& postfixContext);
+
+	bool checkStored(		const std::string& login, 
+							const std::string& password,
+							Argon2Cost& cost,
+							const std::string& postfixContext);
+
+	bool rehash(			const std::string& login, 
+							const std::string& password,
+							const std::string& postfixContext);
+
+	bool checkHash(			const std::string& password, 
+							const UserRecord& user,
 							const std::string& postfixContext);
 
 
 public:
-	Dao(const std::string& redisSocket) try : m_redis(sw::redis::Redis(redisSocket))
+	Dao() try : m_storage(Storage::instance())
 	{
 		m_context = m_log.getContext() + " ";
 	}
-	catch (const sw::redis::Error& err)
+	catch (const StorageError& err)
 	{
-		m_log.crit("Standard Redis error: " + std::string(err.what()), m_log.getContext(), "Dao_constructor h" + std::to_string(__LINE__));
+		m_log.crit("Storage error: " + std::string(err.what()), m_log.getContext(), "Dao_constructor h" + std::to_string(__LINE__));
 	}
 
+	// Работа с заданным хранилищем
+	explicit Dao(Storage& storage) : m_storage(storage)
+	{
+		m_context = m_log.getContext() + " ";
+	}
+
+
+	static void calibrate();
+
+	// Хеширует пароль Argon2id с параметрами cost и новой случайной солью в строку $argon2id$...
+	// Возвращает код результата argon2
+	static int encodeArgon2(std::string_view password, 
+							const Argon2Cost& cost,
+							std::string& encoded);
+
 
 	bool checkPass(			const std::string& login, 
 							const std::string& password,
@@ -68,17 +158,43 @@ public:
 	bool checkAdminStatus(	const std::string& login,
 							const std::string& postfixContext);
 	
-	bool setSignal(			const std::string& tickerSymbol, 
+	bool setSignal(			const ChannelKeys& keys,
+							const std::string& tickerSymbol, 
+							const Signal& signal,
 							const std::string& limits,
 							const std::string& postfixContext);
 	
-	bool delSignal(			const std::string& tickerSymbol,
+	bool delSignal(			const ChannelKeys& keys,
+							const std::string& tickerSymbol,
+							const std::string& postfixContext);
+	
+	bool applySignals(		const ChannelKeys& keys,
+							const std::vector<SignalChange>& changes,
+							const std::string& author,
+							std::vector<bool>& results,
 							const std::string& postfixContext);
 	
-	std::string getSignal(	const std::string& tickerSymbol,
+	std::string getSignal(	const ChannelKeys& keys,
+							const std::string& tickerSymbol,
+							const std::string& postfixContext);
+	
+	int getAllSignals(		const ChannelKeys& keys,
+							std::map<std::string, std::string>& signals,
+							const std::string& postfixContext);
+	
+	bool addHistory(		const ChannelKeys& keys,
+							const std::string& action,
+							const std::string& tickerSymbol, 
+							const std::string& limits,
+							const std::string& author,
 							const std::string& postfixContext);
 	
-	int getAllSignals(		std::map<std::string, std::string>& signals,
+	bool getHistory(		const ChannelKeys& keys,
+							const std::string& tickerSymbol,
+							const std::string& start,
+							const std::string& end,
+							long long count,
+							std::vector<HistoryEntry>& entries,
 							const std::string& postfixContext);
 
 };
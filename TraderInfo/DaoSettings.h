@@ -2,17 +2,96 @@
 #define DAOSETTINGS_H
 
 #include <string>
+#include <cstdint>
 
 
+// Хранилище данных
+enum StorageType
+{
+	STORAGE_REDIS	= 0,	// сервер Redis
+	STORAGE_LOCAL	= 1		// встроенное хранилище процесса
+};
+
 namespace DaoSettings 
 {
+	const StorageType	STORAGE		(StorageType::STORAGE_REDIS);
+
+	const std::string	REDIS_SOCKET{ "tcp://127.0.0.1:6379" };
+	// Размер пула соединений с Redis, 0 - по числу аппаратных потоков
+	const size_t		POOL_SIZE	(0U);
+	// Ожидание подключения и ответа Redis, по истечении Redis считается недоступным
+	const unsigned int	REDIS_CONNECT_TIMEOUT_MS(500U);
+	const unsigned int	REDIS_SOCKET_TIMEOUT_MS(1000U);
+
+	// Встроенное хранилище
+	const std::string	LOCAL_DIR	{ "../data" };
+	const std::string	LOCAL_FILE	{ "storage.log" };
+	// Заполнить пустое встроенное хранилище данными из Redis
+	const bool			LOCAL_SEED_FROM_REDIS(true);
+	// Журнал сжимается, когда записей больше COMPACT_FACTOR * живых и больше COMPACT_MIN
+	const size_t		COMPACT_MIN	(1024U);
+	const size_t		COMPACT_FACTOR(2U);
+	// Период проверки размера журнала главным потоком
+	const unsigned int	COMPACT_CHECK_MS(1000U);
+
 	const std::string	USERS_DB	{ "users" };
 	const std::string	ADMINS_DB	{ "admins" };
 	const std::string	SIGNALS_DB	{ "signals" };
+	// Журнал изменений сигналов (Redis Streams), общий и по каждому тикеру
+	const std::string	HISTORY_DB	{ "signals_history" };
+	const std::string	HISTORY_SEP	{ ":" };
+	// Приблизительная длина журнала: при добавлении старые записи удаляются (XADD MAXLEN ~)
+	const long long		HISTORY_MAXLEN(100000);
+	// Потоки чтения журнала и очередей записей каналов вне циклов событий
+	const unsigned int	STORAGE_WORKERS(2U);
+
+	// Поля записи журнала
+	const std::string	FIELD_ACTION{ "action" };
+	const std::string	FIELD_TICKER{ "tickerSymbol" };
+	const std::string	FIELD_LIMITS{ "limits" };
+	const std::string	FIELD_AUTHOR{ "author" };
 
 	const size_t		HASH_LEN	(32U);
 	const size_t		MIN_SALT_LEN(8U);
 
+	// Параметры Argon2i для хешей в формате "hash:salt"
+	const uint32_t		LEGACY_T_COST		(2U);		// 2-pass computation
+	const uint32_t		LEGACY_M_COST		(1U << 10);	// 1 mebibyte memory usage
+	const uint32_t		LEGACY_PARALLELISM	(1U);		// number of threads and lanes
+
+	// Параметры Argon2id для новых хешей, у каждого пользователя они хранятся в строке хеша
+	const uint32_t		ARGON2_T_COST		(2U);		// 2-pass computation
+	const uint32_t		ARGON2_M_COST		(19U << 10);// 19 mebibytes memory usage
+	const uint32_t		ARGON2_PARALLELISM	(1U);		// number of threads and lanes
+	const size_t		SALT_LEN			(16U);
+	const size_t		ENCODED_LEN			(128U);		// буфер строки хеша
+	// Перехешировать пароль при входе, если параметры пользователя отличаются от текущих
+	const bool			REHASH_ON_LOGIN		(true);
+
+	// Подбор стоимости при запуске: память удваивается, затем добавляются проходы,
+	// пока проверка пароля не займёт ARGON2_TARGET_MS
+	const bool			ARGON2_CALIBRATE	(false);
+	const unsigned int	ARGON2_TARGET_MS	(50U);
+	const uint32_t		ARGON2_MIN_M_COST	(1U << 12);	// 4 mebibytes
+	const uint32_t		ARGON2_MAX_M_COST	(1U << 18);	// 256 mebibytes
+	const uint32_t		ARGON2_MAX_T_COST	(10U);
+	// Префиксы хеша в формате строки Argon2, параметры и соль хранятся в самой строке
+	const std::string	ARGON2ID_PREFIX		{ "$argon2id$" };
+	const std::string	ARGON2I_PREFIX		{ "$argon2i$" };
+
+	// Справочник пользователей в памяти
+	const bool			USER_DIRECTORY	(true);
+	// Версия списка пользователей, администрирование увеличивает её при каждом изменении
+	const std::string	META_DB			{ "meta" };
+	const std::string	USERS_VERSION	{ "users_version" };
+	// Период проверки версии и возраст, после которого справочник перечитывается без смены версии
+	// Удаление пользователя в обход администрирования, не увеличившее версию, действует не позже USERS_MAX_AGE_MS
+	const unsigned int	USERS_REFRESH_MS(1000U);
+	const unsigned int	USERS_MAX_AGE_MS(60000U);
+	// Справочник, который не удалось перечитать за этот срок, не используется: вход проверяется по хранилищу,
+	// а без него отклоняется, чтобы отозванный пользователь не входил по устаревшей копии
+	const unsigned int	USERS_STALE_MS(120000U);
+
 }
 
 #endif // !DAOSETTINGS_H
@@ -0,0 +1,178 @@
+#include "Dispatcher.h"
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
+
+#include <uwebsockets/App.h>
+#include <nlohmann/json.hpp>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "EventsConst.h"
+#include "PerSocketData.h"
+#include "Events.h"
+#include "Arena.h"
+#include "Transport.h"
+
+
+// Инициализация логгера
+template <typename Socket>
+Logger Dispatcher<Socket>::m_log("Dispatcher", LoggerSettings::TYPE_LOG);
+
+
+// Таблица команд, имена совпадают со значениями JsonValue
+template <typename Socket>
+static constexpr CommandInfo<Socket> s_commands[] =
+{
+	{ "authorization",	Permission::PERM_GUEST,	&Events<Socket>::authorization },
+	{ "add",			Permission::PERM_PUBLISHER,	&Events<Socket>::signalize },
+	{ "delete",			Permission::PERM_PUBLISHER,	&Events<Socket>::signalize },
+	{ "batch",			Permission::PERM_PUBLISHER,	&Events<Socket>::batch },
+	{ "history",		Permission::PERM_USER,	&Events<Socket>::history },
+	{ "message",		Permission::PERM_ADMIN,	&Events<Socket>::directMessage },
+	{ "logout",			Permission::PERM_ADMIN,	&Events<Socket>::logout }
+};
+
+// Имена и порядок команд не зависят от типа сокета, хеш строится по таблице сервера
+static constexpr const auto& s_names = s_commands<ServerSocket>;
+static constexpr size_t COMMANDS = std::size(s_names);
+// Размер таблицы - степень двойки не меньше удвоенного числа команд
+static constexpr size_t SLOTS = 32;
+static_assert(SLOTS >= COMMANDS * 2 && (SLOTS & (SLOTS - 1)) == 0);
+
+// FNV-1a с начальным значением, смешанным с затравкой
+static constexpr uint32_t hashName(std::string_view name, uint32_t seed)
+{
+	uint32_t hash = 2166136261U ^ seed;
+	for (char symbol : name)
+	{
+		hash ^= static_cast<uint8_t>(symbol);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+// Подбирает затравку, при которой все команды попадают в разные ячейки
+static constexpr uint32_t findSeed()
+{
+	for (uint32_t seed = 0; seed < 1000000; ++seed)
+	{
+		std::array<bool, SLOTS> used{};
+		bool collision = false;
+		for (const auto& command : s_names)
+		{
+			size_t slot = hashName(command.name, seed) & (SLOTS - 1);
+			if (used[slot])
+			{
+				collision = true;
+				break;
+			}
+			used[slot] = true;
+		}
+
+		if (!collision)
+		{
+			return seed;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+static constexpr uint32_t SEED = findSeed();
+static_assert(SEED != UINT32_MAX, "No perfect hash seed for the command table");
+
+// Номер команды в таблице для каждой ячейки, -1 - пустая ячейка
+static constexpr std::array<int, SLOTS> buildSlots()
+{
+	std::array<int, SLOTS> slots{};
+	slots.fill(-1);
+	for (size_t index = 0; index < COMMANDS; ++index)
+	{
+		slots[hashName(s_names[index].name, SEED) & (SLOTS - 1)] = static_cast<int>(index);
+	}
+
+	return slots;
+}
+
+static constexpr std::array<int, SLOTS> s_slots = buildSlots();
+
+
+// Ищет команду по имени
+template <typename Socket>
+const CommandInfo<Socket>* Dispatcher<Socket>::find(std::string_view name)
+{
+	int index = s_slots[hashName(name, SEED) & (SLOTS - 1)];
+	if (index < 0 || s_commands<Socket>[index].name != name)
+	{
+		return nullptr;
+	}
+
+	return &s_commands<Socket>[index];
+}
+
+// Проверяет, хватает ли пользователю прав на команду
+template <typename Socket>
+bool Dispatcher<Socket>::allowed(	const PerSocketData* data, 
+									Permission permission)
+{
+	switch (permission)
+	{
+	case Permission::PERM_GUEST:
+		return !data->auth;
+	case Permission::PERM_USER:
+		return data->auth;
+	case Permission::PERM_ADMIN:
+		return data->auth && data->isAdmin;
+	case Permission::PERM_PUBLISHER:
+		return data->auth && data->adminChannels;
+	default:
+		return false;
+	}
+}
+
+
+// Разбирает сообщение и передаёт его обработчику команды
+template <typename Socket>
+void Dispatcher<Socket>::dispatch(	Socket* ws, 
+									std::string_view message,
+									const std::string& postfixContext,
+									Events<Socket>& events)
+{
+	PerSocketData* data = ws->getUserData();
+
+	// Разбор в арене потока, память освобождается в конце сообщения
+	MessageJson parsed = MessageJson::parse(message);
+	auto command = parsed.find(JsonValue::COMMAND);
+	const CommandInfo<Socket>* info = (command != parsed.end() && command->is_string()) ? 
+		find(command->get_ref<const std::string&>()) : nullptr;
+
+	if (info && allowed(data, info->permission))
+	{
+		(events.*(info->handler))(ws, parsed, postfixContext);
+
+		return;
+	}
+
+	// Команда неизвестна или не разрешена
+	if (!data->auth)
+	{
+		m_log.info("The user is not authorized", m_log.getContext() + " " + postfixContext, "Dispatcher::dispatch " + std::to_string(__LINE__));
+	}
+	else if (data->adminChannels)
+	{
+		events.unknownCommand(ws, parsed, postfixContext);
+	}
+	else
+	{
+		m_log.info("The user does not have the right to publish signals.", 
+			m_log.getContext() + " " + postfixContext, "Dispatcher::dispatch " + std::to_string(__LINE__));
+	}
+}
+
+
+// Инстанцируется только для сокета сервера
+template class Dispatcher<ServerSocket>;
@@ -0,0 +1,61 @@
+#ifndef DISPATCHER_H
+#define DISPATCHER_H
+
+#include <string>
+#include <string_view>
+
+#include <uwebsockets/App.h>
+#include <nlohmann/json.hpp>
+
+#include "Logger.h"
+#include "PerSocketData.h"
+#include "Events.h"
+#include "Arena.h"
+
+
+// Права, необходимые для выполнения команды
+enum Permission
+{
+	PERM_GUEST		= 0,	// только до авторизации
+	PERM_USER		= 1,	// любой авторизованный пользователь
+	PERM_ADMIN		= 2,	// администратор всех каналов
+	PERM_PUBLISHER	= 3		// администратор хотя бы одного канала, канал команды проверяет обработчик
+};
+
+// Описание команды протокола
+template <typename Socket>
+struct CommandInfo
+{
+	std::string_view	name;
+	Permission			permission;
+	void (Events<Socket>::*handler)(Socket*, const MessageJson&, const std::string&);
+};
+
+
+// Диспетчер команд
+// Имя команды ищется по совершенной хеш-функции, построенной при компиляции,
+// поэтому поиск стоит одного хеширования и одного сравнения строк
+template <typename Socket>
+class Dispatcher
+{
+private:
+	static Logger m_log;
+
+
+	static bool allowed(		const PerSocketData* data, 
+								Permission permission);
+
+
+public:
+	// Возвращает описание команды или nullptr для неизвестной команды
+	static const CommandInfo<Socket>* find(std::string_view name);
+
+	// Команду выполняет обработчик текущего потока или заданный, например в тестах
+	static void dispatch(		Socket* ws, 
+								std::string_view message,
+								const std::string& postfixContext,
+								Events<Socket>& events = Events<Socket>::local());
+
+};
+
+#endif // !DISPATCHER_H
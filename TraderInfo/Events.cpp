@@ -6,6 +6,12 @@
 #include <mutex>
 #include <random>
 #include <memory>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <charconv>
 
 #include <uwebsockets/App.h>
 #include <nlohmann/json.hpp>
@@ -16,17 +22,43 @@
 #include "EventsConst.h"
 #include "PerSocketData.h"
 #include "Dao.h"
+#include "Metrics.h"
+#include "RateLimiter.h"
+#include "LoopRegistry.h"
+#include "SessionRegistry.h"
+#include "Signal.h"
+#include "SignalBook.h"
+#include "ChannelRegistry.h"
+#include "Arena.h"
+#include "Trace.h"
+#include "Transport.h"
+#include "StorageWorker.h"
+
+
+// Мютекс для формирования uuid
+std::mutex mtxUuid;
 
+// Заранее сформированный ответ на превышение лимита авторизаций
+static const std::string s_rateLimited{ nlohmann::json{ { JsonValue::AUTH, JsonValue::RATE_LIMITED } }.dump() };
 
-//    uuid
-std::mutex mtxUuid;
+// Инициализация логгера
+template <typename Socket>
+Logger Events<Socket>::m_log("Events", LoggerSettings::TYPE_LOG);
+
+
+// Возвращает обработчик событий текущего потока, контекст логгера формируется один раз
+template <typename Socket>
+Events<Socket>& Events<Socket>::local()
+{
+    thread_local Events events;
 
-//  
-Logger Events::m_log("Events", LoggerSettings::TYPE_LOG);
+    return events;
+}
 
 
-//   
-std::mt19937 Events::getMT()
+// Инициализация Вихря Мерсенна
+template <typename Socket>
+std::mt19937 Events<Socket>::getMT()
 {
     std::random_device rd;
     auto seed_data = std::array<int, std::mt19937::state_size> {};
@@ -37,38 +69,40 @@ std::mt19937 Events::getMT()
     return generator;
 }
 
-//  uuid v4
-std::string Events::uuid()
+// Возвращает uuid v4
+template <typename Socket>
+std::string Events<Socket>::uuid()
 {
 	std::unique_lock ul(mtxUuid);
 
-    //  
+    // Инициализация генератора
     static std::mt19937 mTwister(getMT());
     static uuids::uuid_random_generator gen{ mTwister };
 
-    //  uuid
+    // Генерируем uuid
     uuids::uuid uuidValue = gen();
 
     return uuids::to_string(uuidValue);
 }
 
-//        
-std::unique_ptr<UserInfo> Events::checkUser(const std::string& login, 
+// Проводит аутентификацию пользователя и возвращает информацию о нём
+template <typename Socket>
+std::unique_ptr<UserInfo> Events<Socket>::checkUser(const std::string& login, 
                                             const std::string& password, 
                                             const std::string& postfixContext)
 {
-    auto user = std::make_unique<UserInfo>();  //   auth = false
+    auto user = std::make_unique<UserInfo>();  // по умолчанию auth = false
     user->login = login;
     
-    //  
-    Dao db(DaoSettings::REDIS_SOCKET);
+    // Аутентифицируем пользователя
+    Dao db(m_storage);
     user->auth = db.checkPass(login, password, postfixContext);
     if (user->auth)
     {
         m_log.info("The user \"" + login + "\" is authenticated successfully.", 
             m_context + postfixContext, "Events::checkUser " + std::to_string(__LINE__));
         
-        //   
+        // Проверка статуса администратора
         user->isAdmin = db.checkAdminStatus(login, postfixContext);
     }
     else
@@ -80,15 +114,16 @@ std::unique_ptr<UserInfo> Events::checkUser(const std::string& login,
     return user;
 }
 
-//    
-// PerSocketData* dataOut -  
-bool Events::userAuth(                      PerSocketData* dataOut, 
+// Авторизовывает пользователей на сервере
+// PerSocketData* dataOut - параметр вывода
+template <typename Socket>
+bool Events<Socket>::userAuth(              PerSocketData* dataOut, 
                                             const std::string& login, const std::string& password)
 {
-    //  
+    // Авторизовываем пользователя
     std::unique_ptr<UserInfo> user = checkUser(login, password, dataOut->userId);
     
-    //    
+    // Пользователь не прошел аутентификацию
     if (!user->auth)
     {
         m_log.info("Failed authorization of the user.", m_context + dataOut->userId, "Events::userAuth " + std::to_string(__LINE__));
@@ -99,6 +134,7 @@ bool Events::userAuth(                      PerSocketData* dataOut,
     dataOut->login = user->login;
     dataOut->auth = true;
     dataOut->isAdmin = user->isAdmin;
+    ChannelRegistry::entitle(dataOut->login, dataOut->isAdmin, dataOut->channels, dataOut->adminChannels);
 
     m_log.info("The user with username \"" + dataOut->login + "\" is logged in.",
         m_context + dataOut->userId, "Events::userAuth " + std::to_string(__LINE__));
@@ -106,25 +142,338 @@ bool Events::userAuth(                      PerSocketData* dataOut,
     return true;
 }
 
-//         
-int Events::sendSignals(                    uWS::WebSocket<false, true, PerSocketData>* ws, 
+// Возвращает канал команды, если у пользователя есть права на чтение или публикацию
+template <typename Socket>
+std::shared_ptr<Channel> Events<Socket>::channelOf(const PerSocketData* data, 
+                                            const std::string& name,
+                                            bool publish,
+                                            const std::string& postfixContext)
+{
+    std::shared_ptr<Channel> channel = ChannelRegistry::find(name);
+    uint64_t rights = publish ? data->adminChannels : data->channels;
+    if (!channel || !(rights & ChannelRegistry::bit(channel->id)))
+    {
+        m_log.warn("The channel \"" + name + "\" does not exist or is not available to the user.", 
+            m_context + postfixContext, "Events::channelOf " + std::to_string(__LINE__));
+
+        return nullptr;
+    }
+
+    return channel;
+}
+
+// Возвращает обработчик доставки рассылки, который отправляет администратору расширенное подтверждение
+// Тикер указывается для одиночного сигнала, для пакета он пустой
+// Доставка собирается в потоке последнего цикла, ответ уходит в поток соединения администратора,
+// где живёт и этот обработчик
+template <typename Socket>
+DeliveryCallback Events<Socket>::deliveryAck(Socket* ws, 
+                                            const std::string& tickerSymbol,
+                                            const Channel& channel,
+                                            const std::string& postfixContext)
+{
+    return [this, ws, loop = ServerLoop::get(), userId = ws->getUserData()->userId, tickerSymbol, channelName = channel.name, 
+        start = std::chrono::steady_clock::now(), postfixContext](std::vector<LoopDelivery>&& loops)
+    {
+        auto totalUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        loop->defer([this, ws, userId, tickerSymbol, channelName, totalUs, loops = std::move(loops), postfixContext]()
+            {
+                // Администратор мог отключиться, пока шла рассылка
+                LoopContext* loopContext = LoopRegistry::current();
+                if (!loopContext || !loopContext->sockets.count(ws) || ws->getUserData()->userId != userId)
+                {
+                    return;
+                }
+
+                Arena::Scope scope;
+                MessageJson response;
+                response[JsonValue::COMMAND] = JsonValue::DELIVERY;
+                if (!channelName.empty())
+                {
+                    response[JsonValue::CHANNEL] = channelName;
+                }
+                if (!tickerSymbol.empty())
+                {
+                    response[JsonValue::TICKER] = tickerSymbol;
+                }
+                response[JsonValue::LOOPS] = MessageJson::array();
+
+                unsigned int queued = 0;
+                unsigned int backpressured = 0;
+                unsigned int dropped = 0;
+                uint64_t fanoutUs = 0;
+                for (const LoopDelivery& delivery : loops)
+                {
+                    MessageJson item;
+                    item[JsonValue::LOOP] = delivery.loop;
+                    item[JsonValue::QUEUED] = delivery.queued;
+                    item[JsonValue::BACKPRESSURED] = delivery.backpressured;
+                    item[JsonValue::DROPPED] = delivery.dropped;
+                    item[JsonValue::QUEUE_US] = delivery.queueUs;
+                    item[JsonValue::FANOUT_US] = delivery.fanoutUs;
+                    response[JsonValue::LOOPS].push_back(std::move(item));
+
+                    queued += delivery.queued;
+                    backpressured += delivery.backpressured;
+                    dropped += delivery.dropped;
+                    fanoutUs = std::max(fanoutUs, delivery.queueUs + delivery.fanoutUs);
+                }
+                response[JsonValue::QUEUED] = queued;
+                response[JsonValue::BACKPRESSURED] = backpressured;
+                response[JsonValue::DROPPED] = dropped;
+                response[JsonValue::FANOUT_US] = fanoutUs;
+                response[JsonValue::TOTAL_US] = totalUs;
+
+                send(ws, dumpToArena(response));
+
+                if (dropped)
+                {
+                    m_log.warn("The broadcast was not delivered to " + std::to_string(dropped) + " subscriber(s).", 
+                        m_context + postfixContext, "Events::deliveryAck " + std::to_string(__LINE__));
+                }
+            }
+        );
+    };
+}
+
+// Отправляет сообщение пользователю и учитывает буферизацию при перегрузке
+template <typename Socket>
+void Events<Socket>::send(                  Socket* ws, 
+                                            std::string_view message)
+{
+    Trace::record(TraceType::TRACE_SEND, static_cast<uint32_t>(message.size()));
+    if (ws->send(message, uWS::OpCode::TEXT) != Socket::SendStatus::SUCCESS)
+    {
+        Metrics::increment(Metrics::BACKPRESSURE_EVENTS);
+        Metrics::observe(Metrics::BUFFERED_BYTES, ws->getBufferedAmount());
+    }
+}
+
+// Ставит ответ в цикл соединения, задачи цикла не выполняются после его снятия с регистрации
+template <typename Socket>
+void Events<Socket>::reply(                 Socket* ws, 
+                                            LoopContext* loopContext,
+                                            const std::string& userId,
+                                            std::string&& message)
+{
+    LoopRegistry::defer(loopContext, [ws, loopContext, userId, message = std::move(message)]()
+        {
+            if (!loopContext->sockets.count(ws) || ws->getUserData()->userId != userId)
+            {
+                return;
+            }
+
+            Trace::Connection trace(ws->getUserData()->traceId);
+            send(ws, message);
+        }
+    );
+}
+
+// Отклоняет авторизацию при превышении лимита
+template <typename Socket>
+void Events<Socket>::rejectRateLimited(     Socket* ws, 
+                                            const std::string& reason,
+                                            const std::string& postfixContext)
+{
+    Metrics::increment(Metrics::RATE_LIMITED);
+    m_log.warn("Authorization rate limit exceeded for the " + reason, 
+        m_context + postfixContext, "Events::rejectRateLimited " + std::to_string(__LINE__));
+
+    send(ws, s_rateLimited);
+}
+
+// Начинает постраничную выдачу истории сигналов
+// Диапазон задаётся временем в миллисекундах, тикер необязателен
+template <typename Socket>
+void Events<Socket>::history(               Socket* ws, 
+                                            const MessageJson& parsed,
+                                            const std::string& postfixContext)
+{
+    HistoryCursor& cursor = ws->getUserData()->history;
+    cursor.channel = parsed.value(JsonValue::CHANNEL, std::string{});
+    cursor.tickerSymbol = parsed.value(JsonValue::TICKER, std::string{});
+    cursor.next = parsed.contains(JsonValue::FROM) ? std::to_string(parsed[JsonValue::FROM].get<unsigned long long>()) : "-";
+    cursor.end = parsed.contains(JsonValue::TO) ? std::to_string(parsed[JsonValue::TO].get<unsigned long long>()) : "+";
+    cursor.active = true;
+    cursor.pending = false;
+    ++cursor.request;
+
+    m_log.info("History requested for the ticker \"" + cursor.tickerSymbol + "\" from " + cursor.next + " to " + cursor.end, 
+        m_context + postfixContext, "Events::history " + std::to_string(__LINE__));
+
+    sendHistoryPage(ws, postfixContext);
+}
+
+// Запрашивает страницу истории и планирует следующую
+// Журнал читается потоком StorageWorker, страница отправляется задачей цикла соединения,
+// следующая запрашивается сразу, а при заполненном буфере сокета - по событию drain
+template <typename Socket>
+void Events<Socket>::sendHistoryPage(       Socket* ws, 
                                             const std::string& postfixContext)
 {
-    //     
-    std::map<std::string, std::string> signals;
+    HistoryCursor& cursor = ws->getUserData()->history;
+    cursor.pending = false;
+    if (!cursor.active)
+    {
+        return;
+    }
+
+    std::shared_ptr<Channel> channel = channelOf(ws->getUserData(), cursor.channel, false, postfixContext);
+    LoopContext* loopContext = LoopRegistry::current();
+    if (!channel || !loopContext)
+    {
+        cursor.active = false;
+
+        MessageJson response;
+        response[JsonValue::COMMAND] = JsonValue::ACTION_FAIL;
+        response[JsonValue::ITEMS] = MessageJson::array();
+        response[JsonValue::MORE] = false;
+        send(ws, dumpToArena(response));
+
+        return;
+    }
+
+    // Поток чтения обращается только к хранилищу процесса, обработчики цикла трогает лишь задача цикла
+    cursor.pending = true;
+    StorageWorker::post([this, &storage = m_storage, ws, loopContext, channel, request = cursor.request, tickerSymbol = cursor.tickerSymbol, 
+        start = cursor.next, end = cursor.end, postfixContext]()
+        {
+            // Лишняя запись показывает, что выдача не закончена, с неё начнётся следующая страница
+            auto entries = std::make_shared<std::vector<HistoryEntry>>();
+            Dao db(storage);
+            bool result = db.getHistory(channel->keys, tickerSymbol, start, end, HistorySettings::PAGE_SIZE + 1, *entries, postfixContext);
+
+            LoopRegistry::defer(loopContext, [this, ws, loopContext, channel, request, entries, result, postfixContext]()
+                {
+                    // Соединение могло закрыться, начать новую выдачу или потерять канал
+                    HistoryCursor& cursor = ws->getUserData()->history;
+                    if (!loopContext->sockets.count(ws) || cursor.request != request)
+                    {
+                        return;
+                    }
+                    cursor.pending = false;
+                    if (!cursor.active)
+                    {
+                        return;
+                    }
+
+                    Trace::Connection trace(ws->getUserData()->traceId);
+                    Arena::Scope scope;
+                    sendHistoryEntries(ws, *channel, result, *entries, postfixContext);
+                }
+            );
+        }
+    );
+}
 
-    Dao db(DaoSettings::REDIS_SOCKET);
-    int count = db.getAllSignals(signals, postfixContext);
+// Отправляет прочитанную страницу истории и запрашивает следующую, если буфер сокета не заполнен
+template <typename Socket>
+void Events<Socket>::sendHistoryEntries(    Socket* ws, 
+                                            const Channel& channel,
+                                            bool result,
+                                            std::vector<HistoryEntry>& entries,
+                                            const std::string& postfixContext)
+{
+    HistoryCursor& cursor = ws->getUserData()->history;
+    bool more = result && entries.size() > static_cast<size_t>(HistorySettings::PAGE_SIZE);
+    if (more)
+    {
+        cursor.next = entries.back().id;
+        entries.pop_back();
+    }
+    cursor.active = more;
 
-    //     
-    for (const auto& el : signals)
+    MessageJson response;
+    response[JsonValue::COMMAND] = result ? JsonValue::HISTORY : JsonValue::ACTION_FAIL;
+    channel.tag(response);
+    response[JsonValue::ITEMS] = MessageJson::array();
+    for (const HistoryEntry& entry : entries)
     {
-        nlohmann::json response;
-        response[JsonValue::COMMAND] = JsonValue::ACTIVE_SIGNAL;
-        response[JsonValue::TICKER] = el.first;
-        response[JsonValue::LIMITS] = el.second;
+        // Время записи - часть идентификатора потока до дефиса; запись с испорченным идентификатором пропускается
+        const char* first = entry.id.data();
+        const char* last = first + std::min(entry.id.find('-'), entry.id.size());
+        uint64_t time = 0;
+        auto [ptr, error] = std::from_chars(first, last, time);
+        if (error != std::errc() || ptr != last)
+        {
+            m_log.warn("Invalid history entry id \"" + entry.id + "\" in the channel \"" + channel.name + "\".", 
+                        m_context + postfixContext, "Events::sendHistoryEntries " + std::to_string(__LINE__));
+            continue;
+        }
+
+        MessageJson item;
+        item[JsonValue::TIME] = time;
+        item[JsonValue::ACTION] = entry.action;
+        item[JsonValue::TICKER] = entry.tickerSymbol;
+        item[JsonValue::LIMITS] = entry.limits;
+        item[JsonValue::AUTHOR] = entry.author;
 
-        ws->send(response.dump(), uWS::OpCode::TEXT);
+        response[JsonValue::ITEMS].push_back(std::move(item));
+    }
+    response[JsonValue::MORE] = more;
+
+    send(ws, dumpToArena(response));
+
+    if (more && ws->getBufferedAmount() < HistorySettings::MAX_BUFFERED)
+    {
+        sendHistoryPage(ws, postfixContext);
+    }
+}
+
+// Продолжает выдачу истории после освобождения буфера сокета
+template <typename Socket>
+void Events<Socket>::continueHistory(       Socket* ws)
+{
+    PerSocketData* data = ws->getUserData();
+    if (data->history.active && !data->history.pending)
+    {
+        sendHistoryPage(ws, data->userId);
+    }
+}
+
+// Отправляет список активных сигналов пользователю и возвращает их количество
+template <typename Socket>
+int Events<Socket>::sendSignals(            Socket* ws, 
+                                            const std::string& postfixContext)
+{
+    // Активные сигналы доступных каналов берутся из их книг в памяти без обращения к БД
+    // Книга цикла содержит ровно то, что уже разослано его подписчикам, а сокет подписан в этой же задаче цикла,
+    // поэтому после снимка приходят только изменения с большей версией
+    // Книга канала мимо цикла не берётся: её версия может опередить рассылки цикла, и подписчик отбросит их.
+    // Канал без книги в цикле ещё не загружен, его снимок пуст с версией 0, сигналы придут пакетом загрузки
+    Metrics::Timer timer(Metrics::SNAPSHOT_TIME);
+    int count = 0;
+    uint64_t channels = ws->getUserData()->channels;
+    for (const auto& channel : ChannelRegistry::all())
+    {
+        if (!(channels & ChannelRegistry::bit(channel->id)))
+        {
+            continue;
+        }
+
+        std::shared_ptr<const SignalBook::Book> book = LoopRegistry::book(LoopRegistry::current(), channel->id);
+
+        // Сообщения собраны при изменении книги
+        int sent = 0;
+        for (size_t index = 0; book && index < book->frames.size(); ++index)
+        {
+            if (!book->frames[index])
+            {
+                continue;
+            }
+
+            send(ws, *book->frames[index]);
+            ++sent;
+        }
+        count += sent;
+
+        // Конец снимка канала с его версией, рассылки с версией не больше уже учтены в снимке
+        MessageJson end;
+        end[JsonValue::COMMAND] = JsonValue::SNAPSHOT;
+        channel->tag(end);
+        end[JsonValue::VERSION] = book ? book->version : 0;
+        end[JsonValue::COUNT] = sent;
+        send(ws, dumpToArena(end));
     }
 
     m_log.info(std::to_string(count) + " signals were sent to the user", 
@@ -133,98 +482,443 @@ int Events::sendSignals(                    uWS::WebSocket<false, true, PerSocke
     return count;
 }
 
-//  
-void Events::authorization(                 uWS::WebSocket<false, true, PerSocketData>* ws, 
-                                            const std::string_view message,
+// Авторизовывает пользователя
+template <typename Socket>
+void Events<Socket>::authorization(         Socket* ws, 
+                                            const MessageJson& parsed,
                                             const std::string& postfixContext)
 {
     PerSocketData* data = ws->getUserData();
+
+    // Ограничиваем частоту авторизаций с одного адреса до любой работы с БД
+    if (!RateLimiter::byIp().allow(data->ip))
+    {
+        rejectRateLimited(ws, "IP \"" + data->ip + '"', postfixContext);
+
+        return;
+    }
     
-    //    
-    nlohmann::json parsed = nlohmann::json::parse(message);
-    if (parsed[JsonValue::COMMAND] != JsonValue::AUTH)
+    // Получаем логин и пароль
+    const std::string login = parsed.at(JsonValue::USERNAME);
+    const std::string password = parsed.at(JsonValue::PASSWORD);
+
+    if (!RateLimiter::byLogin().allow(login))
     {
-        m_log.info("The user is not authorized", m_context + postfixContext, "Events::authorization " + std::to_string(__LINE__));
+        rejectRateLimited(ws, "username \"" + login + '"', postfixContext);
 
         return;
     }
-    const std::string login = parsed[JsonValue::USERNAME];
-    const std::string password = parsed[JsonValue::PASSWORD];
 
-    
-    if (userAuth(data, login, password))
+    Metrics::increment(Metrics::AUTH_ATTEMPTS);
+    Trace::record(TraceType::TRACE_AUTH_BEGIN);
+    bool success = userAuth(data, login, password);
+    Trace::record(TraceType::TRACE_AUTH_END, success ? 1 : 0);
+    if (success && !SessionRegistry::add(ws, postfixContext))
+    {
+        // Лимит сессий исчерпан, авторизация отменяется
+        data->auth = false;
+        data->isAdmin = false;
+        data->channels = 0;
+        data->adminChannels = 0;
+
+        MessageJson response;
+        response[JsonValue::AUTH] = JsonValue::SESSION_LIMIT;
+
+        send(ws, dumpToArena(response));
+
+        return;
+    }
+
+    if (success)
     {
-        //      
-        ws->subscribe(ServerSettings::BROADCAST);
-        m_log.info("The user \"" + data->login + "\" is subscribed to a channel with signals.", 
+        // Подписываем пользователя на доступные каналы с сигналами
+        int subscribed = 0;
+        for (const auto& channel : ChannelRegistry::all())
+        {
+            if (data->channels & ChannelRegistry::bit(channel->id))
+            {
+                ws->subscribe(channel->topic);
+                ++subscribed;
+            }
+        }
+        m_log.info("The user \"" + data->login + "\" is subscribed to " + std::to_string(subscribed) + " channel(s) with signals.", 
             m_context + postfixContext, "Events::authorization " + std::to_string(__LINE__));
     }
     else
     {
-        //    
-        nlohmann::json response;
+        Metrics::increment(Metrics::AUTH_FAILURES);
+
+        // Неверный логин или пароль
+        MessageJson response;
         response[JsonValue::AUTH] = JsonValue::AUTH_FALSE;
 
-        ws->send(response.dump(), uWS::OpCode::TEXT);
+        send(ws, dumpToArena(response));
 
         return;
     }
 
-    //     
+    // Отправляем все активные сигналы пользователю
     sendSignals(ws, data->userId);
 }
 
-//    
-void Events::signalize(                     uWS::WebSocket<false, true, PerSocketData>* ws, 
-                                            const std::string_view message, 
+// Добавляет и удаляет сигналы
+// Команда проверяется в цикле, запись в хранилище и применение к книге выполняет очередь записей канала,
+// ответ возвращается в цикл соединения раньше рассылки изменения
+template <typename Socket>
+void Events<Socket>::signalize(             Socket* ws, 
+                                            const MessageJson& parsed, 
                                             const std::string& postfixContext)
 {
-    //       
-    nlohmann::json parsed = nlohmann::json::parse(message);
-    std::string command = parsed[JsonValue::COMMAND];
-    std::string tickerSymbol = parsed[JsonValue::TICKER];
-    std::string limits;
-
-    //     
-    nlohmann::json response;
-    if (command == JsonValue::ADD_SIGNAL)
+    // Получаем тип задачи и информацию по сигналу
+    const std::string& command = parsed.at(JsonValue::COMMAND).get_ref<const std::string&>();
+    SignalChange change;
+    change.action = command;
+    change.tickerSymbol = parsed.at(JsonValue::TICKER);
+    const std::string& tickerSymbol = change.tickerSymbol;
+    std::shared_ptr<Channel> channel = channelOf(ws->getUserData(), parsed.value(JsonValue::CHANNEL, std::string{}), true, postfixContext);
+    LoopContext* loopContext = LoopRegistry::current();
+
+    // Определяем команду
+    MessageJson response;
+    if (!channel || !loopContext)
     {
-        //  
-        limits = parsed[JsonValue::LIMITS];
-        
-        Dao db(DaoSettings::REDIS_SOCKET);
-        response[JsonValue::COMMAND] = (db.setSignal(tickerSymbol, limits, postfixContext) ? JsonValue::ACTION_SUCCESS : JsonValue::ACTION_FAIL);
-
+        response[JsonValue::COMMAND] = JsonValue::ACTION_FAIL;
     }
-    else if (command == JsonValue::DEL_SIGNAL)
+    else if (command == JsonValue::ADD_SIGNAL && 
+        (!SignalCodec::validTicker(tickerSymbol) || !SignalCodec::parse(parsed, change.signal, change.limits)))
     {
-        //  
-        Dao db(DaoSettings::REDIS_SOCKET);
-        response[JsonValue::COMMAND] = (db.delSignal(tickerSymbol, postfixContext) ? JsonValue::ACTION_SUCCESS : JsonValue::ACTION_FAIL);
+        // Неверные поля сигнала отклоняются до обращения к БД
+        m_log.warn("Invalid signal for the ticker \"" + tickerSymbol + "\" from the user.", 
+            m_context + postfixContext, "Events::signalize " + std::to_string(__LINE__));
+        response[JsonValue::COMMAND] = JsonValue::ACTION_FAIL;
     }
-    else
+    else if (command != JsonValue::ADD_SIGNAL && command != JsonValue::DEL_SIGNAL)
     {
-        //  
+        // Неизвестная команда
         m_log.warn("Unknown command from the user.", m_context + postfixContext, "Events::signalize " + std::to_string(__LINE__));
         response[JsonValue::COMMAND] = JsonValue::ACTION_UNKNOWN;
     }
 
-    //  
-    ws->send(response.dump(), uWS::OpCode::TEXT);
+    if (!response.empty())
+    {
+        send(ws, dumpToArena(response));
 
-    //         
-    if (response[JsonValue::COMMAND] == JsonValue::ACTION_SUCCESS)
+        return;
+    }
+
+    // Задача очереди обращается только к хранилищу, каналу и рассылке, соединение трогает лишь задача цикла
+    change.remove = command == JsonValue::DEL_SIGNAL;
+    DeliveryCallback onDelivered = parsed.value(JsonValue::DELIVERY, false) ? deliveryAck(ws, tickerSymbol, *channel, postfixContext) : nullptr;
+    ChannelRegistry::write(*channel, [&storage = m_storage, ws, loopContext, channel, change = std::move(change), onDelivered = std::move(onDelivered), 
+        userId = ws->getUserData()->userId, login = ws->getUserData()->login, context = m_context + postfixContext, postfixContext]() mutable
+        {
+            const std::string& tickerSymbol = change.tickerSymbol;
+            Dao db(storage);
+            bool result = false;
+            if (!change.remove)
+            {
+                // Добавляем сигнал
+                result = db.setSignal(channel->keys, tickerSymbol, change.signal, change.limits, postfixContext);
+            }
+            else if (!channel->book.holds(tickerSymbol))
+            {
+                // Наличие сигнала решает книга канала: при недоступности Redis удаление уходит в журнал
+                // и хранилище не может сказать, был ли сигнал
+                m_log.info("The signal with the ticker \"" + tickerSymbol + "\" is not in the book.", 
+                    context, "Events::signalize " + std::to_string(__LINE__));
+            }
+            else
+            {
+                // Удаляем сигнал
+                result = db.delSignal(channel->keys, tickerSymbol, postfixContext);
+            }
+
+            // Журнал изменений
+            if (result)
+            {
+                db.addHistory(channel->keys, change.action, tickerSymbol, change.limits, login, postfixContext);
+            }
+
+            // Сообщение пользователю
+            MessageJson response;
+            response[JsonValue::COMMAND] = result ? JsonValue::ACTION_SUCCESS : JsonValue::ACTION_FAIL;
+            reply(ws, loopContext, userId, response.dump());
+
+            if (!result)
+            {
+                return;
+            }
+
+            // В случае успеха изменений отправляем сообщение в общий чат с версией книги,
+            // отложенный сигнал разошлёт планировщик в момент активации, а циклы получат только новую книгу
+            bool visible = change.remove || (change.signal.flags & SIGNAL_ACTIVE);
+            channel->book.apply({ change }, { true }, [&](const std::shared_ptr<const SignalBook::Book>& book)
+                {
+                    BookUpdate update{ channel->id, book, channel->topic, {} };
+                    if (visible)
+                    {
+                        MessageJson resBroadcast;
+                        resBroadcast[JsonValue::COMMAND] = change.action;
+                        channel->tag(resBroadcast);
+                        resBroadcast[JsonValue::TICKER] = tickerSymbol;
+                        resBroadcast[JsonValue::VERSION] = book->version;
+                        if (!change.remove)
+                        {
+                            SignalCodec::toJson(change.signal, change.limits, resBroadcast);
+                        }
+                        update.message = resBroadcast.dump();
+                    }
+
+                    if (visible && onDelivered)
+                    {
+                        LoopRegistry::publish(update, std::move(onDelivered));
+                    }
+                    else
+                    {
+                        LoopRegistry::publish(update);
+                    }
+                }
+            );
+
+            if (visible)
+            {
+                m_log.info("A new signal is published.", context, "Events::signalize " + std::to_string(__LINE__));
+            }
+        }
+    );
+}
+
+// Применяет пакет изменений сигналов одной транзакцией
+// Ответ содержит результат каждого изменения в порядке запроса,
+// успешные изменения рассылаются одним сообщением
+template <typename Socket>
+void Events<Socket>::batch(                 Socket* ws, 
+                                            const MessageJson& parsed,
+                                            const std::string& postfixContext)
+{
+    MessageJson response;
+    response[JsonValue::COMMAND] = JsonValue::BATCH;
+    response[JsonValue::ITEMS] = MessageJson::array();
+
+    auto items = parsed.find(JsonValue::ITEMS);
+    std::shared_ptr<Channel> channel = channelOf(ws->getUserData(), parsed.value(JsonValue::CHANNEL, std::string{}), true, postfixContext);
+    LoopContext* loopContext = LoopRegistry::current();
+    if (!channel || !loopContext || items == parsed.end() || !items->is_array() || items->size() > BatchSettings::MAX_ITEMS)
     {
-        nlohmann::json resBroadcast;
-        resBroadcast[JsonValue::COMMAND] = command;
-        resBroadcast[JsonValue::TICKER] = tickerSymbol;
-        if (limits != "")
+        m_log.warn("Invalid batch of signals from the user.", m_context + postfixContext, "Events::batch " + std::to_string(__LINE__));
+        response[JsonValue::COMMAND] = JsonValue::ACTION_FAIL;
+        send(ws, dumpToArena(response));
+
+        return;
+    }
+
+    // Разбираем изменения, неверные элементы в транзакцию не попадают
+    auto isString = [](const MessageJson& item, const std::string& key)
+    {
+        auto field = item.find(key);
+        return field != item.end() && field->is_string();
+    };
+
+    std::vector<SignalChange> changes;
+    std::vector<std::string> outcomes(items->size(), JsonValue::ACTION_FAIL);
+    std::vector<size_t> positions;
+    for (size_t index = 0; index < items->size(); ++index)
+    {
+        const MessageJson& item = (*items)[index];
+        if (!item.is_object() || !isString(item, JsonValue::COMMAND) || !isString(item, JsonValue::TICKER))
+        {
+            continue;
+        }
+
+        SignalChange change;
+        change.action = item[JsonValue::COMMAND];
+        change.tickerSymbol = item[JsonValue::TICKER];
+        if (change.action == JsonValue::ADD_SIGNAL)
         {
-            resBroadcast[JsonValue::LIMITS] = limits;
+            if (!SignalCodec::validTicker(change.tickerSymbol) || !SignalCodec::parse(item, change.signal, change.limits))
+            {
+                continue;
+            }
         }
+        else if (change.action == JsonValue::DEL_SIGNAL)
+        {
+            change.remove = true;
+        }
+        else
+        {
+            outcomes[index] = JsonValue::ACTION_UNKNOWN;
 
-        ws->publish(ServerSettings::BROADCAST, resBroadcast.dump());
+            continue;
+        }
 
-        m_log.info("A new signal is published.", m_context + postfixContext, "Events::signalize " + std::to_string(__LINE__));
+        changes.push_back(std::move(change));
+        positions.push_back(index);
     }
+
+    // Запись пакета и его применение к книге - одна задача очереди записей канала, как в signalize
+    DeliveryCallback onDelivered = parsed.value(JsonValue::DELIVERY, false) ? deliveryAck(ws, std::string{}, *channel, postfixContext) : nullptr;
+    ChannelRegistry::write(*channel, [&storage = m_storage, ws, loopContext, channel, changes = std::move(changes), outcomes = std::move(outcomes), 
+        positions = std::move(positions), onDelivered = std::move(onDelivered), userId = ws->getUserData()->userId, login = ws->getUserData()->login, 
+        context = m_context + postfixContext, postfixContext]() mutable
+        {
+            // Удаление сигнала, которого нет в книге, в пакет не попадает, как в signalize
+            // Наличие учитывает изменения этого же пакета перед удалением
+            std::map<std::string, bool> held;
+            for (size_t index = 0; index < changes.size();)
+            {
+                auto [state, inserted] = held.try_emplace(changes[index].tickerSymbol, false);
+                if (inserted)
+                {
+                    state->second = channel->book.holds(changes[index].tickerSymbol);
+                }
+
+                if (changes[index].remove && !state->second)
+                {
+                    changes.erase(changes.begin() + static_cast<std::ptrdiff_t>(index));
+                    positions.erase(positions.begin() + static_cast<std::ptrdiff_t>(index));
+
+                    continue;
+                }
+                state->second = !changes[index].remove;
+                ++index;
+            }
+
+            Dao db(storage);
+            std::vector<bool> results;
+            db.applySignals(channel->keys, changes, login, results, postfixContext);
+
+            // Собираем ответ и общее сообщение для рассылки
+            MessageJson response;
+            response[JsonValue::COMMAND] = JsonValue::BATCH;
+            MessageJson resBroadcast;
+            resBroadcast[JsonValue::COMMAND] = JsonValue::BATCH;
+            channel->tag(resBroadcast);
+            resBroadcast[JsonValue::ITEMS] = MessageJson::array();
+            for (size_t index = 0; index < changes.size(); ++index)
+            {
+                if (!results[index])
+                {
+                    continue;
+                }
+                outcomes[positions[index]] = JsonValue::ACTION_SUCCESS;
+                if (!changes[index].remove && !(changes[index].signal.flags & SIGNAL_ACTIVE))
+                {
+                    continue;
+                }
+
+                MessageJson signal;
+                signal[JsonValue::COMMAND] = changes[index].action;
+                signal[JsonValue::TICKER] = changes[index].tickerSymbol;
+                if (!changes[index].remove)
+                {
+                    SignalCodec::toJson(changes[index].signal, changes[index].limits, signal);
+                }
+                resBroadcast[JsonValue::ITEMS].push_back(std::move(signal));
+            }
+
+            response[JsonValue::ITEMS] = outcomes;
+
+            // Сообщение пользователю
+            reply(ws, loopContext, userId, response.dump());
+
+            // Пакет получает версию книги, в которой применены все его изменения
+            bool visible = !resBroadcast[JsonValue::ITEMS].empty();
+            channel->book.apply(changes, results, [&](const std::shared_ptr<const SignalBook::Book>& book)
+                {
+                    BookUpdate update{ channel->id, book, channel->topic, {} };
+                    if (visible)
+                    {
+                        resBroadcast[JsonValue::VERSION] = book->version;
+                        update.message = resBroadcast.dump();
+                    }
+
+                    if (visible && onDelivered)
+                    {
+                        LoopRegistry::publish(update, std::move(onDelivered));
+                    }
+                    else
+                    {
+                        LoopRegistry::publish(update);
+                    }
+                }
+            );
+
+            if (visible)
+            {
+                m_log.info("A batch of " + std::to_string(resBroadcast[JsonValue::ITEMS].size()) + " signal(s) is published.", 
+                    context, "Events::batch " + std::to_string(__LINE__));
+            }
+        }
+    );
+}
+
+// Отправляет сообщение во все сессии пользователя
+template <typename Socket>
+void Events<Socket>::directMessage(         Socket* ws, 
+                                            const MessageJson& parsed,
+                                            const std::string& postfixContext)
+{
+    const std::string login = parsed.at(JsonValue::USERNAME);
+
+    MessageJson message;
+    message[JsonValue::COMMAND] = JsonValue::MESSAGE;
+    message[JsonValue::PAYLOAD] = parsed.at(JsonValue::PAYLOAD);
+    message[JsonValue::AUTHOR] = ws->getUserData()->login;
+
+    ArenaString dumped = dumpToArena(message);
+    size_t sessions = SessionRegistry::send(login, std::string(dumped));
+
+    m_log.info("Direct message to the user \"" + login + "\" was sent to " + std::to_string(sessions) + " session(s).", 
+        m_context + postfixContext, "Events::directMessage " + std::to_string(__LINE__));
+
+    MessageJson response;
+    response[JsonValue::COMMAND] = JsonValue::MESSAGE;
+    response[JsonValue::USERNAME] = login;
+    response[JsonValue::SESSIONS] = sessions;
+
+    send(ws, dumpToArena(response));
 }
+
+// Принудительно завершает все сессии пользователя
+template <typename Socket>
+void Events<Socket>::logout(                Socket* ws, 
+                                            const MessageJson& parsed,
+                                            const std::string& postfixContext)
+{
+    const std::string login = parsed.at(JsonValue::USERNAME);
+
+    MessageJson message;
+    message[JsonValue::COMMAND] = JsonValue::LOGOUT;
+    message[JsonValue::AUTHOR] = ws->getUserData()->login;
+
+    ArenaString dumped = dumpToArena(message);
+    size_t sessions = SessionRegistry::logout(login, std::string(dumped));
+
+    m_log.info("The user \"" + login + "\" was logged out of " + std::to_string(sessions) + " session(s).", 
+        m_context + postfixContext, "Events::logout " + std::to_string(__LINE__));
+
+    MessageJson response;
+    response[JsonValue::COMMAND] = JsonValue::LOGOUT;
+    response[JsonValue::USERNAME] = login;
+    response[JsonValue::SESSIONS] = sessions;
+
+    send(ws, dumpToArena(response));
+}
+
+// Отвечает администратору на неизвестную команду
+template <typename Socket>
+void Events<Socket>::unknownCommand(        Socket* ws, 
+                                            const MessageJson& /*parsed*/, 
+                                            const std::string& postfixContext)
+{
+    m_log.warn("Unknown command from the user.", m_context + postfixContext, "Events::unknownCommand " + std::to_string(__LINE__));
+
+    MessageJson response;
+    response[JsonValue::COMMAND] = JsonValue::ACTION_UNKNOWN;
+
+    send(ws, dumpToArena(response));
+}
+
+
+// Инстанцируется только для сокета сервера
+template class Events<ServerSocket>;
@@ -5,22 +5,33 @@
 #include <string_view>
 #include <map>
 #include <memory>
+#include <vector>
 #include <random>
 #include <exception>
 
 #include <uwebsockets/App.h>
+#include <nlohmann/json.hpp>
 
 #include "Logger.h"
 #include "EventsConst.h"
 #include "PerSocketData.h"
+#include "Arena.h"
+#include "Storage.h"
+#include "Dao.h"
+#include "ChannelRegistry.h"
+#include "LoopRegistry.h"
 
 
-//   
+// Проверяет авторизацию пользователей
+// Шаблон по типу сокета: обработчикам нужен только интерфейс uWS::WebSocket,
+// инстанцируется для ServerSocket, тесты подставляют поддельный сокет
+template <typename Socket>
 class Events
 {
 private:
 	static Logger	m_log;
 
+	Storage&		m_storage;
 	std::string		m_context;
 
 
@@ -33,12 +44,45 @@ private:
 										const std::string& login, 
 										const std::string& password);
 	
-	int sendSignals(					uWS::WebSocket<false, true, PerSocketData>* ws, 
+	int sendSignals(					Socket* ws, 
+										const std::string& postfixContext);
+	
+	std::shared_ptr<Channel> channelOf(	const PerSocketData* data, 
+										const std::string& name,
+										bool publish,
+										const std::string& postfixContext);
+	
+	DeliveryCallback deliveryAck(		Socket* ws, 
+										const std::string& tickerSymbol,
+										const Channel& channel,
+										const std::string& postfixContext);
+	
+	static void send(					Socket* ws, 
+										std::string_view message);
+	
+	// Отправляет ответ задачей цикла соединения, вызывается из любого потока
+	// Ответ не отправляется, если соединение закрылось или сменило пользователя
+	static void reply(					Socket* ws, 
+										LoopContext* loopContext,
+										const std::string& userId,
+										std::string&& message);
+	
+	void rejectRateLimited(				Socket* ws, 
+										const std::string& reason,
+										const std::string& postfixContext);
+	
+	void sendHistoryPage(				Socket* ws, 
+										const std::string& postfixContext);
+	
+	void sendHistoryEntries(			Socket* ws, 
+										const Channel& channel,
+										bool result,
+										std::vector<HistoryEntry>& entries,
 										const std::string& postfixContext);
 	
 
 public:
-	Events() try
+	Events() try : m_storage(Storage::instance())
 	{
 		m_context = m_log.getContext() + " ";
 	}
@@ -47,15 +91,47 @@ public:
 		m_log.crit("Standard error: " + std::string(ex.what()), m_log.getContext(), "Auth_constructor h" + std::to_string(__LINE__));
 	}
 
+	// Работа с заданным хранилищем, например с LocalStorage без Redis
+	explicit Events(Storage& storage) : m_storage(storage)
+	{
+		m_context = m_log.getContext() + " ";
+	}
+
+	// Обработчик событий текущего потока
+	static Events& local();
+
 	std::string uuid();
 	
-	void authorization(	uWS::WebSocket<false, true, PerSocketData>* ws, 
-						const std::string_view message,
+	// Обработчики команд, вызываются диспетчером после проверки прав
+	void authorization(	Socket* ws, 
+						const MessageJson& parsed,
+						const std::string& postfixContext);
+	
+	void signalize(		Socket* ws, 
+						const MessageJson& parsed, 
+						const std::string& postfixContext);
+	
+	void batch(			Socket* ws, 
+						const MessageJson& parsed,
 						const std::string& postfixContext);
 	
-	void signalize(		uWS::WebSocket<false, true, PerSocketData>* ws, 
-						const std::string_view message, 
+	void history(		Socket* ws, 
+						const MessageJson& parsed,
 						const std::string& postfixContext);
+	
+	void directMessage(	Socket* ws, 
+						const MessageJson& parsed,
+						const std::string& postfixContext);
+	
+	void logout(		Socket* ws, 
+						const MessageJson& parsed,
+						const std::string& postfixContext);
+	
+	void unknownCommand(Socket* ws, 
+						const MessageJson& parsed,
+						const std::string& postfixContext);
+	
+	void continueHistory(Socket* ws);
 
 };
 
@@ -7,7 +7,7 @@
 struct UserInfo
 {
 	std::string login;
-	//   
+	// Значения по умолчанию
 	bool		auth	= false;
 	bool		isAdmin	= false;
 };
@@ -27,18 +27,68 @@ namespace JsonValue
 	const std::string ACTION_SUCCESS{ "success" };
 	const std::string ACTION_FAIL	{ "fail" };
 	const std::string ACTION_UNKNOWN{ "unknown_command" };
+	const std::string RATE_LIMITED	{ "rate_limited" };
+	const std::string RECONNECT		{ "reconnect" };
+	const std::string DELAY			{ "delay" };
+	const std::string HISTORY		{ "history" };
+	const std::string FROM			{ "from" };
+	const std::string TO			{ "to" };
+	const std::string ITEMS			{ "items" };
+	const std::string MORE			{ "more" };
+	const std::string TIME			{ "time" };
+	const std::string ACTION		{ "action" };
+	const std::string AUTHOR		{ "author" };
+	const std::string BATCH			{ "batch" };
+	const std::string MESSAGE		{ "message" };
+	const std::string PAYLOAD		{ "payload" };
+	const std::string LOGOUT		{ "logout" };
+	const std::string REASON		{ "reason" };
+	const std::string SESSION_LIMIT	{ "session_limit" };
+	const std::string SESSIONS		{ "sessions" };
+	const std::string SIDE			{ "side" };
+	const std::string SIDE_BUY		{ "buy" };
+	const std::string SIDE_SELL		{ "sell" };
+	const std::string QUANTITY		{ "quantity" };
+	const std::string PERCENT		{ "percent" };
+	const std::string ACTIVATE_AT	{ "activateAt" };
+	const std::string EXPIRES_AT	{ "expiresAt" };
+	const std::string EXPIRE		{ "expire" };
+	const std::string CHANNEL		{ "channel" };
+	const std::string CHANNELS		{ "channels" };
+	const std::string DELIVERY		{ "delivery" };
+	const std::string LOOPS			{ "loops" };
+	const std::string LOOP			{ "loop" };
+	const std::string QUEUED		{ "queued" };
+	const std::string BACKPRESSURED	{ "backpressured" };
+	const std::string DROPPED		{ "dropped" };
+	const std::string QUEUE_US		{ "queueUs" };
+	const std::string FANOUT_US		{ "fanoutUs" };
+	const std::string TOTAL_US		{ "totalUs" };
+	const std::string SNAPSHOT		{ "snapshot" };
+	const std::string VERSION		{ "version" };
+	const std::string COUNT			{ "count" };
 
 }
 
-namespace DaoSettings
+namespace ServerSettings
 {
-	const std::string REDIS_SOCKET	{ "tcp://127.0.0.1:6379" };
+	const std::string BROADCAST		{ "broadcast" };
 
 }
 
-namespace ServerSettings
+namespace HistorySettings
 {
-	const std::string BROADCAST		{ "broadcast" };
+	// Количество записей в одном кадре
+	const long long		PAGE_SIZE	(100);
+	// Объём буфера сокета, после которого выдача ждёт события drain
+	const unsigned int	MAX_BUFFERED(256U * 1024U);
+
+}
+
+namespace BatchSettings
+{
+	// Наибольшее количество изменений в одном пакете
+	const size_t		MAX_ITEMS	(500U);
 
 }
 
@@ -0,0 +1,32 @@
+#ifndef FAILOVERSETTINGS_H
+#define FAILOVERSETTINGS_H
+
+#include <string>
+#include <cstdint>
+
+
+// Работа при недоступности Redis
+namespace FailoverSettings
+{
+	const std::string	DIR					{ "../data" };
+
+	// Снимок каналов и книг сигналов в файле, отображённом в память
+	const bool			SNAPSHOT			(true);
+	const std::string	SNAPSHOT_FILE		{ "signals.snap" };
+	// Файл состоит из двух половин такого размера, кратного размеру страницы
+	const size_t		SLOT_SIZE			(8U << 20);		// 8 мебибайт
+	const uint32_t		SNAPSHOT_MAGIC		(0x4E534954U);	// "TISN"
+	const uint32_t		SNAPSHOT_FORMAT		(1U);
+
+	// Журнал записей, не дошедших до Redis
+	const bool			JOURNAL				(true);
+	const std::string	JOURNAL_FILE		{ "outage.log" };
+	// При заполнении журнала записи снова завершаются ошибкой хранилища
+	const size_t		JOURNAL_MAX_RECORDS	(10000U);
+	const size_t		JOURNAL_MAX_BYTES	(16U << 20);	// 16 мебибайт
+	// Период попыток переподключиться к Redis и повторить журнал
+	const unsigned int	REPLAY_MS			(1000U);
+
+}
+
+#endif // !FAILOVERSETTINGS_H
@@ -0,0 +1,523 @@
+#include "FailoverStorage.h"
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <iterator>
+#include <filesystem>
+#include <chrono>
+#include <utility>
+#include <cstdint>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "Storage.h"
+#include "RedisStorage.h"
+#include "FailoverSettings.h"
+
+
+// Инициализация логгера
+Logger FailoverStorage::m_log("FailoverStorage", LoggerSettings::TYPE_LOG);
+
+
+// Типы операций в пакетной записи журнала
+static const std::string BATCH_SET{ "s" };
+static const std::string BATCH_DEL{ "d" };
+
+
+// Аргументы записи журнала для кодирования
+static std::vector<std::string_view> views(const std::vector<std::string>& args)
+{
+	return std::vector<std::string_view>(args.begin(), args.end());
+}
+
+
+
+FailoverStorage::FailoverStorage(	const std::string& redisSocket, 
+									size_t poolSize, 
+									const std::string& dirName, 
+									const std::string& fileName) : 
+	FailoverStorage([redisSocket, poolSize]() { return std::make_unique<RedisStorage>(redisSocket, poolSize); }, dirName, fileName)
+{
+}
+
+FailoverStorage::FailoverStorage(	Connector connector, 
+									const std::string& dirName, 
+									const std::string& fileName) : m_connector(std::move(connector)), m_path(dirName + "/" + fileName)
+{
+	// Проверяем наличие директории для данных
+	if (!std::filesystem::exists(dirName))
+	{
+		std::filesystem::create_directories(dirName);
+	}
+
+	// Журнал прошлого запуска повторяется после подключения к Redis
+	load();
+
+	try
+	{
+		m_primary = connect();
+	}
+	catch (const StorageUnavailable& err)
+	{
+		m_log.warn("Redis is unavailable at startup, writes are journaled: " + std::string(err.what()), 
+			m_log.getContext(), "FailoverStorage::FailoverStorage " + std::to_string(__LINE__));
+	}
+}
+
+
+// Подключается к Redis, вызывается при создании и без блокировки при восстановлении
+std::unique_ptr<Storage> FailoverStorage::connect()
+{
+	std::unique_ptr<Storage> primary = m_connector();
+
+	m_log.info("Connected to Redis.", m_log.getContext(), "FailoverStorage::connect " + std::to_string(__LINE__));
+
+	return primary;
+}
+
+// Читает журнал прошлого запуска и переписывает его без оборванного или повреждённого хвоста
+void FailoverStorage::load()
+{
+	if (!JournalFile::read(m_path, m_records))
+	{
+		m_log.warn("The journal \"" + m_path + "\" ends with an incomplete or damaged record, it is dropped.", 
+			m_log.getContext(), "FailoverStorage::load " + std::to_string(__LINE__));
+	}
+
+	// Журнал переписывается в текущем формате
+	rewrite();
+	m_degraded = !m_records.empty();
+
+	if (!m_records.empty())
+	{
+		m_log.warn(std::to_string(m_records.size()) + " journaled write(s) are waiting for Redis.", 
+			m_log.getContext(), "FailoverStorage::load " + std::to_string(__LINE__));
+	}
+}
+
+
+// Выполняет запись в Redis или дописывает её в журнал
+// Попытка записи в Redis и переход на журнал идут под одной эксклюзивной блокировкой:
+// иначе между отказом и записью в журнал запись другого потока дойдёт до Redis,
+// а повтор журнала потом затрёт её более старым значением
+bool FailoverStorage::write(		const std::function<void(Storage&)>& function, 
+									const std::function<Record()>& record)
+{
+	std::unique_lock ul(m_mtx);
+
+	// Записи после журнала идут за ним, чтобы Redis получил их в том же порядке
+	if (m_primary && !m_degraded)
+	{
+		try
+		{
+			function(*m_primary);
+
+			return true;
+		}
+		catch (const StorageUnavailable& err)
+		{
+			m_log.warn("Redis is unavailable, writes are journaled: " + std::string(err.what()), 
+				m_log.getContext(), "FailoverStorage::write " + std::to_string(__LINE__));
+		}
+	}
+
+	journal(record());
+
+	return false;
+}
+
+// Выполняет чтение из Redis
+void FailoverStorage::read(			const std::string& db, 
+									const std::function<void(Storage&)>& function)
+{
+	std::shared_lock sl(m_mtx);
+
+	if (!m_primary)
+	{
+		throw StorageUnavailable("Redis is not connected");
+	}
+	if (m_dirty.count(db))
+	{
+		throw StorageError('"' + db + "\" has journaled writes that are not replayed yet");
+	}
+
+	function(*m_primary);
+}
+
+// Дописывает запись в журнал и сбрасывает её на диск
+void FailoverStorage::journal(		Record&& record)
+{
+	std::string encoded;
+	JournalFile::encode(encoded, record.operation, views(record.args));
+	if (m_records.size() >= FailoverSettings::JOURNAL_MAX_RECORDS || m_bytes + encoded.size() > FailoverSettings::JOURNAL_MAX_BYTES)
+	{
+		throw StorageError("The journal \"" + m_path + "\" is full");
+	}
+
+	m_file.write(encoded);
+	m_bytes += encoded.size();
+	m_degraded = true;
+
+	markDirty(m_dirty, record);
+	m_records.push_back(std::move(record));
+}
+
+// Отмечает хеш-таблицы, которые меняет запись журнала
+void FailoverStorage::markDirty(	std::unordered_set<std::string>& dirty, 
+									const Record& record)
+{
+	switch (record.operation)
+	{
+	case Operation::OP_HSET:
+	case Operation::OP_HDEL:
+	case Operation::OP_HINCRBY:
+		if (!record.args.empty())
+		{
+			dirty.insert(record.args[0]);
+		}
+		break;
+	case Operation::OP_BATCH:
+		for (size_t index = 0; index + 3 < record.args.size(); index += 4)
+		{
+			dirty.insert(record.args[index + 1]);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+// Переписывает файл журнала оставшимися записями и пересчитывает изменённые хеш-таблицы
+// Старый файл заменяется целиком, поэтому при ошибке журнал на диске не теряется
+void FailoverStorage::rewrite()
+{
+	std::string encoded;
+	std::unordered_set<std::string> dirty;
+	for (const Record& record : m_records)
+	{
+		JournalFile::encode(encoded, record.operation, views(record.args));
+		markDirty(dirty, record);
+	}
+
+	m_file.close();
+	JournalFile::replace(m_path, encoded);
+	m_file.open(m_path, false);
+
+	m_bytes = encoded.size();
+	m_dirty.swap(dirty);
+}
+
+// Повторяет запись журнала, ИН записей потока назначает Redis
+void FailoverStorage::execute(		Storage& redis, 
+									const Record& record)
+{
+	const std::vector<std::string>& args = record.args;
+	switch (record.operation)
+	{
+	case Operation::OP_HSET:
+		if (args.size() == 3)
+		{
+			redis.hSet(args[0], args[1], args[2]);
+		}
+		break;
+	case Operation::OP_HDEL:
+		if (args.size() == 2)
+		{
+			redis.hDel(args[0], args[1]);
+		}
+		break;
+	case Operation::OP_XADD:
+		if (!args.empty() && args.size() % 2 == 1)
+		{
+			Fields fields;
+			for (size_t index = 1; index < args.size(); index += 2)
+			{
+				fields.emplace_back(args[index], args[index + 1]);
+			}
+			redis.xAdd(args[0], fields);
+		}
+		break;
+	case Operation::OP_BATCH:
+		if (args.size() % 4 == 0)
+		{
+			std::vector<HashOp> ops;
+			for (size_t index = 0; index < args.size(); index += 4)
+			{
+				ops.push_back({ args[index] == BATCH_DEL ? HashOpType::HASH_DEL : HashOpType::HASH_SET, args[index + 1], args[index + 2], args[index + 3] });
+			}
+			redis.hBatch(ops);
+		}
+		break;
+	case Operation::OP_HINCRBY:
+		if (args.size() == 3)
+		{
+			try
+			{
+				redis.hIncrBy(args[0], args[1], std::stoll(args[2]));
+			}
+			catch (const std::logic_error&)
+			{
+				throw StorageError("Invalid increment in the journal: " + args[2]);
+			}
+		}
+		break;
+	default:
+		m_log.warn("Unknown operation in the journal: " + std::to_string(record.operation), 
+			m_log.getContext(), "FailoverStorage::execute " + std::to_string(__LINE__));
+		break;
+	}
+}
+
+
+// Переподключается к Redis и повторяет журнал
+// Подключение и повтор идут без эксклюзивной блокировки: записи журнала забираются под ней,
+// новые записи за время повтора встают в журнал за ними, а итог фиксируется под блокировкой снова
+// Файл журнала переписывается только после повтора, поэтому при аварийной остановке во время повтора
+// записи повторятся ещё раз: хеш-таблицы от этого не меняются, в истории могут появиться дубли
+void FailoverStorage::recover()
+{
+	Storage* primary = nullptr;
+	std::unique_ptr<Storage> connected;
+	std::vector<Record> replaying;
+	{
+		std::unique_lock ul(m_mtx);
+		if (m_primary && !m_degraded)
+		{
+			return;
+		}
+		primary = m_primary.get();
+		replaying.swap(m_records);
+	}
+
+	// Возвращает неповторённые записи в начало журнала и фиксирует новое соединение
+	size_t replayed = 0;
+	auto commit = [&]()
+		{
+			std::unique_lock ul(m_mtx);
+			if (connected)
+			{
+				m_primary = std::move(connected);
+			}
+			m_records.insert(m_records.begin(), std::make_move_iterator(replaying.begin() + replayed), std::make_move_iterator(replaying.end()));
+		};
+
+	if (!primary)
+	{
+		try
+		{
+			connected = connect();
+			primary = connected.get();
+		}
+		catch (const StorageUnavailable&)
+		{
+			commit();
+
+			return;
+		}
+	}
+
+	size_t dropped = 0;
+	try
+	{
+		for (; replayed < replaying.size(); ++replayed)
+		{
+			try
+			{
+				execute(*primary, replaying[replayed]);
+			}
+			catch (const StorageUnavailable&)
+			{
+				throw;
+			}
+			catch (const StorageError& err)
+			{
+				// Ошибку в ответе Redis повтор не исправит
+				++dropped;
+				m_log.error("Journaled write is dropped: " + std::string(err.what()), 
+					m_log.getContext(), "FailoverStorage::recover " + std::to_string(__LINE__));
+			}
+		}
+	}
+	catch (const StorageUnavailable& err)
+	{
+		m_log.warn("Replay is interrupted after " + std::to_string(replayed) + " of " + std::to_string(replaying.size()) + 
+			" write(s): " + std::string(err.what()), m_log.getContext(), "FailoverStorage::recover " + std::to_string(__LINE__));
+		commit();
+
+		return;
+	}
+
+	std::unique_lock ul(m_mtx);
+	if (connected)
+	{
+		m_primary = std::move(connected);
+	}
+	if (!replaying.empty())
+	{
+		m_log.info("Replayed " + std::to_string(replaying.size() - dropped) + " journaled write(s) to Redis, dropped " + std::to_string(dropped), 
+			m_log.getContext(), "FailoverStorage::recover " + std::to_string(__LINE__));
+	}
+
+	// Записи, пришедшие во время повтора, остаются в журнале до следующего вызова
+	try
+	{
+		rewrite();
+	}
+	catch (const StorageError& err)
+	{
+		m_log.error("Failed to rewrite the journal \"" + m_path + "\": " + std::string(err.what()), 
+			m_log.getContext(), "FailoverStorage::recover " + std::to_string(__LINE__));
+
+		return;
+	}
+	m_degraded = !m_records.empty();
+}
+
+
+bool FailoverStorage::hExists(		const std::string& db, 
+									const std::string& key)
+{
+	bool exists = false;
+	read(db, [&](Storage& redis) { exists = redis.hExists(db, key); });
+
+	return exists;
+}
+
+// При недоступности Redis считается, что поле создано
+bool FailoverStorage::hSet(			const std::string& db, 
+									const std::string& key, 
+									const std::string& value)
+{
+	bool created = true;
+	write([&](Storage& redis) { created = redis.hSet(db, key, value); }, 
+		[&]() { return Record{ Operation::OP_HSET, { db, key, value } }; });
+
+	return created;
+}
+
+// При недоступности Redis считается, что поле было
+bool FailoverStorage::hDel(			const std::string& db, 
+									const std::string& key)
+{
+	bool deleted = true;
+	write([&](Storage& redis) { deleted = redis.hDel(db, key); }, 
+		[&]() { return Record{ Operation::OP_HDEL, { db, key } }; });
+
+	return deleted;
+}
+
+std::optional<std::string> FailoverStorage::hGet(const std::string& db, 
+									const std::string& key)
+{
+	std::optional<std::string> value;
+	read(db, [&](Storage& redis) { value = redis.hGet(db, key); });
+
+	return value;
+}
+
+// При недоступности Redis приращение журналируется, а возвращается последнее известное значение плюс приращение
+// Версии в хранилище важно только измениться, точное значение Redis назначит при повторе
+long long FailoverStorage::hIncrBy(	const std::string& db, 
+									const std::string& key, 
+									long long increment)
+{
+	long long value = 0;
+	if (write([&](Storage& redis) { value = redis.hIncrBy(db, key, increment); }, 
+		[&]() { return Record{ Operation::OP_HINCRBY, { db, key, std::to_string(increment) } }; }))
+	{
+		std::unique_lock ul(m_mtx);
+		m_counters[db + '\0' + key] = value;
+
+		return value;
+	}
+
+	std::unique_lock ul(m_mtx);
+
+	return m_counters[db + '\0' + key] += increment;
+}
+
+long long FailoverStorage::hGetAll(	const std::string& db, 
+									std::map<std::string, std::string>& output)
+{
+	long long count = 0;
+	read(db, [&](Storage& redis) { count = redis.hGetAll(db, output); });
+
+	return count;
+}
+
+std::vector<bool> FailoverStorage::hBatch(const std::vector<HashOp>& ops)
+{
+	std::vector<bool> results(ops.size(), true);
+	write([&](Storage& redis) { results = redis.hBatch(ops); }, 
+		[&]()
+		{
+			Record record{ Operation::OP_BATCH, {} };
+			for (const HashOp& op : ops)
+			{
+				record.args.insert(record.args.end(), { op.type == HashOpType::HASH_DEL ? BATCH_DEL : BATCH_SET, op.db, op.key, op.value });
+			}
+
+			return record;
+		});
+
+	return results;
+}
+
+bool FailoverStorage::sIsMember(	const std::string& db, 
+									const std::string& value)
+{
+	bool member = false;
+	read(db, [&](Storage& redis) { member = redis.sIsMember(db, value); });
+
+	return member;
+}
+
+void FailoverStorage::sMembers(		const std::string& db, 
+									std::set<std::string>& output)
+{
+	read(db, [&](Storage& redis) { redis.sMembers(db, output); });
+}
+
+// При недоступности Redis возвращается ИН по текущему времени, при повторе Redis назначит свой
+std::string FailoverStorage::xAdd(	const std::string& db, 
+									const Fields& fields)
+{
+	std::string id;
+	if (!write([&](Storage& redis) { id = redis.xAdd(db, fields); }, 
+		[&]()
+		{
+			Record record{ Operation::OP_XADD, { db } };
+			for (const auto& [field, value] : fields)
+			{
+				record.args.push_back(field);
+				record.args.push_back(value);
+			}
+
+			return record;
+		}))
+	{
+		auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+		id = std::to_string(now.count()) + "-0";
+	}
+
+	return id;
+}
+
+void FailoverStorage::xRange(		const std::string& db, 
+									const std::string& start, 
+									const std::string& end, 
+									long long count, 
+									std::vector<StreamItem>& output)
+{
+	read(db, [&](Storage& redis) { redis.xRange(db, start, end, count, output); });
+}
@@ -0,0 +1,144 @@
+#ifndef FAILOVERSTORAGE_H
+#define FAILOVERSTORAGE_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <shared_mutex>
+#include <functional>
+#include <cstdint>
+
+#include "Logger.h"
+#include "Storage.h"
+#include "JournalFile.h"
+
+
+// Хранилище в Redis, переживающее его недоступность
+// Записи, не дошедшие до Redis, дописываются в ограниченный журнал на диске и считаются успешными,
+// главный поток переподключается и повторяет журнал в том же порядке
+// Пока журнал не повторён, новые записи тоже идут в журнал, а чтение изменённых в нём хеш-таблиц
+// завершается ошибкой, чтобы книги в памяти не откатились к состоянию Redis
+// Повтор идёт без эксклюзивной блокировки, записи за это время встают в журнал за повторяемыми
+class FailoverStorage : public Storage
+{
+public:
+	// Создаёт соединение с основным хранилищем, бросает StorageUnavailable, если оно недоступно
+	using Connector = std::function<std::unique_ptr<Storage>()>;
+
+
+private:
+	enum Operation : uint8_t
+	{
+		OP_HSET	= 1,	// db, key, value
+		OP_HDEL	= 2,	// db, key
+		OP_XADD	= 3,	// db, поле, значение, ...
+		OP_BATCH= 4,	// тип, db, key, value, ... (тип "s" - HSET, "d" - HDEL)
+		OP_HINCRBY= 5	// db, key, приращение
+	};
+
+	using Record = JournalFile::Record;
+
+	static Logger m_log;
+
+	const Connector					m_connector;
+
+	// Общая блокировка - чтение из Redis, эксклюзивная - запись в Redis или журнал и смена соединения
+	std::shared_mutex				m_mtx;
+	std::unique_ptr<Storage>		m_primary;		// nullptr - Redis недоступен с запуска
+	bool							m_degraded	= false;	// записи идут в журнал, пока он не повторён
+	std::vector<Record>				m_records;		// журнал в памяти, без записей, которые сейчас повторяются
+	size_t							m_bytes		= 0;	// размер журнала на диске
+	std::unordered_set<std::string>	m_dirty;		// хеш-таблицы с записями в журнале
+	std::unordered_map<std::string, long long>	m_counters;	// последние известные значения hIncrBy
+
+	std::string						m_path;
+	JournalFile						m_file;
+
+
+	[[nodiscard]] std::unique_ptr<Storage> connect();
+	void load();
+
+	// Выполняет запись в Redis, при недоступности Redis или непустом журнале дописывает в журнал запись от record
+	// Запись в Redis, отметка его отказа и запись в журнал идут под одной эксклюзивной блокировкой,
+	// поэтому записи попадают в Redis и в журнал в порядке вызовов, после отказа все записи идут в журнал
+	// Возвращает false, если запись ушла в журнал
+	bool write(					const std::function<void(Storage&)>& function, 
+								const std::function<Record()>& record);
+
+	// Выполняет чтение из Redis
+	void read(					const std::string& db, 
+								const std::function<void(Storage&)>& function);
+
+	// Дописывает запись в журнал, вызывается под эксклюзивной блокировкой
+	void journal(				Record&& record);
+
+	// Отмечает хеш-таблицы, которые меняет запись журнала
+	static void markDirty(		std::unordered_set<std::string>& dirty, 
+								const Record& record);
+
+	// Переписывает файл журнала записями m_records, вызывается под эксклюзивной блокировкой
+	void rewrite();
+
+	// Повторяет запись журнала в Redis
+	void execute(				Storage& redis, 
+								const Record& record);
+
+
+public:
+	FailoverStorage(			const std::string& redisSocket, 
+								size_t poolSize, 
+								const std::string& dirName, 
+								const std::string& fileName);
+
+	// Основное хранилище создаётся connector, в тестах вместо Redis
+	FailoverStorage(			Connector connector, 
+								const std::string& dirName, 
+								const std::string& fileName);
+
+	bool hExists(				const std::string& db, 
+								const std::string& key) override;
+
+	bool hSet(					const std::string& db, 
+								const std::string& key, 
+								const std::string& value) override;
+
+	bool hDel(					const std::string& db, 
+								const std::string& key) override;
+
+	std::optional<std::string> hGet(const std::string& db, 
+								const std::string& key) override;
+
+	long long hIncrBy(			const std::string& db, 
+								const std::string& key, 
+								long long increment) override;
+
+	long long hGetAll(			const std::string& db, 
+								std::map<std::string, std::string>& output) override;
+
+	std::vector<bool> hBatch(	const std::vector<HashOp>& ops) override;
+
+	bool sIsMember(				const std::string& db, 
+								const std::string& value) override;
+
+	void sMembers(				const std::string& db, 
+								std::set<std::string>& output) override;
+
+	std::string xAdd(			const std::string& db, 
+								const Fields& fields) override;
+
+	void xRange(				const std::string& db, 
+								const std::string& start, 
+								const std::string& end, 
+								long long count, 
+								std::vector<StreamItem>& output) override;
+
+	void recover() override;
+
+};
+
+#endif // !FAILOVERSTORAGE_H
@@ -0,0 +1,157 @@
+#include "Heartbeat.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+#include <uwebsockets/App.h>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "PerSocketData.h"
+#include "LoopRegistry.h"
+#include "HeartbeatSettings.h"
+#include "Metrics.h"
+
+
+// Инициализация логгера
+Logger Heartbeat::m_log("Heartbeat", LoggerSettings::TYPE_LOG);
+
+
+Heartbeat::Heartbeat(			ServerLoop* loop, 
+								const std::string& context) : 
+	m_slots(HeartbeatSettings::INTERVAL_MS / HeartbeatSettings::TICK_MS), m_random(std::random_device{}()), m_context(context)
+{
+	if (!HeartbeatSettings::ENABLED)
+	{
+		return;
+	}
+
+	m_timer = us_create_timer(reinterpret_cast<us_loop_t*>(loop), 0, sizeof(Heartbeat*));
+	*static_cast<Heartbeat**>(us_timer_ext(m_timer)) = this;
+	us_timer_set(m_timer, onTick, HeartbeatSettings::TICK_MS, HeartbeatSettings::TICK_MS);
+}
+
+Heartbeat::~Heartbeat()
+{
+	stop();
+}
+
+
+// Монотонное время в микросекундах
+uint64_t Heartbeat::now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Heartbeat::onTick(			us_timer_t* timer)
+{
+	(*static_cast<Heartbeat**>(us_timer_ext(timer)))->tick();
+}
+
+// Отправляет пинги соединениям текущей ячейки и закрывает не отвечающие
+void Heartbeat::tick()
+{
+	std::vector<ServerSocket*>& slot = m_slots[m_cursor];
+	m_cursor = (m_cursor + 1) % m_slots.size();
+
+	uint64_t current = now();
+	uint64_t timeout = static_cast<uint64_t>(HeartbeatSettings::TIMEOUT_MS) * 1000;
+
+	// Закрытие вызывает .close, который меняет ячейку, поэтому закрываем после обхода
+	std::vector<ServerSocket*> dead;
+	for (auto* ws : slot)
+	{
+		HeartbeatState& state = ws->getUserData()->heartbeat;
+		if (current - state.lastPongUs > timeout)
+		{
+			dead.push_back(ws);
+
+			continue;
+		}
+
+		// В полезной нагрузке пинга - время отправки, клиент возвращает её в понге
+		char payload[sizeof(current)];
+		std::memcpy(payload, &current, sizeof(current));
+		ws->send(std::string_view(payload, sizeof(payload)), uWS::OpCode::PING);
+	}
+
+	for (auto* ws : dead)
+	{
+		Metrics::increment(Metrics::HEARTBEAT_REAPED);
+		m_log.info("No pong for " + std::to_string(HeartbeatSettings::TIMEOUT_MS) + " ms, closing the connection.", 
+			m_context + ws->getUserData()->userId, "Heartbeat::tick " + std::to_string(__LINE__));
+
+		ws->close();
+	}
+}
+
+
+// Добавляет соединение в случайную ячейку колеса
+void Heartbeat::add(			ServerSocket* ws)
+{
+	HeartbeatState& state = ws->getUserData()->heartbeat;
+	state.lastPongUs = now();
+	if (!HeartbeatSettings::ENABLED)
+	{
+		return;
+	}
+
+	std::uniform_int_distribution<size_t> distribution(0, m_slots.size() - 1);
+	state.slot = distribution(m_random);
+	state.index = m_slots[state.slot].size();
+	m_slots[state.slot].push_back(ws);
+}
+
+// Удаляет соединение из колеса, на его место переносится последнее соединение ячейки
+void Heartbeat::remove(			ServerSocket* ws)
+{
+	HeartbeatState& state = ws->getUserData()->heartbeat;
+	if (state.slot == HeartbeatState::NO_SLOT)
+	{
+		return;
+	}
+
+	std::vector<ServerSocket*>& slot = m_slots[state.slot];
+	auto* last = slot.back();
+	slot[state.index] = last;
+	last->getUserData()->heartbeat.index = state.index;
+	slot.pop_back();
+
+	state.slot = HeartbeatState::NO_SLOT;
+}
+
+// Запоминает время ответа и время оборота пинга
+void Heartbeat::pong(			ServerSocket* ws, 
+								std::string_view payload)
+{
+	HeartbeatState& state = ws->getUserData()->heartbeat;
+	uint64_t current = now();
+	state.lastPongUs = current;
+
+	uint64_t sent = 0;
+	if (payload.size() == sizeof(sent))
+	{
+		std::memcpy(&sent, payload.data(), sizeof(sent));
+		if (sent <= current)
+		{
+			state.rttUs = static_cast<uint32_t>(current - sent);
+			Metrics::observe(Metrics::PONG_RTT, state.rttUs);
+		}
+	}
+}
+
+// Останавливает таймер колеса
+void Heartbeat::stop()
+{
+	if (m_timer)
+	{
+		us_timer_close(m_timer);
+		m_timer = nullptr;
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#include <uwebsockets/App.h>
+
+#include "Logger.h"
+#include "PerSocketData.h"
+#include "LoopRegistry.h"
+
+
+// Пинги соединений одного цикла событий по колесу таймеров
+// Соединение попадает в случайную ячейку колеса и получает пинг раз за оборот,
+// поэтому пинги распределены по периоду равномерно, а не идут пачками
+class Heartbeat
+{
+private:
+	static Logger	m_log;
+
+	std::vector<std::vector<ServerSocket*>> m_slots;
+	size_t			m_cursor	= 0;
+	us_timer_t*		m_timer		= nullptr;
+	std::mt19937	m_random;
+	std::string		m_context;
+
+
+	static void onTick(			us_timer_t* timer);
+	void tick();
+
+
+public:
+	Heartbeat(					ServerLoop* loop, 
+								const std::string& context);
+	~Heartbeat();
+
+	Heartbeat(const Heartbeat&) = delete;
+	Heartbeat& operator=(const Heartbeat&) = delete;
+
+	// Монотонное время в микросекундах
+	static uint64_t now();
+
+	void add(					ServerSocket* ws);
+	// Удаляет соединение из колеса за O(1)
+	void remove(				ServerSocket* ws);
+	// Обрабатывает ответ на пинг и замеряет время оборота
+	void pong(					ServerSocket* ws, 
+								std::string_view payload);
+	// Останавливает таймер, чтобы цикл событий мог завершиться
+	void stop();
+
+};
+
+#endif // !HEARTBEAT_H
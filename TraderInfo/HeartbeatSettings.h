@@ -0,0 +1,26 @@
+#ifndef HEARTBEATSETTINGS_H
+#define HEARTBEATSETTINGS_H
+
+#include <cstddef>
+
+
+// Настройки проверки живости соединений
+namespace HeartbeatSettings
+{
+	// Собственные пинги по колесу таймеров вместо автоматических пингов uWS
+	const bool			ENABLED			(true);
+
+	// Период пинга одного соединения и шаг колеса, период делится на шаг нацело
+	const unsigned int	INTERVAL_MS		(30000U);
+	const unsigned int	TICK_MS			(100U);
+	// Соединение без ответа на пинги дольше этого времени закрывается
+	const unsigned int	TIMEOUT_MS		(75000U);
+
+	// Таймаут простоя uWS, страховка на случай остановки колеса
+	const unsigned short IDLE_TIMEOUT_S	(120U);
+
+	static_assert(INTERVAL_MS % TICK_MS == 0, "INTERVAL_MS must be a multiple of TICK_MS");
+
+}
+
+#endif // !HEARTBEATSETTINGS_H
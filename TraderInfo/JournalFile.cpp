@@ -0,0 +1,320 @@
+#include "JournalFile.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <system_error>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Storage.h"
+#include "Checksum.h"
+
+
+// Метка формата с контрольными суммами в начале файла
+static const std::string_view MAGIC{ "TIJ\x01", 4 };
+
+
+// Дописывает число в запись
+template <typename Number>
+static void put(std::string& out, Number value)
+{
+	out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Читает число или строку с длиной, false - файл кончился
+template <typename Number>
+static bool take(std::string_view& in, Number& value)
+{
+	if (in.size() < sizeof(value))
+	{
+		return false;
+	}
+	std::memcpy(&value, in.data(), sizeof(value));
+	in.remove_prefix(sizeof(value));
+
+	return true;
+}
+
+static bool take(std::string_view& in, std::string& value)
+{
+	uint32_t length = 0;
+	if (!take(in, length) || in.size() < length)
+	{
+		return false;
+	}
+	value.assign(in.data(), length);
+	in.remove_prefix(length);
+
+	return true;
+}
+
+// Читает операцию и аргументы одной записи
+// Количество аргументов не больше, чем поместится их длин в остаток файла
+static bool takeRecord(std::string_view& in, JournalFile::Record& record)
+{
+	uint32_t argc = 0;
+	if (!take(in, record.operation) || !take(in, argc) || argc > in.size() / sizeof(uint32_t))
+	{
+		return false;
+	}
+
+	record.args.resize(argc);
+	for (std::string& arg : record.args)
+	{
+		if (!take(in, arg))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+JournalFile::~JournalFile()
+{
+	close();
+}
+
+
+// Кодирует запись: операция, количество аргументов, аргументы с длинами и CRC-32 всего предыдущего
+void JournalFile::encode(		std::string& out, 
+								uint8_t operation, 
+								const std::vector<std::string_view>& args)
+{
+	size_t start = out.size();
+	put(out, operation);
+	put(out, static_cast<uint32_t>(args.size()));
+	for (std::string_view arg : args)
+	{
+		put(out, static_cast<uint32_t>(arg.size()));
+		out.append(arg);
+	}
+	put(out, Checksum::crc32(std::string_view(out).substr(start)));
+}
+
+// Читает записи файла
+bool JournalFile::read(			const std::string& path, 
+								std::vector<Record>& records)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return true;
+	}
+	std::ostringstream buffer;
+	buffer << file.rdbuf();
+	const std::string content = buffer.str();
+
+	std::string_view in(content);
+	bool checked = in.substr(0, MAGIC.size()) == MAGIC;
+	if (checked)
+	{
+		in.remove_prefix(MAGIC.size());
+	}
+
+	while (!in.empty())
+	{
+		std::string_view start = in;
+		Record record;
+		if (!takeRecord(in, record))
+		{
+			return false;
+		}
+
+		if (checked)
+		{
+			uint32_t crc = 0;
+			std::string_view body = start.substr(0, start.size() - in.size());
+			if (!take(in, crc) || crc != Checksum::crc32(body))
+			{
+				return false;
+			}
+		}
+		records.push_back(std::move(record));
+	}
+
+	return true;
+}
+
+// Записывает файл заново через временный файл
+void JournalFile::replace(		const std::string& path, 
+								std::string_view records)
+{
+	JournalFile file;
+	file.open(tempPath(path), true);
+	file.write(records);
+	file.moveTo(path);
+}
+
+std::string JournalFile::tempPath(const std::string& path)
+{
+	return path + ".tmp";
+}
+
+// Переименовывает сброшенный на диск файл, файл закрывается до переименования
+void JournalFile::moveTo(		const std::string& path)
+{
+	close();
+
+	std::error_code error;
+	std::filesystem::rename(m_path, path, error);
+	if (error)
+	{
+		throw StorageError("Failed to replace the file \"" + path + "\": " + error.message());
+	}
+	m_path = path;
+}
+
+// Открывает файл для дописывания
+void JournalFile::open(			const std::string& path, 
+								bool truncate)
+{
+	close();
+	m_path = path;
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, 
+		truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER size{};
+	if (file == INVALID_HANDLE_VALUE || !SetFilePointerEx(file, LARGE_INTEGER{}, &size, FILE_END))
+	{
+		DWORD error = GetLastError();
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+		throw StorageError("Failed to open the file \"" + path + "\", error " + std::to_string(error));
+	}
+	m_file = file;
+	m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+	m_file = ::open(path.c_str(), O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+	off_t size = (m_file < 0) ? -1 : ::lseek(m_file, 0, SEEK_END);
+	if (size < 0)
+	{
+		int error = errno;
+		close();
+		throw StorageError("Failed to open the file \"" + path + "\": " + std::strerror(error));
+	}
+	m_size = static_cast<uint64_t>(size);
+#endif
+
+	if (truncate)
+	{
+		write(MAGIC);
+	}
+}
+
+// Дописывает данные и сбрасывает их на диск
+void JournalFile::write(		std::string_view data)
+{
+	const uint64_t length = data.size();
+#if defined(_WIN32)
+	while (!data.empty())
+	{
+		DWORD written = 0;
+		if (!WriteFile(static_cast<HANDLE>(m_file), data.data(), static_cast<DWORD>(data.size()), &written, nullptr))
+		{
+			rollback();
+			throw StorageError("Failed to write the file \"" + m_path + "\", error " + std::to_string(GetLastError()));
+		}
+		data.remove_prefix(written);
+	}
+	if (!FlushFileBuffers(static_cast<HANDLE>(m_file)))
+	{
+		rollback();
+		throw StorageError("Failed to sync the file \"" + m_path + "\", error " + std::to_string(GetLastError()));
+	}
+#else
+	while (!data.empty())
+	{
+		ssize_t written = ::write(m_file, data.data(), data.size());
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			int error = errno;
+			rollback();
+			throw StorageError("Failed to write the file \"" + m_path + "\": " + std::strerror(error));
+		}
+		data.remove_prefix(static_cast<size_t>(written));
+	}
+#if defined(__linux__)
+	int synced = ::fdatasync(m_file);
+#else
+	int synced = ::fsync(m_file);
+#endif
+	if (synced != 0)
+	{
+		int error = errno;
+		rollback();
+		throw StorageError("Failed to sync the file \"" + m_path + "\": " + std::strerror(error));
+	}
+#endif
+
+	m_size += length;
+}
+
+// Следующая запись начнётся с конца последней целой, а не за обрывком
+void JournalFile::rollback()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER size{};
+	size.QuadPart = static_cast<LONGLONG>(m_size);
+	SetFilePointerEx(static_cast<HANDLE>(m_file), size, nullptr, FILE_BEGIN);
+	SetEndOfFile(static_cast<HANDLE>(m_file));
+#else
+	if (::ftruncate(m_file, static_cast<off_t>(m_size)) == 0)
+	{
+		::lseek(m_file, static_cast<off_t>(m_size), SEEK_SET);
+	}
+#endif
+}
+
+void JournalFile::append(		uint8_t operation, 
+								const std::vector<std::string_view>& args)
+{
+	std::string record;
+	encode(record, operation, args);
+	write(record);
+}
+
+void JournalFile::close()
+{
+	if (!isOpen())
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	CloseHandle(static_cast<HANDLE>(m_file));
+	m_file = nullptr;
+#else
+	::close(m_file);
+	m_file = -1;
+#endif
+}
+
+bool JournalFile::isOpen() const
+{
+#if defined(_WIN32)
+	return m_file != nullptr;
+#else
+	return m_file >= 0;
+#endif
+}
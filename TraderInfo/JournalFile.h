@@ -0,0 +1,87 @@
+#ifndef JOURNALFILE_H
+#define JOURNALFILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+
+// Журнал записей хранилища на диске
+// Файл начинается с метки формата, запись - операция, аргументы с длинами и CRC-32 записи
+// Каждая дописанная запись сбрасывается на диск до возврата из append
+class JournalFile
+{
+public:
+	// Запись, прочитанная с диска
+	struct Record
+	{
+		uint8_t						operation	= 0;
+		std::vector<std::string>	args;
+	};
+
+
+private:
+	std::string		m_path;
+	uint64_t		m_size	= 0;		// длина целых записей в файле
+#if defined(_WIN32)
+	void*			m_file	= nullptr;	// HANDLE
+#else
+	int				m_file	= -1;
+#endif
+
+
+	// Обрезает файл до длины целых записей после неудачной записи
+	void rollback();
+
+
+public:
+	JournalFile() = default;
+	~JournalFile();
+
+	JournalFile(const JournalFile&) = delete;
+	JournalFile& operator=(const JournalFile&) = delete;
+
+	// Кодирует запись журнала и дописывает её в строку
+	static void encode(			std::string& out, 
+								uint8_t operation, 
+								const std::vector<std::string_view>& args);
+
+	// Читает записи файла до конца или до первой оборванной либо повреждённой записи
+	// Длины в записи ограничены остатком файла, файл без метки читается в прежнем формате без контрольных сумм
+	// std::vector<Record>& records - параметр вывода
+	// Возвращает false, если часть файла отброшена
+	static bool read(			const std::string& path, 
+								std::vector<Record>& records);
+
+	// Записывает файл заново с меткой формата и заданными записями через временный файл,
+	// старый файл заменяется только после сброса нового на диск
+	static void replace(		const std::string& path, 
+								std::string_view records);
+
+	// Временный файл, через который заменяется файл path
+	static std::string tempPath(const std::string& path);
+
+	// Открывает файл для дописывания, truncate - начать пустой файл с меткой формата
+	// При ошибке бросает StorageError
+	void open(					const std::string& path, 
+								bool truncate);
+
+	// Дописывает закодированные записи и сбрасывает их на диск
+	// При ошибке файл обрезается до прежней длины и бросается StorageError
+	void write(					std::string_view data);
+
+	void append(				uint8_t operation, 
+								const std::vector<std::string_view>& args);
+
+	// Закрывает файл и переименовывает его в path, старый файл path заменяется
+	// При ошибке бросает StorageError
+	void moveTo(				const std::string& path);
+
+	void close();
+
+	bool isOpen() const;
+
+};
+
+#endif // !JOURNALFILE_H
@@ -0,0 +1,32 @@
+#ifndef LIMITSETTINGS_H
+#define LIMITSETTINGS_H
+
+#include <string>
+
+
+// Настройки ограничения частоты подключений и авторизаций
+// Лимиты действуют в пределах процесса, таблицы общие для всех циклов событий
+namespace LimitSettings
+{
+	// Подключения и попытки авторизации с одного IP
+	const double		IP_RATE		(5.0);		// токенов в секунду
+	const double		IP_BURST	(20.0);		// максимальный запас токенов
+
+	// Попытки авторизации по одному логину
+	const double		LOGIN_RATE	(0.5);
+	const double		LOGIN_BURST	(5.0);
+
+	// Количество корзин в таблице процесса (степень двойки)
+	const size_t		TABLE_SIZE	(32768U);
+	// Количество частей таблицы со своей блокировкой (степень двойки)
+	const size_t		STRIPES		(64U);
+	// Количество проверяемых ячеек при поиске корзины
+	const size_t		PROBES		(8U);
+	// Длина ключа, хранимая в корзине, длинные ключи сравниваются по началу и хешу
+	const size_t		KEY_LEN		(48U);
+
+	const std::string	HTTP_STATUS	{ "429 Too Many Requests" };
+
+}
+
+#endif // !LIMITSETTINGS_H
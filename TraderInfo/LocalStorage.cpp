@@ -0,0 +1,637 @@
+#include "LocalStorage.h"
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <charconv>
+#include <cstdint>
+#include <cstddef>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "DaoSettings.h"
+#include "ChannelSettings.h"
+
+
+// Инициализация логгера
+Logger LocalStorage::m_log("LocalStorage", LoggerSettings::TYPE_LOG);
+
+
+// Типы операций в пакетной записи журнала
+static const std::string_view BATCH_SET{ "s" };
+static const std::string_view BATCH_DEL{ "d" };
+
+
+// Формирует ИН записи потока
+static std::string formatId(uint64_t ms, uint64_t seq)
+{
+	return std::to_string(ms) + "-" + std::to_string(seq);
+}
+
+// Разбирает ИН записи потока, ИН без номера означает начало или конец миллисекунды
+static void parseId(const std::string& id, bool isEnd, uint64_t& ms, uint64_t& seq)
+{
+	if (id == "-")
+	{
+		ms = 0;
+		seq = 0;
+
+		return;
+	}
+	if (id == "+")
+	{
+		ms = std::numeric_limits<uint64_t>::max();
+		seq = std::numeric_limits<uint64_t>::max();
+
+		return;
+	}
+
+	try
+	{
+		size_t dash = id.find('-');
+		ms = std::stoull(id.substr(0, dash));
+		seq = (dash == std::string::npos) ? (isEnd ? std::numeric_limits<uint64_t>::max() : 0) : std::stoull(id.substr(dash + 1));
+	}
+	catch (const std::logic_error&)
+	{
+		throw StorageError("Invalid stream ID \"" + id + '"');
+	}
+}
+
+
+LocalStorage::LocalStorage(		const std::string& dirName, 
+								const std::string& fileName) : m_path(dirName + "/" + fileName)
+{
+	// Проверяем наличие директории для данных
+	if (!std::filesystem::exists(dirName))
+	{
+		std::filesystem::create_directories(dirName);
+	}
+
+	load();
+
+	// Журнал переписывается, чтобы отбросить повреждённый хвост и устаревшие записи
+	compact();
+}
+
+
+// Воспроизводит журнал с диска
+void LocalStorage::load()
+{
+	if (!std::filesystem::exists(m_path))
+	{
+		m_log.info("The storage file \"" + m_path + "\" does not exist, starting empty.", 
+			m_log.getContext(), "LocalStorage::load " + std::to_string(__LINE__));
+
+		return;
+	}
+
+	std::vector<JournalFile::Record> records;
+	if (!JournalFile::read(m_path, records))
+	{
+		m_log.warn("The storage file \"" + m_path + "\" ends with an incomplete or damaged record, it is dropped.", 
+			m_log.getContext(), "LocalStorage::load " + std::to_string(__LINE__));
+	}
+
+	for (const JournalFile::Record& record : records)
+	{
+		apply(static_cast<Operation>(record.operation), record.args);
+	}
+	m_records = records.size();
+
+	m_log.info("Loaded " + std::to_string(m_records) + " record(s) from \"" + m_path + '"', 
+		m_log.getContext(), "LocalStorage::load " + std::to_string(__LINE__));
+}
+
+// Применяет операцию к данным в памяти
+void LocalStorage::apply(		Operation operation, 
+								const std::vector<std::string>& args)
+{
+	switch (operation)
+	{
+	case Operation::OP_HSET:
+		if (args.size() == 3)
+		{
+			m_hashes[args[0]][args[1]] = args[2];
+		}
+		break;
+	case Operation::OP_HDEL:
+		if (args.size() == 2)
+		{
+			auto hash = m_hashes.find(args[0]);
+			if (hash != m_hashes.end())
+			{
+				hash->second.erase(args[1]);
+			}
+		}
+		break;
+	case Operation::OP_SADD:
+		if (args.size() == 2)
+		{
+			m_sets[args[0]].insert(args[1]);
+		}
+		break;
+	case Operation::OP_XADD:
+		if (args.size() >= 2 && args.size() % 2 == 0)
+		{
+			StreamEntry entry;
+			parseId(args[1], false, entry.ms, entry.seq);
+			for (size_t index = 2; index < args.size(); index += 2)
+			{
+				entry.fields.emplace_back(args[index], args[index + 1]);
+			}
+			std::vector<StreamEntry>& stream = m_streams[args[0]];
+			stream.push_back(std::move(entry));
+			trim(stream);
+		}
+		break;
+	case Operation::OP_BATCH:
+		if (args.size() % 4 == 0)
+		{
+			for (size_t index = 0; index < args.size(); index += 4)
+			{
+				if (args[index] == BATCH_DEL)
+				{
+					apply(Operation::OP_HDEL, { args[index + 1], args[index + 2] });
+				}
+				else
+				{
+					apply(Operation::OP_HSET, { args[index + 1], args[index + 2], args[index + 3] });
+				}
+			}
+		}
+		break;
+	default:
+		m_log.warn("Unknown operation in the storage file: " + std::to_string(operation), 
+			m_log.getContext(), "LocalStorage::apply " + std::to_string(__LINE__));
+		break;
+	}
+}
+
+// Дописывает операцию в журнал, вызывается под эксклюзивной блокировкой до изменения данных
+void LocalStorage::append(		Operation operation, 
+								const std::vector<std::string_view>& args)
+{
+	std::string record;
+	JournalFile::encode(record, operation, args);
+	m_file.write(record);
+	++m_records;
+
+	if (m_compacting)
+	{
+		m_tail += record;
+		++m_tailRecords;
+	}
+}
+
+// Удаляет старые записи потока пачкой, когда длина превышает DaoSettings::HISTORY_MAXLEN на шестнадцатую часть,
+// записи остаются в журнале до его сжатия
+void LocalStorage::trim(		std::vector<StreamEntry>& stream)
+{
+	const size_t limit = static_cast<size_t>(DaoSettings::HISTORY_MAXLEN);
+	if (stream.size() > limit + limit / 16)
+	{
+		stream.erase(stream.begin(), stream.end() - static_cast<std::ptrdiff_t>(limit));
+	}
+}
+
+// Сжимает журнал, когда устаревших записей становится больше живых
+// Под блокировкой собирается только снимок, запись нового файла и сброс на диск идут без неё,
+// изменения за это время дописываются в старый журнал и в хвост, который переносится в новый файл перед подменой
+// Изменения уже на диске, поэтому ошибка сжатия только записывается в лог
+void LocalStorage::maintain()
+{
+	std::string encoded;
+	size_t records = 0;
+	{
+		std::unique_lock ul(m_mtx);
+		if (m_compacting || m_records <= DaoSettings::COMPACT_MIN || m_records <= DaoSettings::COMPACT_FACTOR * liveRecords())
+		{
+			return;
+		}
+
+		encoded = snapshot();
+		records = liveRecords();
+		m_compacting = true;
+	}
+
+	JournalFile file;
+	bool written = false;
+	try
+	{
+		file.open(JournalFile::tempPath(m_path), true);
+		file.write(encoded);
+		written = true;
+	}
+	catch (const StorageError& err)
+	{
+		m_log.error("Failed to compact the storage file: " + std::string(err.what()), 
+			m_log.getContext(), "LocalStorage::maintain " + std::to_string(__LINE__));
+	}
+
+	std::unique_lock ul(m_mtx);
+
+	try
+	{
+		if (written)
+		{
+			file.write(m_tail);
+			install(file, records + m_tailRecords);
+		}
+	}
+	catch (const StorageError& err)
+	{
+		m_log.error("Failed to compact the storage file: " + std::string(err.what()), 
+			m_log.getContext(), "LocalStorage::maintain " + std::to_string(__LINE__));
+	}
+	m_compacting = false;
+	m_tail.clear();
+	m_tailRecords = 0;
+}
+
+// Количество записей, необходимых для восстановления текущего состояния
+size_t LocalStorage::liveRecords() const
+{
+	size_t count = 0;
+	for (const auto& hash : m_hashes)
+	{
+		count += hash.second.size();
+	}
+	for (const auto& set : m_sets)
+	{
+		count += set.second.size();
+	}
+	for (const auto& stream : m_streams)
+	{
+		count += stream.second.size();
+	}
+
+	return count;
+}
+
+// Кодирует хеши, множества и потоки записями журнала
+std::string LocalStorage::snapshot() const
+{
+	std::string encoded;
+	for (const auto& [db, hash] : m_hashes)
+	{
+		for (const auto& [key, value] : hash)
+		{
+			JournalFile::encode(encoded, Operation::OP_HSET, { db, key, value });
+		}
+	}
+	for (const auto& [db, set] : m_sets)
+	{
+		for (const auto& value : set)
+		{
+			JournalFile::encode(encoded, Operation::OP_SADD, { db, value });
+		}
+	}
+	for (const auto& [db, stream] : m_streams)
+	{
+		for (const auto& entry : stream)
+		{
+			std::string id = formatId(entry.ms, entry.seq);
+			std::vector<std::string_view> args{ db, id };
+			for (const auto& [field, value] : entry.fields)
+			{
+				args.push_back(field);
+				args.push_back(value);
+			}
+			JournalFile::encode(encoded, Operation::OP_XADD, args);
+		}
+	}
+
+	return encoded;
+}
+
+// Переписывает журнал текущим состоянием и атомарно заменяет старый файл
+void LocalStorage::compact()
+{
+	JournalFile file;
+	file.open(JournalFile::tempPath(m_path), true);
+	file.write(snapshot());
+	install(file, liveRecords());
+}
+
+// Старый файл остаётся на месте и открытым для записи, если новый не удалось переименовать
+void LocalStorage::install(		JournalFile& file, 
+								size_t records)
+{
+	m_file.close();
+	try
+	{
+		file.moveTo(m_path);
+	}
+	catch (const StorageError&)
+	{
+		m_file.open(m_path, false);
+		throw;
+	}
+	m_file.open(m_path, false);
+	m_records = records;
+}
+
+
+// Проверяет, есть ли в хранилище данные
+bool LocalStorage::empty()
+{
+	std::shared_lock sl(m_mtx);
+
+	return m_hashes.empty() && m_sets.empty() && m_streams.empty();
+}
+
+// Копирует пользователей, администраторов, сигналы и каналы из другого хранилища
+// Источник читается целиком до первой записи, чтобы его отказ не оставил хранилище заполненным наполовину
+void LocalStorage::importFrom(	Storage& source)
+{
+	std::map<std::string, std::map<std::string, std::string>> hashes;
+	std::map<std::string, std::set<std::string>> sets;
+
+	source.hGetAll(DaoSettings::USERS_DB, hashes[DaoSettings::USERS_DB]);
+	source.hGetAll(DaoSettings::SIGNALS_DB, hashes[DaoSettings::SIGNALS_DB]);
+	source.sMembers(DaoSettings::ADMINS_DB, sets[DaoSettings::ADMINS_DB]);
+
+	// Каналы сигналов с их сигналами и участниками
+	std::set<std::string>& channels = sets[ChannelSettings::CHANNELS_DB];
+	source.sMembers(ChannelSettings::CHANNELS_DB, channels);
+	for (const auto& channel : channels)
+	{
+		std::string prefix = ChannelSettings::KEY_PREFIX + channel + ChannelSettings::KEY_SEP;
+		source.hGetAll(prefix + DaoSettings::SIGNALS_DB, hashes[prefix + DaoSettings::SIGNALS_DB]);
+		source.sMembers(prefix + ChannelSettings::USERS_SUFFIX, sets[prefix + ChannelSettings::USERS_SUFFIX]);
+		source.sMembers(prefix + ChannelSettings::ADMINS_SUFFIX, sets[prefix + ChannelSettings::ADMINS_SUFFIX]);
+	}
+
+	size_t count = 0;
+	for (const auto& [db, values] : hashes)
+	{
+		for (const auto& [key, value] : values)
+		{
+			hSet(db, key, value);
+		}
+		count += values.size();
+	}
+	for (const auto& [db, members] : sets)
+	{
+		for (const auto& member : members)
+		{
+			sAdd(db, member);
+		}
+		count += members.size();
+	}
+
+	m_log.info("Imported " + std::to_string(count) + " record(s) into the local storage.", 
+		m_log.getContext(), "LocalStorage::importFrom " + std::to_string(__LINE__));
+}
+
+bool LocalStorage::sAdd(		const std::string& db, 
+								const std::string& value)
+{
+	std::unique_lock ul(m_mtx);
+
+	std::unordered_set<std::string>& set = m_sets[db];
+	if (set.count(value))
+	{
+		return false;
+	}
+	append(Operation::OP_SADD, { db, value });
+	set.insert(value);
+
+	return true;
+}
+
+
+bool LocalStorage::hExists(		const std::string& db, 
+								const std::string& key)
+{
+	std::shared_lock sl(m_mtx);
+
+	auto hash = m_hashes.find(db);
+
+	return hash != m_hashes.end() && hash->second.count(key);
+}
+
+bool LocalStorage::hSet(		const std::string& db, 
+								const std::string& key, 
+								const std::string& value)
+{
+	std::unique_lock ul(m_mtx);
+
+	append(Operation::OP_HSET, { db, key, value });
+	auto [position, created] = m_hashes[db].insert_or_assign(key, value);
+
+	return created;
+}
+
+bool LocalStorage::hDel(		const std::string& db, 
+								const std::string& key)
+{
+	std::unique_lock ul(m_mtx);
+
+	auto hash = m_hashes.find(db);
+	if (hash == m_hashes.end() || !hash->second.count(key))
+	{
+		return false;
+	}
+	append(Operation::OP_HDEL, { db, key });
+	hash->second.erase(key);
+
+	return true;
+}
+
+std::optional<std::string> LocalStorage::hGet(const std::string& db, 
+								const std::string& key)
+{
+	std::shared_lock sl(m_mtx);
+
+	auto hash = m_hashes.find(db);
+	if (hash == m_hashes.end())
+	{
+		return std::nullopt;
+	}
+	auto value = hash->second.find(key);
+	if (value == hash->second.end())
+	{
+		return std::nullopt;
+	}
+
+	return value->second;
+}
+
+long long LocalStorage::hIncrBy(const std::string& db, 
+								const std::string& key, 
+								long long increment)
+{
+	std::unique_lock ul(m_mtx);
+
+	long long number = 0;
+	auto hash = m_hashes.find(db);
+	if (hash != m_hashes.end())
+	{
+		auto current = hash->second.find(key);
+		if (current != hash->second.end() && !current->second.empty())
+		{
+			const std::string& value = current->second;
+			auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+			if (error != std::errc() || end != value.data() + value.size())
+			{
+				throw StorageError("Hash value is not an integer: " + db + ' ' + key);
+			}
+		}
+	}
+	std::string value = std::to_string(number + increment);
+	// В журнал пишется итоговое значение, повтор журнала не зависит от порядка
+	append(Operation::OP_HSET, { db, key, value });
+	m_hashes[db][key] = std::move(value);
+
+	return number + increment;
+}
+
+std::vector<bool> LocalStorage::hBatch(const std::vector<HashOp>& ops)
+{
+	std::unique_lock ul(m_mtx);
+
+	std::vector<std::string_view> args;
+	args.reserve(ops.size() * 4);
+	for (const HashOp& op : ops)
+	{
+		args.insert(args.end(), { op.type == HashOpType::HASH_DEL ? BATCH_DEL : BATCH_SET, op.db, op.key, op.value });
+	}
+	// Пакет пишется одной записью, оборванная запись при загрузке отбрасывается целиком
+	append(Operation::OP_BATCH, args);
+
+	std::vector<bool> results;
+	results.reserve(ops.size());
+	for (const HashOp& op : ops)
+	{
+		if (op.type == HashOpType::HASH_DEL)
+		{
+			auto hash = m_hashes.find(op.db);
+			results.push_back(hash != m_hashes.end() && hash->second.erase(op.key) > 0);
+		}
+		else
+		{
+			results.push_back(m_hashes[op.db].insert_or_assign(op.key, op.value).second);
+		}
+	}
+
+	return results;
+}
+
+long long LocalStorage::hGetAll(const std::string& db, 
+								std::map<std::string, std::string>& output)
+{
+	std::shared_lock sl(m_mtx);
+
+	auto hash = m_hashes.find(db);
+	if (hash != m_hashes.end())
+	{
+		output.insert(hash->second.begin(), hash->second.end());
+	}
+
+	return static_cast<long long>(output.size());
+}
+
+bool LocalStorage::sIsMember(	const std::string& db, 
+								const std::string& value)
+{
+	std::shared_lock sl(m_mtx);
+
+	auto set = m_sets.find(db);
+
+	return set != m_sets.end() && set->second.count(value);
+}
+
+void LocalStorage::sMembers(	const std::string& db, 
+								std::set<std::string>& output)
+{
+	std::shared_lock sl(m_mtx);
+
+	auto set = m_sets.find(db);
+	if (set != m_sets.end())
+	{
+		output.insert(set->second.begin(), set->second.end());
+	}
+}
+
+std::string LocalStorage::xAdd(	const std::string& db, 
+								const Fields& fields)
+{
+	std::unique_lock ul(m_mtx);
+
+	// ИН растут монотонно, даже если часы отстали
+	auto stream = m_streams.find(db);
+	StreamEntry entry;
+	entry.ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	if (stream != m_streams.end() && !stream->second.empty() && entry.ms <= stream->second.back().ms)
+	{
+		entry.ms = stream->second.back().ms;
+		entry.seq = stream->second.back().seq + 1;
+	}
+	entry.fields = fields;
+
+	std::string id = formatId(entry.ms, entry.seq);
+	std::vector<std::string_view> args{ db, id };
+	for (const auto& [field, value] : fields)
+	{
+		args.push_back(field);
+		args.push_back(value);
+	}
+	append(Operation::OP_XADD, args);
+
+	std::vector<StreamEntry>& entries = m_streams[db];
+	entries.push_back(std::move(entry));
+	trim(entries);
+
+	return id;
+}
+
+void LocalStorage::xRange(		const std::string& db, 
+								const std::string& start, 
+								const std::string& end, 
+								long long count, 
+								std::vector<StreamItem>& output)
+{
+	uint64_t startMs = 0;
+	uint64_t startSeq = 0;
+	uint64_t endMs = 0;
+	uint64_t endSeq = 0;
+	parseId(start, false, startMs, startSeq);
+	parseId(end, true, endMs, endSeq);
+
+	std::shared_lock sl(m_mtx);
+
+	auto stream = m_streams.find(db);
+	if (stream == m_streams.end())
+	{
+		return;
+	}
+
+	// Записи потока упорядочены по ИН
+	auto position = std::lower_bound(stream->second.begin(), stream->second.end(), std::make_pair(startMs, startSeq), 
+		[](const StreamEntry& entry, const std::pair<uint64_t, uint64_t>& id)
+		{
+			return std::make_pair(entry.ms, entry.seq) < id;
+		}
+	);
+
+	for (; position != stream->second.end() && count > 0; ++position, --count)
+	{
+		if (std::make_pair(position->ms, position->seq) > std::make_pair(endMs, endSeq))
+		{
+			break;
+		}
+		output.push_back({ formatId(position->ms, position->seq), position->fields });
+	}
+}
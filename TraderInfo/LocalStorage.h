@@ -0,0 +1,133 @@
+#ifndef LOCALSTORAGE_H
+#define LOCALSTORAGE_H
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <shared_mutex>
+#include <cstdint>
+
+#include "Logger.h"
+#include "Storage.h"
+#include "JournalFile.h"
+
+
+// Встроенное хранилище процесса
+// Данные хранятся в памяти, каждое изменение сначала дописывается в журнал на диске и только потом применяется,
+// поэтому ошибка записи не оставляет в памяти изменений, которых нет на диске
+// При запуске журнал воспроизводится, а при разрастании главный поток сжимает его до текущего состояния
+class LocalStorage : public Storage
+{
+private:
+	enum Operation : uint8_t
+	{
+		OP_HSET	= 1,	// db, key, value
+		OP_HDEL	= 2,	// db, key
+		OP_SADD	= 3,	// db, value
+		OP_XADD	= 4,	// db, id, поле, значение, ...
+		OP_BATCH= 5		// тип, db, key, value, ... (тип "s" - HSET, "d" - HDEL)
+	};
+
+	struct StreamEntry
+	{
+		uint64_t	ms	= 0;
+		uint64_t	seq	= 0;
+		Fields		fields;
+	};
+
+	static Logger m_log;
+
+	std::shared_mutex m_mtx;
+
+	std::unordered_map<std::string, std::unordered_map<std::string, std::string>>	m_hashes;
+	std::unordered_map<std::string, std::unordered_set<std::string>>				m_sets;
+	std::unordered_map<std::string, std::vector<StreamEntry>>						m_streams;
+
+	std::string		m_path;
+	JournalFile		m_file;
+	size_t			m_records = 0;	// количество записей в журнале
+	// Записи, дописанные во время сжатия, переносятся в новый файл перед подменой
+	bool			m_compacting = false;
+	std::string		m_tail;
+	size_t			m_tailRecords = 0;
+
+
+	void load();
+	void apply(					Operation operation, 
+								const std::vector<std::string>& args);
+	// Дописывает операцию в журнал, при ошибке бросает StorageError
+	void append(				Operation operation, 
+								const std::vector<std::string_view>& args);
+	// Кодирует текущее состояние записями журнала, вызывается под блокировкой
+	std::string snapshot() const;
+	// Переписывает журнал текущим состоянием, вызывается при запуске
+	void compact();
+	// Подменяет журнал записанным файлом, вызывается под эксклюзивной блокировкой
+	void install(				JournalFile& file, 
+								size_t records);
+	size_t liveRecords() const;
+	// Удаляет старые записи потока, как XADD MAXLEN ~
+	static void trim(			std::vector<StreamEntry>& stream);
+
+
+public:
+	LocalStorage(				const std::string& dirName, 
+								const std::string& fileName);
+
+	bool empty();
+
+	// Сжимает журнал, если устаревших записей стало больше живых
+	void maintain() override;
+
+	// Копирует пользователей, администраторов и сигналы из другого хранилища
+	// Всё читается до первой записи, поэтому при ошибке источника хранилище остаётся пустым
+	void importFrom(			Storage& source);
+
+	bool sAdd(					const std::string& db, 
+								const std::string& value);
+
+	bool hExists(				const std::string& db, 
+								const std::string& key) override;
+
+	bool hSet(					const std::string& db, 
+								const std::string& key, 
+								const std::string& value) override;
+
+	bool hDel(					const std::string& db, 
+								const std::string& key) override;
+
+	std::optional<std::string> hGet(const std::string& db, 
+								const std::string& key) override;
+
+	long long hIncrBy(			const std::string& db, 
+								const std::string& key, 
+								long long increment) override;
+
+	long long hGetAll(			const std::string& db, 
+								std::map<std::string, std::string>& output) override;
+
+	std::vector<bool> hBatch(	const std::vector<HashOp>& ops) override;
+
+	bool sIsMember(				const std::string& db, 
+								const std::string& value) override;
+
+	void sMembers(				const std::string& db, 
+								std::set<std::string>& output) override;
+
+	std::string xAdd(			const std::string& db, 
+								const Fields& fields) override;
+
+	void xRange(				const std::string& db, 
+								const std::string& start, 
+								const std::string& end, 
+								long long count, 
+								std::vector<StreamItem>& output) override;
+
+};
+
+#endif // !LOCALSTORAGE_H
@@ -6,13 +6,13 @@
 #include "Logger.h"
 
 
-//  
+// Настройки логирования
 namespace LoggerSettings
 {
 	const std::string LOG_DIR { "../log" };
 	const std::string LOG_FILE{ "log.log" };
 
-	//  
+	// Уровень логирования
 	const log4cpp::Priority::PriorityLevel  PRIORITY{ log4cpp::Priority::DEBUG };
 
 }
@@ -13,17 +13,17 @@
 #include <log4cpp/NDC.hh>
 
 
-//      
+// Инициализация логгера для вывода в консоль
 void Logger::appenderInit(	std::ostream* outStream)
 {
 	m_appender = new log4cpp::OstreamAppender("console", outStream);
 }
 
-//      
+// Инициализация логгера для вывода в файл
 void Logger::appenderInit(	const std::string& dirName, 
 							const std::string& fileName)
 {
-	//     
+	// Проверка существования директории для логирования
 	if (!std::filesystem::exists(dirName))
 	{
 		std::filesystem::create_directories(dirName);
@@ -33,10 +33,10 @@ void Logger::appenderInit(	const std::string& dirName,
 }
 
 
-//       
+// Генератор контекста на базе номеров исполняемых потоков
 std::string Logger::getContext()
 {
-	//   
+	// Формируем сообщение контекста
 	std::ostringstream oss;
 	oss << std::this_thread::get_id();
 	
@@ -44,7 +44,7 @@ std::string Logger::getContext()
 }
 
 
-//    
+// Методы логирования по уровням
 void Logger::publish(void (log4cpp::Category::*ptr)(const std::string&), 
 					const std::string& message, 
 					const std::string& context1, 
@@ -52,17 +52,17 @@ void Logger::publish(void (log4cpp::Category::*ptr)(const std::string&),
 {
 	if (context1 != "")
 	{
-		//   
+		// Задаём первый контекст
 		log4cpp::NDC::push(context1);
 
 		if (context2 != "")
 		{
-			//   
+			// Задаём второй контекст
 			log4cpp::NDC::push(context2);
 
 			(this->m_category->*ptr)(message);
 
-			//   
+			// Удаляем второй контекст
 			log4cpp::NDC::pop();
 		}
 		else
@@ -70,7 +70,7 @@ void Logger::publish(void (log4cpp::Category::*ptr)(const std::string&),
 			(this->m_category->*ptr)(message);
 		}
 
-		//   
+		// Удаляем первый контекст
 		log4cpp::NDC::pop();
 	}
 	else
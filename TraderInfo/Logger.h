@@ -15,7 +15,7 @@
 #include "LogSettings.h"
 
 
-//    
+// Класс логирования работы приложения
 class Logger
 {
 public:
@@ -49,7 +49,7 @@ public:
 						TypeLog type = TypeLog::FILE, 
 						const std::string& fileName = LoggerSettings::LOG_FILE)
 	{
-		//   
+		// Способ сохранения логов
 		switch (type)
 		{
 		case TypeLog::FILE:
@@ -65,16 +65,16 @@ public:
 			appenderInit(&std::clog);
 			break;
 		default:
-			//  -   
+			// Если что-то пошло не так
 			appenderInit("../log", "log.log");
 			break;
 		}
 
-		//  
+		// Определяем раскладку
 		m_logLayout = new log4cpp::BasicLayout();
 		m_appender->setLayout(m_logLayout);
 
-		//  
+		// Создаём категорию
 		m_category = &log4cpp::Category::getInstance(category);
 		m_category->addAppender(m_appender);
 		m_category->setPriority(LoggerSettings::PRIORITY);
@@ -82,14 +82,14 @@ public:
 
 	~Logger()
 	{
-		//   Appender'
+		// Очистка всех Appender'ов
 		log4cpp::Category::shutdown();
 	}
 
-	//  
+	// Генератор контекста
 	std::string getContext();
 
-	//  
+	// Методы логирования
 	void alert(	const std::string& message, 
 				const std::string& context1 = "", 
 				const std::string& context2 = "");
@@ -0,0 +1,420 @@
+#include "LoopRegistry.h"
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <utility>
+
+#include <uwebsockets/App.h>
+#include <nlohmann/json.hpp>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "EventsConst.h"
+#include "Constants.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "Heartbeat.h"
+#include "SignalScheduler.h"
+#include "SignalBook.h"
+#include "ChannelRegistry.h"
+
+
+// Инициализация статических членов
+Logger LoopRegistry::m_log("LoopRegistry", LoggerSettings::TYPE_LOG);
+std::mutex LoopRegistry::m_mtx;
+std::vector<LoopContext*> LoopRegistry::m_loops;
+bool LoopRegistry::m_draining = false;
+std::vector<std::shared_ptr<LoopRegistry::Delivery>> LoopRegistry::m_deliveries;
+
+// Цикл, обслуживаемый текущим потоком
+static thread_local LoopContext* s_current = nullptr;
+
+
+// Регистрирует цикл событий потока, вызывается из потока цикла
+void LoopRegistry::add(			LoopContext* loopContext)
+{
+	std::unique_lock ul(m_mtx);
+
+	s_current = loopContext;
+	m_loops.push_back(loopContext);
+
+	// Изменения книг до регистрации в цикл не придут, поэтому копии берутся под той же блокировкой,
+	// что и рассылка, изменение между загрузкой книги и его рассылкой придёт повторно и будет отброшено
+	for (const auto& channel : ChannelRegistry::all())
+	{
+		refresh(loopContext, BookUpdate{ channel->id, channel->book.latest(), {}, {} });
+	}
+
+	// Остановка запрошена раньше, чем цикл успел запуститься
+	if (m_draining)
+	{
+		loopContext->loop->defer([loopContext]() { drain(loopContext); });
+	}
+}
+
+// Удаляет цикл событий из реестра после его завершения
+// Задачи доставки, не выполненные циклом, уже не выполнятся, поэтому рассылки перестают его ждать
+void LoopRegistry::remove(		LoopContext* loopContext)
+{
+	std::vector<std::shared_ptr<Delivery>> deliveries;
+	{
+		std::unique_lock ul(m_mtx);
+
+		m_loops.erase(std::remove(m_loops.begin(), m_loops.end(), loopContext), m_loops.end());
+		deliveries = m_deliveries;
+		s_current = nullptr;
+	}
+
+	for (const auto& delivery : deliveries)
+	{
+		report(delivery, loopContext, nullptr);
+	}
+}
+
+// Возвращает цикл текущего потока
+LoopContext* LoopRegistry::current()
+{
+	return s_current;
+}
+
+// Ставит задачу в цикл под блокировкой реестра, поэтому после remove задачи в цикл не попадают
+bool LoopRegistry::defer(		LoopContext* loopContext, 
+								std::function<void()>&& task)
+{
+	std::unique_lock ul(m_mtx);
+
+	if (std::find(m_loops.begin(), m_loops.end(), loopContext) == m_loops.end())
+	{
+		return false;
+	}
+	loopContext->loop->defer(std::move(task));
+
+	return true;
+}
+
+
+// Запрашивает остановку всех циклов, вызывается из любого потока
+void LoopRegistry::drainAll()
+{
+	std::unique_lock ul(m_mtx);
+
+	m_draining = true;
+	for (LoopContext* loopContext : m_loops)
+	{
+		loopContext->loop->defer([loopContext]() { drain(loopContext); });
+	}
+
+	m_log.info("Draining " + std::to_string(m_loops.size()) + " event loop(s).", 
+		m_log.getContext(), "LoopRegistry::drainAll " + std::to_string(__LINE__));
+}
+
+// Возвращает копию книги канала в цикле, выполняется в потоке цикла
+std::shared_ptr<const SignalBook::Book> LoopRegistry::book(		LoopContext* loopContext, 
+																uint32_t channelId)
+{
+	if (!loopContext || channelId >= loopContext->books.size())
+	{
+		return nullptr;
+	}
+
+	return loopContext->books[channelId];
+}
+
+// Подменяет копию книги, выполняется в потоке цикла перед рассылкой сообщения,
+// поэтому подписчик после снимка получает только изменения новее снимка
+bool LoopRegistry::refresh(		LoopContext* loopContext, 
+								const BookUpdate& update)
+{
+	if (!update.book)
+	{
+		return false;
+	}
+
+	auto& books = loopContext->books;
+	if (books.size() <= update.channelId)
+	{
+		books.resize(update.channelId + 1);
+	}
+	if (books[update.channelId] && books[update.channelId]->version >= update.book->version)
+	{
+		return false;
+	}
+	books[update.channelId] = update.book;
+
+	return true;
+}
+
+// Публикует изменение во всех циклах, у каждого приложения uWS свои подписчики
+void LoopRegistry::publish(		const BookUpdate& update)
+{
+	Trace::record(TraceType::TRACE_PUBLISH, static_cast<uint32_t>(update.message.size()));
+	auto shared = std::make_shared<const BookUpdate>(update);
+
+	std::unique_lock ul(m_mtx);
+
+	for (LoopContext* loopContext : m_loops)
+	{
+		loopContext->loop->defer([loopContext, shared]()
+			{
+				if (!refresh(loopContext, *shared) || shared->message.empty())
+				{
+					return;
+				}
+
+				Metrics::Timer timer(Metrics::BROADCAST_TIME);
+				loopContext->app->publish(shared->topic, shared->message, uWS::OpCode::TEXT);
+			}
+		);
+	}
+}
+
+// Публикует сообщение и считает отправки по результату каждой
+// uWS не сообщает, кому из подписчиков темы сообщение не досталось, поэтому цикл отправляет его каждому подписчику сам.
+// Отправка сначала выталкивает очередь темы соединения, поэтому порядок с рассылками через тему сохраняется
+void LoopRegistry::publish(		const BookUpdate& update,
+								DeliveryCallback onDelivered)
+{
+	auto elapsedUs = [](std::chrono::steady_clock::time_point from)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - from).count());
+	};
+
+	Trace::record(TraceType::TRACE_PUBLISH, static_cast<uint32_t>(update.message.size()));
+	auto shared = std::make_shared<const BookUpdate>(update);
+	auto delivery = std::make_shared<Delivery>();
+	delivery->callback = std::move(onDelivered);
+	delivery->start = std::chrono::steady_clock::now();
+
+	std::unique_lock ul(m_mtx);
+
+	if (m_loops.empty())
+	{
+		ul.unlock();
+		delivery->callback({});
+
+		return;
+	}
+
+	delivery->pending = m_loops;
+	m_deliveries.push_back(delivery);
+	for (LoopContext* loopContext : m_loops)
+	{
+		loopContext->loop->defer([loopContext, shared, delivery, elapsedUs]()
+			{
+				auto begin = std::chrono::steady_clock::now();
+				LoopDelivery result;
+				result.loop = loopContext->id;
+				result.queueUs = elapsedUs(delivery->start);
+				if (refresh(loopContext, *shared) && !shared->message.empty())
+				{
+					Metrics::Timer timer(Metrics::BROADCAST_TIME);
+					for (auto* ws : loopContext->sockets)
+					{
+						if (!ws->isSubscribed(shared->topic))
+						{
+							continue;
+						}
+
+						switch (ws->send(shared->message, uWS::OpCode::TEXT))
+						{
+						case ServerSocket::SendStatus::DROPPED:
+							++result.dropped;
+							break;
+						case ServerSocket::SendStatus::BACKPRESSURE:
+							++result.queued;
+							++result.backpressured;
+							break;
+						default:
+							++result.queued;
+							break;
+						}
+					}
+				}
+				result.fanoutUs = elapsedUs(begin);
+
+				report(delivery, loopContext, &result);
+			}
+		);
+	}
+}
+
+// Учитывает доставку цикла, обработчик вызывается один раз после последнего цикла
+void LoopRegistry::report(		const std::shared_ptr<Delivery>& delivery, 
+								LoopContext* loopContext, 
+								const LoopDelivery* result)
+{
+	std::vector<LoopDelivery> loops;
+	{
+		std::unique_lock ul(m_mtx);
+
+		auto found = std::find(delivery->pending.begin(), delivery->pending.end(), loopContext);
+		if (found == delivery->pending.end())
+		{
+			return;
+		}
+		delivery->pending.erase(found);
+		if (result)
+		{
+			delivery->loops.push_back(*result);
+		}
+		if (!delivery->pending.empty())
+		{
+			return;
+		}
+
+		m_deliveries.erase(std::remove(m_deliveries.begin(), m_deliveries.end(), delivery), m_deliveries.end());
+		loops = std::move(delivery->loops);
+	}
+
+	std::sort(loops.begin(), loops.end(), [](const LoopDelivery& left, const LoopDelivery& right) { return left.loop < right.loop; });
+	delivery->callback(std::move(loops));
+}
+
+// Записывает распределение соединений по циклам и перекос относительно среднего
+void LoopRegistry::reportSpread()
+{
+	std::unique_lock ul(m_mtx);
+
+	if (m_loops.empty())
+	{
+		return;
+	}
+
+	unsigned int total = 0;
+	unsigned int maximum = 0;
+	for (LoopContext* loopContext : m_loops)
+	{
+		unsigned int connections = loopContext->connections.load(std::memory_order_relaxed);
+		total += connections;
+		maximum = std::max(maximum, connections);
+	}
+
+	std::string context = m_log.getContext();
+	for (LoopContext* loopContext : m_loops)
+	{
+		unsigned int connections = loopContext->connections.load(std::memory_order_relaxed);
+		m_log.info("Loop " + std::to_string(loopContext->id) + " (" + loopContext->affinity + "): " + 
+			std::to_string(connections) + " connection(s)", context, "LoopRegistry::reportSpread " + std::to_string(__LINE__));
+	}
+
+	double average = static_cast<double>(total) / m_loops.size();
+	m_log.info("Total " + std::to_string(total) + " connection(s), max/avg ratio " + 
+		(total ? std::to_string(maximum / average) : std::string("n/a")), 
+		context, "LoopRegistry::reportSpread " + std::to_string(__LINE__));
+}
+
+// Отбирает у сессий всех циклов каналы, из которых их удалили
+void LoopRegistry::revokeAll()
+{
+	std::unique_lock ul(m_mtx);
+
+	for (LoopContext* loopContext : m_loops)
+	{
+		loopContext->loop->defer([loopContext]()
+			{
+				unsigned int revoked = 0;
+				for (auto* ws : loopContext->sockets)
+				{
+					PerSocketData* data = ws->getUserData();
+					if (!data->auth)
+					{
+						continue;
+					}
+
+					uint64_t channels = 0;
+					uint64_t adminChannels = 0;
+					ChannelRegistry::entitle(data->login, data->isAdmin, channels, adminChannels);
+					uint64_t lost = data->channels & ~channels;
+					data->channels &= channels;
+					data->adminChannels &= adminChannels;
+					if (!lost)
+					{
+						continue;
+					}
+
+					for (const auto& channel : ChannelRegistry::all())
+					{
+						if (!(lost & ChannelRegistry::bit(channel->id)))
+						{
+							continue;
+						}
+
+						ws->unsubscribe(channel->topic);
+						if (data->history.active && data->history.channel == channel->name)
+						{
+							data->history.active = false;
+						}
+					}
+					++revoked;
+				}
+
+				if (revoked)
+				{
+					m_log.info("Channel rights were revoked from " + std::to_string(revoked) + " session(s).", 
+						loopContext->context, "LoopRegistry::revokeAll " + std::to_string(__LINE__));
+				}
+			}
+		);
+	}
+}
+
+// Останавливает цикл, выполняется в потоке цикла
+void LoopRegistry::drain(		LoopContext* loopContext)
+{
+	if (loopContext->draining)
+	{
+		return;
+	}
+	loopContext->draining = true;
+
+	// Прекращаем приём новых соединений, их примет новый процесс
+	if (loopContext->listenSocket)
+	{
+		us_listen_socket_close(TlsSettings::ENABLED, loopContext->listenSocket);
+		loopContext->listenSocket = nullptr;
+	}
+
+	// Разносим переподключения клиентов во времени, чтобы не нагружать новый процесс разом
+	thread_local std::mt19937 generator{ std::random_device{}() };
+	std::uniform_int_distribution<unsigned int> delay(0, ServerSettings::RECONNECT_SPREAD_MS);
+
+	for (auto* ws : loopContext->sockets)
+	{
+		nlohmann::json hint;
+		hint[JsonValue::COMMAND] = JsonValue::RECONNECT;
+		hint[JsonValue::DELAY] = delay(generator);
+
+		ws->send(hint.dump(), uWS::OpCode::TEXT);
+	}
+
+	m_log.info("Sent reconnect hints to " + std::to_string(loopContext->sockets.size()) + " connection(s).", 
+		loopContext->context, "LoopRegistry::drain " + std::to_string(__LINE__));
+
+	// Даём время отправить подсказки и закрываем оставшиеся соединения
+	us_timer_t* timer = us_create_timer(reinterpret_cast<us_loop_t*>(loopContext->loop), 0, sizeof(LoopContext*));
+	*static_cast<LoopContext**>(us_timer_ext(timer)) = loopContext;
+	us_timer_set(timer, closeApp, ServerSettings::DRAIN_GRACE_MS, 0);
+}
+
+// Закрывает все сокеты приложения, после чего цикл завершается
+void LoopRegistry::closeApp(	us_timer_t* timer)
+{
+	LoopContext* loopContext = *static_cast<LoopContext**>(us_timer_ext(timer));
+	us_timer_close(timer);
+
+	m_log.info("Closing the event loop.", loopContext->context, "LoopRegistry::closeApp " + std::to_string(__LINE__));
+
+	// Таймеры пингов и планировщика сигналов держат цикл живым
+	if (loopContext->heartbeat)
+	{
+		loopContext->heartbeat->stop();
+	}
+	SignalScheduler::stop(loopContext->loop);
+
+	loopContext->app->close();
+}
@@ -0,0 +1,143 @@
+#ifndef LOOPREGISTRY_H
+#define LOOPREGISTRY_H
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+#include <uwebsockets/App.h>
+
+#include "Logger.h"
+#include "PerSocketData.h"
+#include "TlsSettings.h"
+#include "Transport.h"
+#include "SignalBook.h"
+
+class Heartbeat;
+
+
+// Состояние цикла событий одного потока
+struct LoopContext
+{
+	unsigned int		id				= 0;		// порядковый номер цикла
+	std::string			context;					// контекст логгера потока
+	std::string			affinity;					// описание привязки к процессорам
+	ServerLoop*			loop			= nullptr;
+	ServerApp*			app				= nullptr;
+	us_listen_socket_t*	listenSocket	= nullptr;
+	Heartbeat*			heartbeat		= nullptr;	// пинги соединений цикла
+	bool				draining		= false;	// пометка об остановке цикла
+
+	// Открытые соединения цикла
+	std::unordered_set<ServerSocket*> sockets;
+	// Количество соединений для чтения из других потоков
+	std::atomic<unsigned int> connections{ 0 };
+
+	// Книги каналов по номеру канала в том состоянии, которое уже разослано подписчикам цикла,
+	// снимок для нового подписчика берётся отсюда, а не из общей книги
+	std::vector<std::shared_ptr<const SignalBook::Book>> books;
+};
+
+
+// Изменение книги канала для рассылки по циклам
+struct BookUpdate
+{
+	uint32_t								channelId	= 0;
+	std::shared_ptr<const SignalBook::Book>	book;
+	std::string								topic;
+	std::string								message;	// пустое, если подписчикам рассылать нечего
+};
+
+
+// Доставка рассылки в одном цикле
+struct LoopDelivery
+{
+	unsigned int	loop			= 0;
+	unsigned int	queued			= 0;	// подписчики темы, которым поставлено сообщение
+	unsigned int	backpressured	= 0;	// подписчики, у которых сообщение осталось в буфере отправки
+	unsigned int	dropped			= 0;	// подписчики, чья отправка отброшена uWS из-за буфера на пределе
+	uint64_t		queueUs			= 0;	// ожидание задачи в очереди цикла, мкс
+	uint64_t		fanoutUs		= 0;	// рассылка до опустошения очереди темы, мкс
+};
+
+// Получает доставку по всем циклам, вызывается в потоке цикла, закончившего последним
+using DeliveryCallback = std::function<void(std::vector<LoopDelivery>&&)>;
+
+
+// Реестр циклов событий всех потоков
+class LoopRegistry
+{
+private:
+	static Logger					m_log;
+	static std::mutex				m_mtx;
+	static std::vector<LoopContext*>	m_loops;
+	static bool						m_draining;
+
+	// Рассылка с отчётом о доставке, ожидающая циклы
+	struct Delivery
+	{
+		std::vector<LoopDelivery>				loops;
+		std::vector<LoopContext*>				pending;	// циклы, ещё не приславшие доставку
+		DeliveryCallback						callback;
+		std::chrono::steady_clock::time_point	start;
+	};
+	static std::vector<std::shared_ptr<Delivery>>	m_deliveries;
+
+
+	static void drain(		LoopContext* loopContext);
+	static void closeApp(	us_timer_t* timer);
+
+	// Подменяет копию книги в цикле, false если изменение уже получено
+	static bool refresh(	LoopContext* loopContext, 
+							const BookUpdate& update);
+
+	// Учитывает доставку цикла, цикл без доставки снят с регистрации
+	// Обработчик вызывается в потоке, который учёл последний цикл
+	static void report(		const std::shared_ptr<Delivery>& delivery, 
+							LoopContext* loopContext, 
+							const LoopDelivery* result);
+
+
+public:
+	static void add(		LoopContext* loopContext);
+	static void remove(		LoopContext* loopContext);
+
+	// Цикл текущего потока
+	static LoopContext* current();
+
+	// Ставит задачу в цикл из любого потока, false - цикл уже снят с регистрации
+	static bool defer(		LoopContext* loopContext, 
+							std::function<void()>&& task);
+
+	// Останавливает приём соединений и закрывает все циклы
+	static void drainAll();
+
+	// Книга канала, согласованная с рассылкой цикла, пустая если цикл её ещё не получил
+	static std::shared_ptr<const SignalBook::Book> book(	LoopContext* loopContext, 
+														uint32_t channelId);
+
+	// Обновляет книгу канала во всех циклах и публикует сообщение их подписчикам
+	// Вызывается из SignalBook::Publish, чтобы изменения приходили в циклы в порядке версий
+	static void publish(	const BookUpdate& update);
+
+	// Публикует изменение и собирает доставку со всех циклов
+	// Каждый цикл отправляет сообщение подписчикам по одному, поэтому вызывается по запросу
+	static void publish(	const BookUpdate& update,
+							DeliveryCallback onDelivered);
+
+	// Записывает в лог распределение соединений по циклам
+	static void reportSpread();
+
+	// Пересчитывает права открытых сессий по участникам каналов, вызывается после их перечитывания
+	// Сессии только теряют права: удалённые из канала отписываются от его темы, новые права дадут следующий вход
+	static void revokeAll();
+
+};
+
+#endif // !LOOPREGISTRY_H
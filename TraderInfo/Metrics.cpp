@@ -0,0 +1,218 @@
+#include "Metrics.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <bit>
+#include <sstream>
+
+#include "MetricsSettings.h"
+
+
+// Описание метрики для вывода
+struct MetricInfo
+{
+	const char* name;
+	const char* help;
+	const char* label;	// метка гистограммы, пустая если не нужна
+	uint64_t	base;	// базовая единица гистограммы
+	double		scale;	// делитель значений при выводе
+};
+
+static const MetricInfo s_counters[Metrics::COUNTERS] =
+{
+	{ "connections_opened_total",	"WebSocket connections opened.",		"", 1, 1 },
+	{ "connections_closed_total",	"WebSocket connections closed.",		"", 1, 1 },
+	{ "auth_attempts_total",		"Authorization attempts.",				"", 1, 1 },
+	{ "auth_failures_total",		"Failed authorization attempts.",		"", 1, 1 },
+	{ "json_parse_failures_total",	"Messages that are not valid JSON.",	"", 1, 1 },
+	{ "backpressure_events_total",	"Sends that ended up buffered.",		"", 1, 1 },
+	{ "rate_limited_total",			"Rejected by the rate limiter.",		"", 1, 1 },
+	{ "arena_overflows_total",		"Scratch arena blocks taken from the heap.",	"", 1, 1 },
+	{ "heartbeat_reaped_total",		"Connections closed for missing pongs.",	"", 1, 1 },
+	{ "sessions_evicted_total",		"Sessions closed by the per-user limit.",	"", 1, 1 },
+	{ "arena_retained_total",		"Scratch arenas kept after a message because its objects are still alive.",	"", 1, 1 }
+};
+
+static const MetricInfo s_histograms[Metrics::HISTOGRAMS] =
+{
+	{ "argon2_seconds",		"Argon2 password hashing time.",		"",					MetricsSettings::TIME_BASE,		1e6 },
+	{ "broadcast_seconds",	"Signal broadcast fan-out time.",		"",					MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"hCheck\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"hSet\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"hDel\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"hGet\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"hGetAll\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"sCheck\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "buffered_bytes",		"Bytes buffered under backpressure.",	"",					MetricsSettings::BYTES_BASE,	1 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"xAdd\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"xRange\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"hIncrBy\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "redis_seconds",		"Redis round-trip time per Dao call.",	"method=\"hBatch\"",	MetricsSettings::TIME_BASE,		1e6 },
+	{ "message_arena_bytes",	"Scratch arena bytes used per message.",	"",			MetricsSettings::UNIT_BASE,		1 },
+	{ "message_heap_allocations",	"Global allocator calls per message, counted only with TRADERINFO_COUNT_ALLOCATIONS.",	"",			MetricsSettings::UNIT_BASE,		1 },
+	{ "pong_rtt_seconds",	"Ping to pong round-trip time.",		"",					MetricsSettings::TIME_BASE,		1e6 },
+	{ "message_seconds",	"Message parsing and handling time.",	"",				MetricsSettings::TIME_BASE,		1e6 },
+	{ "snapshot_seconds",	"Signal snapshot sending time after login.",	"",		MetricsSettings::TIME_BASE,		1e6 }
+};
+
+// Шарды всех потоков, удаляются только вместе с процессом
+static std::mutex s_mtxShards;
+static std::vector<std::unique_ptr<Metrics::Shard>> s_shards;
+
+
+// Прибавляет значение к ячейке шарда
+// Писатель у шарда один, поэтому атомарная операция чтения-записи не нужна
+static void add(std::atomic<uint64_t>& cell, uint64_t value)
+{
+	cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+
+// Регистрирует шард нового потока
+Metrics::Shard* Metrics::registerShard()
+{
+	std::unique_lock ul(s_mtxShards);
+
+	s_shards.push_back(std::make_unique<Shard>());
+	s_shards.back()->id = static_cast<unsigned int>(s_shards.size() - 1);
+
+	return s_shards.back().get();
+}
+
+// Возвращает шард текущего потока
+Metrics::Shard& Metrics::local()
+{
+	thread_local Shard* shard = registerShard();
+
+	return *shard;
+}
+
+
+// Увеличивает счётчик
+void Metrics::increment(		Counter counter,
+								uint64_t value)
+{
+	add(local().counters[counter], value);
+}
+
+// Записывает значение в гистограмму
+void Metrics::observe(			Histogram histogram,
+								uint64_t value)
+{
+	Shard& shard = local();
+
+	// Корзина i содержит значения в диапазоне (base * 2^(i-1), base * 2^i]
+	uint64_t base = s_histograms[histogram].base;
+	uint64_t units = (value + base - 1) / base;
+	size_t index = (units <= 1) ? 0 : static_cast<size_t>(std::bit_width(units - 1));
+	if (index > MetricsSettings::BUCKETS)
+	{
+		index = MetricsSettings::BUCKETS;
+	}
+
+	add(shard.buckets[histogram][index], 1);
+	add(shard.sums[histogram], value);
+}
+
+
+// Формирует текст метрик в формате Prometheus
+std::string Metrics::render()
+{
+	std::ostringstream oss;
+
+	std::unique_lock ul(s_mtxShards);
+
+	// Текущее количество соединений по циклам событий
+	oss << "# HELP " << MetricsSettings::PREFIX << "connections Open WebSocket connections per event loop.\n";
+	oss << "# TYPE " << MetricsSettings::PREFIX << "connections gauge\n";
+	for (const auto& shard : s_shards)
+	{
+		uint64_t opened = shard->counters[CONNECTIONS_OPENED].load(std::memory_order_relaxed);
+		uint64_t closed = shard->counters[CONNECTIONS_CLOSED].load(std::memory_order_relaxed);
+		oss << MetricsSettings::PREFIX << "connections{loop=\"" << shard->id << "\"} " << (opened - closed) << '\n';
+	}
+
+	// Счётчики суммируются по всем шардам
+	for (int counter = 0; counter < COUNTERS; ++counter)
+	{
+		uint64_t total = 0;
+		for (const auto& shard : s_shards)
+		{
+			total += shard->counters[counter].load(std::memory_order_relaxed);
+		}
+
+		oss << "# HELP " << MetricsSettings::PREFIX << s_counters[counter].name << ' ' << s_counters[counter].help << '\n';
+		oss << "# TYPE " << MetricsSettings::PREFIX << s_counters[counter].name << " counter\n";
+		oss << MetricsSettings::PREFIX << s_counters[counter].name << ' ' << total << '\n';
+	}
+
+	// Гистограммы, HELP и TYPE выводятся один раз на имя,
+	// все ряды одного имени идут подряд, даже если в перечислении они разнесены
+	std::vector<bool> written(HISTOGRAMS, false);
+	for (int first = 0; first < HISTOGRAMS; ++first)
+	{
+		if (written[first])
+		{
+			continue;
+		}
+
+		std::string name = MetricsSettings::PREFIX + s_histograms[first].name;
+		oss << "# HELP " << name << ' ' << s_histograms[first].help << '\n';
+		oss << "# TYPE " << name << " histogram\n";
+
+		for (int histogram = first; histogram < HISTOGRAMS; ++histogram)
+		{
+			if (written[histogram] || name != MetricsSettings::PREFIX + s_histograms[histogram].name)
+			{
+				continue;
+			}
+			written[histogram] = true;
+			renderHistogram(oss, name, static_cast<Histogram>(histogram));
+		}
+	}
+
+	return oss.str();
+}
+
+// Выводит ряды одной гистограммы
+void Metrics::renderHistogram(	std::ostream& oss, 
+								const std::string& name,
+								Histogram histogram)
+{
+	const MetricInfo& info = s_histograms[histogram];
+	std::string labels = info.label;
+	std::string separator = labels.empty() ? "" : ",";
+
+	uint64_t cumulative = 0;
+	for (size_t index = 0; index <= MetricsSettings::BUCKETS; ++index)
+	{
+		for (const auto& shard : s_shards)
+		{
+			cumulative += shard->buckets[histogram][index].load(std::memory_order_relaxed);
+		}
+
+		oss << name << "_bucket{" << labels << separator << "le=\"";
+		if (index == MetricsSettings::BUCKETS)
+		{
+			oss << "+Inf";
+		}
+		else
+		{
+			oss << static_cast<double>(info.base << index) / info.scale;
+		}
+		oss << "\"} " << cumulative << '\n';
+	}
+
+	uint64_t sum = 0;
+	for (const auto& shard : s_shards)
+	{
+		sum += shard->sums[histogram].load(std::memory_order_relaxed);
+	}
+
+	std::string braces = labels.empty() ? "" : "{" + labels + "}";
+	oss << name << "_sum" << braces << ' ' << static_cast<double>(sum) / info.scale << '\n';
+	oss << name << "_count" << braces << ' ' << cumulative << '\n';
+}
@@ -0,0 +1,117 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <ostream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "MetricsSettings.h"
+#include "Trace.h"
+
+
+// Реестр метрик в формате Prometheus
+// Каждый поток пишет только в свой шард, поэтому запись не ждёт другие потоки
+class Metrics
+{
+public:
+	enum Counter
+	{
+		CONNECTIONS_OPENED	= 0,
+		CONNECTIONS_CLOSED	= 1,
+		AUTH_ATTEMPTS		= 2,
+		AUTH_FAILURES		= 3,
+		JSON_PARSE_FAILURES	= 4,
+		BACKPRESSURE_EVENTS	= 5,
+		RATE_LIMITED		= 6,
+		ARENA_OVERFLOWS		= 7,
+		HEARTBEAT_REAPED	= 8,
+		SESSIONS_EVICTED	= 9,
+		ARENA_RETAINED		= 10,
+		COUNTERS			= 11		// количество счётчиков
+	};
+
+	enum Histogram
+	{
+		ARGON2_TIME			= 0,
+		BROADCAST_TIME		= 1,
+		REDIS_HCHECK		= 2,
+		REDIS_HSET			= 3,
+		REDIS_HDEL			= 4,
+		REDIS_HGET			= 5,
+		REDIS_HGETALL		= 6,
+		REDIS_SCHECK		= 7,
+		BUFFERED_BYTES		= 8,
+		REDIS_XADD			= 9,
+		REDIS_XRANGE		= 10,
+		REDIS_HINCRBY		= 11,
+		REDIS_HBATCH		= 12,
+		ARENA_BYTES			= 13,
+		MESSAGE_ALLOCATIONS	= 14,
+		PONG_RTT			= 15,
+		MESSAGE_TIME		= 16,
+		SNAPSHOT_TIME		= 17,
+		HISTOGRAMS			= 18	// количество гистограмм
+	};
+
+	// Метрики одного потока (одного цикла событий)
+	struct Shard
+	{
+		unsigned int id = 0;
+
+		std::array<std::atomic<uint64_t>, COUNTERS>		counters{};
+		std::array<std::atomic<uint64_t>, HISTOGRAMS>	sums{};
+		// Последняя корзина соответствует +Inf
+		std::array<std::array<std::atomic<uint64_t>, MetricsSettings::BUCKETS + 1>, HISTOGRAMS> buckets{};
+	};
+
+	// Замеряет время жизни объекта в микросекундах и записывает его в гистограмму
+	// При включённой трассировке интервал попадает и в трассу
+	class Timer
+	{
+	private:
+		Histogram								m_histogram;
+		std::chrono::steady_clock::time_point	m_start;
+
+	public:
+		explicit Timer(Histogram histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now())
+		{
+			Trace::record(TraceType::TRACE_SPAN_BEGIN, histogram);
+		}
+
+		~Timer()
+		{
+			Trace::record(TraceType::TRACE_SPAN_END, m_histogram);
+			auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+			Metrics::observe(m_histogram, static_cast<uint64_t>(elapsed.count()));
+		}
+
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+	};
+
+
+private:
+	static Shard& local();
+	static Shard* registerShard();
+
+	// Вызывается из render под блокировкой шардов
+	static void renderHistogram(std::ostream& oss, 
+							const std::string& name,
+							Histogram histogram);
+
+
+public:
+	static void increment(	Counter counter,
+							uint64_t value = 1);
+
+	static void observe(	Histogram histogram,
+							uint64_t value);
+
+	static std::string render();
+
+};
+
+#endif // !METRICS_H
@@ -0,0 +1,25 @@
+#ifndef METRICSSETTINGS_H
+#define METRICSSETTINGS_H
+
+#include <string>
+#include <cstdint>
+
+
+// Настройки метрик
+namespace MetricsSettings
+{
+	const std::string	ROUTE			{ "/metrics" };
+	const std::string	CONTENT_TYPE	{ "text/plain; version=0.0.4" };
+	const std::string	PREFIX			{ "traderinfo_" };
+
+	// Количество корзин гистограммы, границы корзин растут степенями двойки
+	const size_t		BUCKETS			(23U);
+
+	// Базовые единицы гистограмм
+	const uint64_t		TIME_BASE		(1U);		// 1 микросекунда
+	const uint64_t		BYTES_BASE		(1024U);	// 1 кибибайт
+	const uint64_t		UNIT_BASE		(1U);		// 1 штука или 1 байт
+
+}
+
+#endif // !METRICSSETTINGS_H
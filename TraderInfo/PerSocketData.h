@@ -2,17 +2,52 @@
 #define PERSOCKETDATA_H
 
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 
-//  
+// Позиция постраничной выдачи истории сигналов
+struct HistoryCursor
+{
+	std::string		channel;				// имя канала журнала
+	std::string		tickerSymbol;			// пустой - все тикеры
+	std::string		next;					// ИН первой записи следующей страницы
+	std::string		end;					// ИН последней записи диапазона
+	unsigned int	request	= 0;			// номер запроса, отличает устаревшие продолжения
+	bool			active	= false;		// выдача не закончена
+	bool			pending	= false;		// следующая страница уже запланирована
+};
+
+// Положение соединения в колесе пингов и замеры живости
+struct HeartbeatState
+{
+	static constexpr size_t NO_SLOT = SIZE_MAX;
+
+	size_t			slot		= NO_SLOT;	// ячейка колеса
+	size_t			index		= 0;		// позиция в ячейке
+	uint64_t		lastPongUs	= 0;		// время последнего понга, мкс
+	uint32_t		rttUs		= 0;		// последнее время оборота пинга, мкс
+};
+
+// Данные пользователей
 struct PerSocketData
 {
-	std::string userId;				//   
-	std::string login;				//  
+	std::string userId;				// ИН пользователя вебсервера
+	std::string login;				// логин пользователя
+	std::string ip;					// адрес пользователя
+	uint64_t	traceId = 0;		// ИН соединения в трассе
+	uint64_t	sessionId = 0;		// ИН сессии в реестре, 0 - не зарегистрирована
 	
-	//   false
-	bool        auth	= false;	//    
-	bool        isAdmin = false;	//    
+	// По умолчанию false
+	bool        auth	= false;	// пометка о пройденой авторизации
+	bool        isAdmin = false;	// пометка о статусе администратора всех каналов
+
+	// Права на каналы сигналов, бит по номеру канала
+	uint64_t	channels		= 0;	// чтение сигналов канала
+	uint64_t	adminChannels	= 0;	// публикация сигналов в канал
+
+	HistoryCursor history;			// выдача истории сигналов
+	HeartbeatState heartbeat;		// проверка живости соединения
 };
 
 #endif // !PERSOCKETDATA_H
@@ -0,0 +1,120 @@
+#include "RateLimiter.h"
+
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+
+#include "LimitSettings.h"
+
+
+RateLimiter::RateLimiter(		double rate, 
+								double burst, 
+								size_t size) : 
+	m_buckets(size), 
+	m_stripes(std::make_unique<std::mutex[]>(LimitSettings::STRIPES)), 
+	m_stripeSize(size / LimitSettings::STRIPES), 
+	m_rate(rate), 
+	m_burst(burst)
+{
+}
+
+
+// Пополняет корзину за прошедшее время
+void RateLimiter::refill(		Bucket& bucket, 
+								int64_t now)
+{
+	bucket.tokens = std::min(m_burst, bucket.tokens + static_cast<double>(now - bucket.updated) * m_rate / 1e6);
+	bucket.updated = now;
+}
+
+// Пополняет корзину и забирает из неё один токен
+bool RateLimiter::take(			Bucket& bucket, 
+								int64_t now)
+{
+	refill(bucket, now);
+
+	if (bucket.tokens < 1.0)
+	{
+		return false;
+	}
+	bucket.tokens -= 1.0;
+
+	return true;
+}
+
+// Проверяет разрешено ли ещё одно действие по ключу
+bool RateLimiter::allow(		std::string_view key)
+{
+	uint64_t hash = std::hash<std::string_view>{}(key);
+	if (hash == 0)
+	{
+		hash = 1;
+	}
+	uint8_t length = static_cast<uint8_t>(std::min(key.size(), LimitSettings::KEY_LEN));
+
+	int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	// Часть выбирается старшими битами хеша, ячейка в ней - младшими
+	size_t stripe = (hash >> 32) & (LimitSettings::STRIPES - 1);
+	Bucket* buckets = m_buckets.data() + stripe * m_stripeSize;
+	size_t mask = m_stripeSize - 1;
+
+	std::unique_lock ul(m_stripes[stripe]);
+
+	// Ищем корзину ключа рядом с её позицией, попутно выбирая кандидата на вытеснение
+	Bucket* victim = nullptr;
+	for (size_t probe = 0; probe < LimitSettings::PROBES; ++probe)
+	{
+		Bucket& bucket = buckets[(hash + probe) & mask];
+		if (bucket.hash == hash && bucket.length == length && std::memcmp(bucket.key.data(), key.data(), length) == 0)
+		{
+			return take(bucket, now);
+		}
+
+		if (victim == nullptr || bucket.updated < victim->updated)
+		{
+			victim = &bucket;
+		}
+	}
+
+	// Новый ключ в пустой ячейке получает полную корзину, а вытеснивший чужую - только её пополненный остаток,
+	// иначе перебор ключей возвращал бы полный запас
+	if (victim->hash)
+	{
+		refill(*victim, now);
+	}
+	else
+	{
+		victim->tokens = m_burst;
+		victim->updated = now;
+	}
+	victim->hash = hash;
+	victim->length = length;
+	std::memcpy(victim->key.data(), key.data(), length);
+
+	return take(*victim, now);
+}
+
+
+// Таблица ограничений по IP для всех циклов
+RateLimiter& RateLimiter::byIp()
+{
+	static RateLimiter limiter(LimitSettings::IP_RATE, LimitSettings::IP_BURST);
+
+	return limiter;
+}
+
+// Таблица ограничений по логину для всех циклов
+RateLimiter& RateLimiter::byLogin()
+{
+	static RateLimiter limiter(LimitSettings::LOGIN_RATE, LimitSettings::LOGIN_BURST);
+
+	return limiter;
+}
@@ -0,0 +1,64 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "LimitSettings.h"
+
+
+static_assert(LimitSettings::TABLE_SIZE && !(LimitSettings::TABLE_SIZE & (LimitSettings::TABLE_SIZE - 1)), "TABLE_SIZE must be a power of two");
+static_assert(LimitSettings::STRIPES && !(LimitSettings::STRIPES & (LimitSettings::STRIPES - 1)), "STRIPES must be a power of two");
+static_assert(LimitSettings::TABLE_SIZE >= LimitSettings::STRIPES * LimitSettings::PROBES, "every stripe must fit PROBES buckets");
+
+
+// Ограничитель частоты запросов по алгоритму token bucket
+// Таблица общая для всех циклов событий и разбита на части со своей блокировкой,
+// корзина ключа ищется только в его части. При переполнении вытесняется самая старая корзина
+class RateLimiter
+{
+private:
+	struct Bucket
+	{
+		uint64_t		hash	= 0;	// хеш ключа, 0 - пустая ячейка
+		double			tokens	= 0.0;
+		int64_t			updated	= 0;	// время последнего обращения в микросекундах
+		uint8_t			length	= 0;	// длина сохранённого начала ключа
+		std::array<char, LimitSettings::KEY_LEN> key;	// начало ключа, с хешем отличает ключи при совпадении хешей
+	};
+
+	std::vector<Bucket>				m_buckets;
+	std::unique_ptr<std::mutex[]>	m_stripes;
+	size_t							m_stripeSize;	// корзин в одной части
+	double							m_rate;
+	double							m_burst;
+
+
+	// Пополняет корзину за прошедшее время
+	void refill(		Bucket& bucket, 
+						int64_t now);
+
+	bool take(			Bucket& bucket, 
+						int64_t now);
+
+
+public:
+	// size_t size - степень двойки не меньше STRIPES * PROBES
+	RateLimiter(		double rate, 
+						double burst, 
+						size_t size = LimitSettings::TABLE_SIZE);
+
+	// Вызывается из любого потока
+	bool allow(			std::string_view key);
+
+	// Таблицы процесса
+	static RateLimiter& byIp();
+	static RateLimiter& byLogin();
+
+};
+
+#endif // !RATELIMITER_H
@@ -0,0 +1,174 @@
+#include "RedisStorage.h"
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <iterator>
+#include <chrono>
+
+#include <sw/redis++/redis++.h>
+
+#include "Storage.h"
+#include "DaoSettings.h"
+
+
+// Выполняет запрос к Redis и переводит его ошибки в ошибки хранилища,
+// обрыв соединения и истечение ожидания - в недоступность хранилища
+template <typename Function>
+static auto call(Function&& function) -> decltype(function())
+{
+	try
+	{
+		return function();
+	}
+	catch (const sw::redis::IoError& err)
+	{
+		throw StorageUnavailable("Redis is unavailable: " + std::string(err.what()));
+	}
+	catch (const sw::redis::ClosedError& err)
+	{
+		throw StorageUnavailable("Redis is unavailable: " + std::string(err.what()));
+	}
+	catch (const sw::redis::Error& err)
+	{
+		throw StorageError("Redis error: " + std::string(err.what()));
+	}
+}
+
+// Создаёт пул соединений, ошибки подключения выбрасываются как ошибки хранилища
+static sw::redis::Redis connect(const std::string& redisSocket, size_t poolSize)
+{
+	return call([&]()
+		{
+			sw::redis::ConnectionOptions options(redisSocket);
+			// Без ограничений запрос к зависшему серверу блокирует поток навсегда
+			options.connect_timeout = std::chrono::milliseconds(DaoSettings::REDIS_CONNECT_TIMEOUT_MS);
+			options.socket_timeout = std::chrono::milliseconds(DaoSettings::REDIS_SOCKET_TIMEOUT_MS);
+			sw::redis::ConnectionPoolOptions pool;
+			pool.size = poolSize;
+
+			sw::redis::Redis redis(options, pool);
+			// Проверяем доступность сервера сразу, а не при первом запросе
+			redis.ping();
+
+			return redis;
+		}
+	);
+}
+
+
+RedisStorage::RedisStorage(		const std::string& redisSocket, 
+								size_t poolSize) : m_redis(connect(redisSocket, poolSize))
+{
+}
+
+
+bool RedisStorage::hExists(		const std::string& db, 
+								const std::string& key)
+{
+	return call([&]() { return m_redis.hexists(db, key); });
+}
+
+bool RedisStorage::hSet(		const std::string& db, 
+								const std::string& key, 
+								const std::string& value)
+{
+	return call([&]() { return m_redis.hset(db, key, value) > 0; });
+}
+
+bool RedisStorage::hDel(		const std::string& db, 
+								const std::string& key)
+{
+	return call([&]() { return m_redis.hdel(db, key) > 0; });
+}
+
+std::optional<std::string> RedisStorage::hGet(const std::string& db, 
+								const std::string& key)
+{
+	return call([&]() -> std::optional<std::string> { return m_redis.hget(db, key); });
+}
+
+long long RedisStorage::hIncrBy(const std::string& db, 
+								const std::string& key, 
+								long long increment)
+{
+	return call([&]() { return m_redis.hincrby(db, key, increment); });
+}
+
+std::vector<bool> RedisStorage::hBatch(const std::vector<HashOp>& ops)
+{
+	return call([&]()
+		{
+			// MULTI/EXEC одним пакетом на соединении из пула
+			sw::redis::Transaction transaction = m_redis.transaction(true, false);
+			for (const HashOp& op : ops)
+			{
+				if (op.type == HashOpType::HASH_DEL)
+				{
+					transaction.hdel(op.db, op.key);
+				}
+				else
+				{
+					transaction.hset(op.db, op.key, op.value);
+				}
+			}
+			sw::redis::QueuedReplies replies = transaction.exec();
+
+			std::vector<bool> results;
+			results.reserve(ops.size());
+			for (size_t index = 0; index < replies.size(); ++index)
+			{
+				results.push_back(replies.get<long long>(index) > 0);
+			}
+
+			return results;
+		}
+	);
+}
+
+long long RedisStorage::hGetAll(const std::string& db, 
+								std::map<std::string, std::string>& output)
+{
+	return call([&]()
+		{
+			m_redis.hgetall(db, std::inserter(output, output.begin()));
+
+			return static_cast<long long>(output.size());
+		}
+	);
+}
+
+bool RedisStorage::sIsMember(	const std::string& db, 
+								const std::string& value)
+{
+	return call([&]() { return m_redis.sismember(db, value); });
+}
+
+void RedisStorage::sMembers(	const std::string& db, 
+								std::set<std::string>& output)
+{
+	call([&]() { m_redis.smembers(db, std::inserter(output, output.begin())); });
+}
+
+std::string RedisStorage::xAdd(	const std::string& db, 
+								const Fields& fields)
+{
+	return call([&]() { return m_redis.xadd(db, "*", fields.begin(), fields.end(), DaoSettings::HISTORY_MAXLEN, true); });
+}
+
+void RedisStorage::xRange(		const std::string& db, 
+								const std::string& start, 
+								const std::string& end, 
+								long long count, 
+								std::vector<StreamItem>& output)
+{
+	std::vector<std::pair<std::string, std::optional<Fields>>> items;
+	call([&]() { m_redis.xrange(db, start, end, count, std::back_inserter(items)); });
+
+	for (auto& item : items)
+	{
+		output.push_back({ std::move(item.first), item.second ? std::move(*item.second) : Fields{} });
+	}
+}
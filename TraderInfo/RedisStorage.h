@@ -0,0 +1,65 @@
+#ifndef REDISSTORAGE_H
+#define REDISSTORAGE_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+
+#include <sw/redis++/redis++.h>
+
+#include "Storage.h"
+
+
+// Хранилище в Redis с общим пулом соединений
+class RedisStorage : public Storage
+{
+private:
+	sw::redis::Redis m_redis;
+
+
+public:
+	RedisStorage(				const std::string& redisSocket, 
+								size_t poolSize);
+
+	bool hExists(				const std::string& db, 
+								const std::string& key) override;
+
+	bool hSet(					const std::string& db, 
+								const std::string& key, 
+								const std::string& value) override;
+
+	bool hDel(					const std::string& db, 
+								const std::string& key) override;
+
+	std::optional<std::string> hGet(const std::string& db, 
+								const std::string& key) override;
+
+	long long hIncrBy(			const std::string& db, 
+								const std::string& key, 
+								long long increment) override;
+
+	long long hGetAll(			const std::string& db, 
+								std::map<std::string, std::string>& output) override;
+
+	std::vector<bool> hBatch(	const std::vector<HashOp>& ops) override;
+
+	bool sIsMember(				const std::string& db, 
+								const std::string& value) override;
+
+	void sMembers(				const std::string& db, 
+								std::set<std::string>& output) override;
+
+	std::string xAdd(			const std::string& db, 
+								const Fields& fields) override;
+
+	void xRange(				const std::string& db, 
+								const std::string& start, 
+								const std::string& end, 
+								long long count, 
+								std::vector<StreamItem>& output) override;
+
+};
+
+#endif // !REDISSTORAGE_H
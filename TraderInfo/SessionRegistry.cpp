@@ -0,0 +1,201 @@
+#include "SessionRegistry.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#include <uwebsockets/App.h>
+#include <nlohmann/json.hpp>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "EventsConst.h"
+#include "PerSocketData.h"
+#include "LoopRegistry.h"
+#include "SessionSettings.h"
+#include "Metrics.h"
+
+
+// Инициализация статических членов
+Logger SessionRegistry::m_log("SessionRegistry", LoggerSettings::TYPE_LOG);
+std::array<SessionRegistry::Shard, SessionSettings::SHARDS> SessionRegistry::m_shards;
+std::atomic<uint64_t> SessionRegistry::m_nextId{ 1 };
+
+// Заранее сформированное сообщение о вытеснении сессии лимитом
+static const std::string s_evicted{ nlohmann::json{ 
+	{ JsonValue::COMMAND, JsonValue::LOGOUT }, { JsonValue::REASON, JsonValue::SESSION_LIMIT } }.dump() };
+
+
+// Возвращает шард логина
+SessionRegistry::Shard& SessionRegistry::shard(const std::string& login)
+{
+	return m_shards[std::hash<std::string>{}(login) & (SessionSettings::SHARDS - 1)];
+}
+
+// Передаёт задачу циклу сессии, задача выполняется, только если соединение ещё живо
+template <typename Task>
+void SessionRegistry::post(		const Session& session, 
+								Task&& task)
+{
+	session.loop->loop->defer([session, task = std::forward<Task>(task)]()
+		{
+			// Соединение могло закрыться, а его адрес достаться новому сокету
+			if (session.loop->sockets.count(session.ws) && session.ws->getUserData()->sessionId == session.id)
+			{
+				task(session.ws);
+			}
+		}
+	);
+}
+
+
+// Регистрирует авторизованное соединение текущего цикла
+bool SessionRegistry::add(		ServerSocket* ws, 
+								const std::string& postfixContext)
+{
+	PerSocketData* data = ws->getUserData();
+	Session session{ ws, LoopRegistry::current(), m_nextId.fetch_add(1, std::memory_order_relaxed) };
+	Shard& current = shard(data->login);
+
+	std::unique_lock ul(current.mtx);
+
+	std::vector<Session>& sessions = current.users[data->login];
+	if (SessionSettings::MAX_PER_USER && sessions.size() >= SessionSettings::MAX_PER_USER)
+	{
+		if (!SessionSettings::EVICT_OLDEST)
+		{
+			m_log.info("Session limit reached for the user \"" + data->login + "\", login rejected.", 
+				m_log.getContext() + " " + postfixContext, "SessionRegistry::add " + std::to_string(__LINE__));
+
+			return false;
+		}
+
+		// Самая старая сессия получает уведомление и закрывается в своём цикле
+		Metrics::increment(Metrics::SESSIONS_EVICTED);
+		post(sessions.front(), [](auto* evicted)
+			{
+				evicted->send(s_evicted, uWS::OpCode::TEXT);
+				evicted->end(SessionSettings::LOGOUT_CODE, JsonValue::SESSION_LIMIT);
+			}
+		);
+		sessions.erase(sessions.begin());
+
+		m_log.info("Session limit reached for the user \"" + data->login + "\", the oldest session is closed.", 
+			m_log.getContext() + " " + postfixContext, "SessionRegistry::add " + std::to_string(__LINE__));
+	}
+
+	data->sessionId = session.id;
+	sessions.push_back(session);
+
+	return true;
+}
+
+// Удаляет соединение из реестра, у логина не больше MAX_PER_USER сессий,
+// поэтому удаление занимает постоянное время
+void SessionRegistry::remove(	ServerSocket* ws)
+{
+	PerSocketData* data = ws->getUserData();
+	if (!data->sessionId)
+	{
+		return;
+	}
+
+	Shard& current = shard(data->login);
+
+	std::unique_lock ul(current.mtx);
+
+	auto user = current.users.find(data->login);
+	if (user == current.users.end())
+	{
+		return;
+	}
+
+	std::vector<Session>& sessions = user->second;
+	auto session = std::find_if(sessions.begin(), sessions.end(), 
+		[id = data->sessionId](const Session& session) { return session.id == id; });
+	if (session != sessions.end())
+	{
+		sessions.erase(session);
+	}
+
+	if (sessions.empty())
+	{
+		current.users.erase(user);
+	}
+	data->sessionId = 0;
+}
+
+
+// Отправляет сообщение всем соединениям пользователя
+size_t SessionRegistry::send(	const std::string& login, 
+								const std::string& message)
+{
+	auto shared = std::make_shared<const std::string>(message);
+	Shard& current = shard(login);
+
+	std::unique_lock ul(current.mtx);
+
+	auto user = current.users.find(login);
+	if (user == current.users.end())
+	{
+		return 0;
+	}
+
+	for (const Session& session : user->second)
+	{
+		post(session, [shared](auto* ws) { ws->send(*shared, uWS::OpCode::TEXT); });
+	}
+
+	return user->second.size();
+}
+
+// Отправляет сообщение и закрывает все соединения пользователя
+// Сессии удаляются из реестра в .close, когда циклы закроют соединения
+size_t SessionRegistry::logout(	const std::string& login, 
+								const std::string& message)
+{
+	auto shared = std::make_shared<const std::string>(message);
+	Shard& current = shard(login);
+
+	std::unique_lock ul(current.mtx);
+
+	auto user = current.users.find(login);
+	if (user == current.users.end())
+	{
+		return 0;
+	}
+
+	for (const Session& session : user->second)
+	{
+		post(session, [shared](auto* ws)
+			{
+				ws->send(*shared, uWS::OpCode::TEXT);
+				ws->end(SessionSettings::LOGOUT_CODE, JsonValue::LOGOUT);
+			}
+		);
+	}
+
+	m_log.info("Forced logout of the user \"" + login + "\" from " + std::to_string(user->second.size()) + " session(s).", 
+		m_log.getContext(), "SessionRegistry::logout " + std::to_string(__LINE__));
+
+	return user->second.size();
+}
+
+// Количество сессий пользователя
+size_t SessionRegistry::count(	const std::string& login)
+{
+	Shard& current = shard(login);
+
+	std::unique_lock ul(current.mtx);
+
+	auto user = current.users.find(login);
+
+	return (user == current.users.end()) ? 0 : user->second.size();
+}
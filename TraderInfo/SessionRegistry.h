@@ -0,0 +1,79 @@
+#ifndef SESSIONREGISTRY_H
+#define SESSIONREGISTRY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include <uwebsockets/App.h>
+
+#include "Logger.h"
+#include "PerSocketData.h"
+#include "LoopRegistry.h"
+#include "SessionSettings.h"
+
+
+// Живое соединение авторизованного пользователя
+struct Session
+{
+	ServerSocket*	ws		= nullptr;
+	LoopContext*	loop	= nullptr;	// цикл, владеющий соединением
+	uint64_t		id		= 0;		// ИН сессии, отличает переиспользованный адрес сокета
+};
+
+
+// Реестр сессий: логин -> живые соединения во всех циклах событий
+// Реестр разбит на шарды по хешу логина, поэтому потоки редко ждут друг друга
+// Сокет трогает только его цикл, другие потоки передают ему работу через defer
+class SessionRegistry
+{
+private:
+	struct Shard
+	{
+		std::mutex mtx;
+		// Сессии логина в порядке авторизации, их не больше MAX_PER_USER
+		std::unordered_map<std::string, std::vector<Session>> users;
+	};
+
+	static Logger										m_log;
+	static std::array<Shard, SessionSettings::SHARDS>	m_shards;
+	static std::atomic<uint64_t>						m_nextId;
+
+
+	static Shard& shard(		const std::string& login);
+
+	// Передаёт задачу циклу сессии, вызывается под блокировкой шарда,
+	// пока сессия в реестре, её цикл не завершится
+	template <typename Task>
+	static void post(			const Session& session, 
+								Task&& task);
+
+
+public:
+	// Регистрирует авторизованное соединение текущего цикла
+	// Возвращает false, если лимит сессий исчерпан и вытеснение отключено
+	static bool add(			ServerSocket* ws, 
+								const std::string& postfixContext);
+
+	// Удаляет соединение из реестра, вызывается из .close
+	static void remove(			ServerSocket* ws);
+
+	// Отправляет сообщение всем соединениям пользователя, возвращает их количество
+	static size_t send(			const std::string& login, 
+								const std::string& message);
+
+	// Отправляет сообщение и закрывает все соединения пользователя
+	static size_t logout(		const std::string& login, 
+								const std::string& message);
+
+	// Количество сессий пользователя
+	static size_t count(		const std::string& login);
+
+};
+
+#endif // !SESSIONREGISTRY_H
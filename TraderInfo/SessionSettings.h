@@ -0,0 +1,25 @@
+#ifndef SESSIONSETTINGS_H
+#define SESSIONSETTINGS_H
+
+#include <string>
+
+
+// Настройки реестра сессий пользователей
+namespace SessionSettings
+{
+	// Количество шардов реестра (степень двойки)
+	const size_t		SHARDS			(64U);
+
+	// Наибольшее количество одновременных сессий одного логина, 0 - без ограничения
+	const size_t		MAX_PER_USER	(5U);
+	// При превышении лимита закрывается самая старая сессия, иначе новая авторизация отклоняется
+	const bool			EVICT_OLDEST	(true);
+
+	// Код закрытия соединения при принудительном выходе
+	const int			LOGOUT_CODE		(4001);
+
+	static_assert((SHARDS & (SHARDS - 1)) == 0, "SHARDS must be a power of two");
+
+}
+
+#endif // !SESSIONSETTINGS_H
@@ -0,0 +1,322 @@
+#include "Signal.h"
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+#include "EventsConst.h"
+#include "SignalSettings.h"
+#include "Arena.h"
+
+
+// Читает время в миллисекундах от эпохи Unix
+bool SignalCodec::toTime(		const MessageJson& value, 
+								uint64_t& result)
+{
+	if (!value.is_number_unsigned())
+	{
+		return false;
+	}
+	result = value.get<uint64_t>();
+
+	return true;
+}
+
+// Переводит число из сообщения в фиксированную точку с округлением
+bool SignalCodec::toFixed(		const MessageJson& value, 
+								int64_t scale, 
+								int64_t maximum, 
+								int64_t& result)
+{
+	if (!value.is_number())
+	{
+		return false;
+	}
+
+	double number = value.get<double>();
+	if (!std::isfinite(number) || number < 0 || number * scale > static_cast<double>(maximum))
+	{
+		return false;
+	}
+	result = std::llround(number * scale);
+
+	return true;
+}
+
+// Тикер - непустая строка из латинских букв, цифр и символов ".-_:/"
+bool SignalCodec::validTicker(	std::string_view tickerSymbol)
+{
+	if (tickerSymbol.empty() || tickerSymbol.size() > SignalSettings::MAX_TICKER_LEN)
+	{
+		return false;
+	}
+
+	for (char symbol : tickerSymbol)
+	{
+		bool allowed = (symbol >= 'A' && symbol <= 'Z') || (symbol >= 'a' && symbol <= 'z') || 
+			(symbol >= '0' && symbol <= '9') || symbol == '.' || symbol == '-' || symbol == '_' || symbol == ':' || symbol == '/';
+		if (!allowed)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// Текущее время в миллисекундах от эпохи Unix
+uint64_t SignalCodec::now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Сигнал виден с activateAt до expiresAt
+void SignalCodec::settle(		Signal& signal, 
+								uint64_t now)
+{
+	bool waiting = signal.activateAt > now;
+	bool expired = signal.expiresAt && signal.expiresAt <= now;
+
+	signal.flags &= static_cast<uint8_t>(~(SIGNAL_ACTIVE | SIGNAL_PENDING));
+	signal.flags |= (waiting || expired) ? SIGNAL_PENDING : SIGNAL_ACTIVE;
+}
+
+
+// Разбирает поля команды add: side, quantity, percent, activateAt, expiresAt и limits
+// Нужен хотя бы текст limits или направление
+bool SignalCodec::parse(		const MessageJson& item, 
+								Signal& signal, 
+								std::string& limits)
+{
+	signal = Signal{};
+	signal.time = now();
+
+	// Срок снятия должен быть в будущем и позже активации
+	auto activateAt = item.find(JsonValue::ACTIVATE_AT);
+	if (activateAt != item.end() && !toTime(*activateAt, signal.activateAt))
+	{
+		return false;
+	}
+	auto expiresAt = item.find(JsonValue::EXPIRES_AT);
+	if (expiresAt != item.end() && (!toTime(*expiresAt, signal.expiresAt) || 
+		signal.expiresAt <= std::max(signal.time, signal.activateAt)))
+	{
+		return false;
+	}
+	settle(signal, signal.time);
+
+	auto side = item.find(JsonValue::SIDE);
+	if (side != item.end())
+	{
+		if (*side == JsonValue::SIDE_BUY)
+		{
+			signal.side = SIDE_BUY;
+		}
+		else if (*side == JsonValue::SIDE_SELL)
+		{
+			signal.side = SIDE_SELL;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	auto quantity = item.find(JsonValue::QUANTITY);
+	if (quantity != item.end())
+	{
+		if (!toFixed(*quantity, SignalSettings::QTY_SCALE, SignalSettings::MAX_QUANTITY, signal.quantity))
+		{
+			return false;
+		}
+		signal.flags |= SIGNAL_QUANTITY;
+	}
+
+	auto percent = item.find(JsonValue::PERCENT);
+	if (percent != item.end())
+	{
+		int64_t value = 0;
+		if (!toFixed(*percent, SignalSettings::PCT_SCALE, SignalSettings::MAX_PERCENT, value))
+		{
+			return false;
+		}
+		signal.percent = static_cast<int32_t>(value);
+		signal.flags |= SIGNAL_PERCENT;
+	}
+
+	auto text = item.find(JsonValue::LIMITS);
+	if (text != item.end())
+	{
+		if (!text->is_string() || text->get_ref<const std::string&>().size() > SignalSettings::MAX_LIMITS_LEN)
+		{
+			return false;
+		}
+		limits = text->get_ref<const std::string&>();
+	}
+	else if (signal.side != SIDE_NONE)
+	{
+		// Текст для клиентов, которые читают только limits: "buy 1.5 (50%)"
+		limits = (signal.side == SIDE_BUY) ? JsonValue::SIDE_BUY : JsonValue::SIDE_SELL;
+		if (signal.flags & SIGNAL_QUANTITY)
+		{
+			limits += ' ' + formatFixed(signal.quantity, SignalSettings::QTY_SCALE);
+		}
+		if (signal.flags & SIGNAL_PERCENT)
+		{
+			limits += " (" + formatFixed(signal.percent, SignalSettings::PCT_SCALE) + "%)";
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+// Строковое поле сохранённого сигнала, пустая строка - поля нет или оно другого типа
+static std::string textField(const nlohmann::json& value, const std::string& field)
+{
+	auto found = value.find(field);
+
+	return (found != value.end() && found->is_string()) ? found->get<std::string>() : std::string();
+}
+
+// Время сохранённого сигнала, 0 - поля нет или оно не беззнаковое целое
+static uint64_t timeField(const nlohmann::json& value, const std::string& field)
+{
+	auto found = value.find(field);
+
+	return (found != value.end() && found->is_number_unsigned()) ? found->get<uint64_t>() : 0;
+}
+
+
+// Сохраняет сигнал объектом JSON с числами в фиксированной точке
+std::string SignalCodec::encode(const Signal& signal, 
+								const std::string& limits)
+{
+	nlohmann::json stored;
+	stored[SignalSettings::FIELD_LIMITS] = limits;
+	stored[SignalSettings::FIELD_TIME] = signal.time;
+	if (signal.activateAt)
+	{
+		stored[SignalSettings::FIELD_ACTIVATE] = signal.activateAt;
+	}
+	if (signal.expiresAt)
+	{
+		stored[SignalSettings::FIELD_EXPIRE] = signal.expiresAt;
+	}
+	if (signal.side != SIDE_NONE)
+	{
+		stored[SignalSettings::FIELD_SIDE] = (signal.side == SIDE_BUY) ? JsonValue::SIDE_BUY : JsonValue::SIDE_SELL;
+	}
+	if (signal.flags & SIGNAL_QUANTITY)
+	{
+		stored[SignalSettings::FIELD_QTY] = signal.quantity;
+	}
+	if (signal.flags & SIGNAL_PERCENT)
+	{
+		stored[SignalSettings::FIELD_PCT] = signal.percent;
+	}
+
+	return stored.dump();
+}
+
+// Читает значение из хранилища, значение не в формате JSON - старый текст limits
+// Видимость сигнала определяется на момент чтения
+void SignalCodec::decode(		const std::string& stored, 
+								Signal& signal, 
+								std::string& limits)
+{
+	signal = Signal{};
+	signal.flags = SIGNAL_ACTIVE;
+
+	nlohmann::json value = stored.starts_with('{') ? 
+		nlohmann::json::parse(stored, nullptr, false) : nlohmann::json(nlohmann::json::value_t::discarded);
+	if (!value.is_object())
+	{
+		limits = stored;
+
+		return;
+	}
+
+	// Поле другого типа считается отсутствующим: value() бросил бы type_error на чужую или повреждённую запись
+	limits = textField(value, SignalSettings::FIELD_LIMITS);
+	signal.time = timeField(value, SignalSettings::FIELD_TIME);
+	signal.activateAt = timeField(value, SignalSettings::FIELD_ACTIVATE);
+	signal.expiresAt = timeField(value, SignalSettings::FIELD_EXPIRE);
+	settle(signal, now());
+
+	std::string side = textField(value, SignalSettings::FIELD_SIDE);
+	signal.side = (side == JsonValue::SIDE_BUY) ? SIDE_BUY : (side == JsonValue::SIDE_SELL) ? SIDE_SELL : SIDE_NONE;
+
+	auto quantity = value.find(SignalSettings::FIELD_QTY);
+	if (quantity != value.end() && quantity->is_number_integer())
+	{
+		signal.quantity = quantity->get<int64_t>();
+		signal.flags |= SIGNAL_QUANTITY;
+	}
+
+	auto percent = value.find(SignalSettings::FIELD_PCT);
+	if (percent != value.end() && percent->is_number_integer())
+	{
+		signal.percent = percent->get<int32_t>();
+		signal.flags |= SIGNAL_PERCENT;
+	}
+}
+
+// Добавляет limits и заполненные типизированные поля
+void SignalCodec::toJson(		const Signal& signal, 
+								const std::string& limits, 
+								MessageJson& message)
+{
+	message[JsonValue::LIMITS] = limits;
+	if (signal.side != SIDE_NONE)
+	{
+		message[JsonValue::SIDE] = (signal.side == SIDE_BUY) ? JsonValue::SIDE_BUY : JsonValue::SIDE_SELL;
+	}
+	if (signal.flags & SIGNAL_QUANTITY)
+	{
+		message[JsonValue::QUANTITY] = static_cast<double>(signal.quantity) / SignalSettings::QTY_SCALE;
+	}
+	if (signal.flags & SIGNAL_PERCENT)
+	{
+		message[JsonValue::PERCENT] = static_cast<double>(signal.percent) / SignalSettings::PCT_SCALE;
+	}
+	if (signal.time)
+	{
+		message[JsonValue::TIME] = signal.time;
+	}
+	if (signal.activateAt)
+	{
+		message[JsonValue::ACTIVATE_AT] = signal.activateAt;
+	}
+	if (signal.expiresAt)
+	{
+		message[JsonValue::EXPIRES_AT] = signal.expiresAt;
+	}
+}
+
+// Записывает число с фиксированной точкой без лишних нулей: 15000 при масштабе 10000 - "1.5"
+std::string SignalCodec::formatFixed(int64_t value, 
+								int64_t scale)
+{
+	std::string result = std::to_string(value / scale);
+	int64_t fraction = value % scale;
+	if (fraction)
+	{
+		std::string digits = std::to_string(scale + fraction).substr(1);
+		digits.erase(digits.find_last_not_of('0') + 1);
+		result += '.' + digits;
+	}
+
+	return result;
+}
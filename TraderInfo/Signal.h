@@ -0,0 +1,92 @@
+#ifndef SIGNAL_H
+#define SIGNAL_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "Arena.h"
+
+
+// Направление сигнала
+enum Side : uint8_t
+{
+	SIDE_NONE	= 0,	// не указано, сигнал задан только текстом
+	SIDE_BUY	= 1,
+	SIDE_SELL	= 2
+};
+
+// Признаки заполненности полей сигнала
+enum SignalFlag : uint8_t
+{
+	SIGNAL_ACTIVE	= 1,	// виден подписчикам
+	SIGNAL_QUANTITY	= 2,
+	SIGNAL_PERCENT	= 4,
+	SIGNAL_PENDING	= 8		// хранится, но ещё не активирован или уже истёк
+};
+
+// Сигнал в памяти, текст limits хранится отдельно от него
+struct Signal
+{
+	uint64_t	time		= 0;	// время изменения, мс от эпохи Unix
+	uint64_t	activateAt	= 0;	// время активации, 0 - сразу
+	uint64_t	expiresAt	= 0;	// время снятия, 0 - бессрочно
+	int64_t		quantity	= 0;	// количество в единицах 1/QTY_SCALE
+	int32_t		percent		= 0;	// доля в единицах 1/PCT_SCALE процента
+	uint32_t	tickerId	= 0;	// номер тикера в книге сигналов
+	Side		side		= SIDE_NONE;
+	uint8_t		flags		= 0;
+};
+
+static_assert(sizeof(Signal) == 48, "Signal must stay compact");
+
+
+// Разбор, проверка и преобразование сигналов
+// Старые клиенты передают и получают только текст limits, поэтому он всегда заполнен
+class SignalCodec
+{
+private:
+	static bool toTime(			const MessageJson& value, 
+								uint64_t& result);
+
+	static bool toFixed(		const MessageJson& value, 
+								int64_t scale, 
+								int64_t maximum, 
+								int64_t& result);
+
+
+public:
+	static bool validTicker(	std::string_view tickerSymbol);
+
+	// Разбирает поля команды add, при отсутствии limits формирует текст из полей
+	static bool parse(			const MessageJson& item, 
+								Signal& signal, 
+								std::string& limits);
+
+	// Выставляет SIGNAL_ACTIVE или SIGNAL_PENDING по времени активации и снятия
+	static void settle(			Signal& signal, 
+								uint64_t now);
+
+	// Текущее время в миллисекундах от эпохи Unix
+	static uint64_t now();
+
+	// Значение сигнала для хранилища
+	static std::string encode(	const Signal& signal, 
+								const std::string& limits);
+
+	// Читает значение из хранилища, старое текстовое значение становится limits
+	static void decode(			const std::string& stored, 
+								Signal& signal, 
+								std::string& limits);
+
+	// Добавляет поля сигнала в сообщение клиенту
+	static void toJson(			const Signal& signal, 
+								const std::string& limits, 
+								MessageJson& message);
+
+	static std::string formatFixed(int64_t value, 
+								int64_t scale);
+
+};
+
+#endif // !SIGNAL_H
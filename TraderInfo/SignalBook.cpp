@@ -0,0 +1,406 @@
+#include "SignalBook.h"
+
+#include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "Storage.h"
+#include "Signal.h"
+#include "Dao.h"
+#include "SignalScheduler.h"
+#include "EventsConst.h"
+#include "Arena.h"
+#include "SnapshotFile.h"
+
+
+// Инициализация логгера
+Logger SignalBook::m_log("SignalBook", LoggerSettings::TYPE_LOG);
+
+
+// Выдаёт тикеру номер, номера не переиспользуются до перезапуска
+uint32_t SignalBook::intern(	Book& book, 
+								const std::string& tickerSymbol)
+{
+	auto [id, created] = m_ids.try_emplace(tickerSymbol, static_cast<uint32_t>(m_ids.size()));
+	if (book.tickers.size() <= id->second)
+	{
+		book.tickers.resize(id->second + 1);
+		book.signals.resize(id->second + 1);
+		book.limits.resize(id->second + 1);
+		book.revisions.resize(id->second + 1);
+		book.frames.resize(id->second + 1);
+	}
+	book.tickers[id->second] = tickerSymbol;
+
+	return id->second;
+}
+
+// Сериализует сигнал один раз для всех авторизаций до его следующего изменения
+void SignalBook::frame(			Book& book, 
+								uint32_t tickerId)
+{
+	const Signal& signal = book.signals[tickerId];
+	if (!(signal.flags & SIGNAL_ACTIVE))
+	{
+		book.frames[tickerId].reset();
+
+		return;
+	}
+
+	MessageJson message;
+	message[JsonValue::COMMAND] = JsonValue::ACTIVE_SIGNAL;
+	if (!m_channelName.empty())
+	{
+		message[JsonValue::CHANNEL] = m_channelName;
+	}
+	message[JsonValue::TICKER] = book.tickers[tickerId];
+	SignalCodec::toJson(signal, book.limits[tickerId], message);
+
+	book.frames[tickerId] = std::make_shared<const std::string>(message.dump());
+}
+
+
+// Загружает все сигналы из хранилища
+// Если за время чтения книгу изменили, загрузка отбрасывается до следующего раза
+void SignalBook::load(			Storage& storage, 
+								const Reload& reload)
+{
+	uint64_t writes = 0;
+	{
+		std::unique_lock ul(m_mtx);
+		writes = m_writes;
+	}
+
+	std::map<std::string, std::string> stored;
+	storage.hGetAll(m_signalsDb, stored);
+
+	std::unique_lock ul(m_mtx);
+
+	if (writes != m_writes)
+	{
+		m_log.info("Signals of the channel \"" + m_channelName + "\" changed while loading, the load is skipped.", 
+			m_log.getContext(), "SignalBook::load " + std::to_string(__LINE__));
+
+		return;
+	}
+
+	rebuild(stored, 0, reload);
+}
+
+// Восстанавливает книгу из снимка, загруженная из хранилища книга не заменяется
+void SignalBook::restore(		const std::map<std::string, std::string>& stored, 
+								uint64_t version, 
+								const Reload& reload)
+{
+	std::unique_lock ul(m_mtx);
+
+	if (m_book.load())
+	{
+		return;
+	}
+
+	rebuild(stored, version, reload);
+}
+
+// Собирает книгу из значений хранилища
+// Неизменённые сигналы сохраняют видимость и сообщения снимка прежней книги,
+// видимые изменения собираются в пакет для подписчиков, как при публикации пакета администратором
+void SignalBook::rebuild(		const std::map<std::string, std::string>& stored, 
+								uint64_t version, 
+								const Reload& reload)
+{
+	std::shared_ptr<const Book> current = m_book.load();
+	auto book = std::make_shared<Book>();
+	book->version = std::max(version, current ? current->version + 1 : 1);
+	if (current)
+	{
+		book->tickers = current->tickers;
+	}
+	book->tickers.resize(m_ids.size());
+	book->signals.resize(m_ids.size());
+	book->limits.resize(m_ids.size());
+	book->revisions.resize(m_ids.size());
+	book->frames.resize(m_ids.size());
+
+	MessageJson items = MessageJson::array();
+	std::vector<bool> seen(m_ids.size());
+	bool changed = !current;
+	auto visible = [&current](uint32_t id)
+	{
+		return current && id < current->signals.size() && (current->signals[id].flags & SIGNAL_ACTIVE);
+	};
+	// Время изменения не различает две записи одной миллисекунды, поэтому сравниваются все поля
+	auto same = [&current, &book](uint32_t id)
+	{
+		const Signal& was = current->signals[id];
+		const Signal& now = book->signals[id];
+		return was.time == now.time && was.activateAt == now.activateAt && was.expiresAt == now.expiresAt && 
+			was.quantity == now.quantity && was.percent == now.percent && was.side == now.side && 
+			(was.flags & (SIGNAL_QUANTITY | SIGNAL_PERCENT)) == (now.flags & (SIGNAL_QUANTITY | SIGNAL_PERCENT)) && 
+			current->limits[id] == book->limits[id];
+	};
+
+	for (const auto& [tickerSymbol, value] : stored)
+	{
+		uint32_t id = intern(*book, tickerSymbol);
+		Signal& signal = book->signals[id];
+		SignalCodec::decode(value, signal, book->limits[id]);
+		signal.tickerId = id;
+		if (seen.size() <= id)
+		{
+			seen.resize(id + 1);
+		}
+		seen[id] = true;
+
+		// Неизменённый сигнал сохраняет видимость, её меняют только таймеры,
+		// новому сигналу ставятся таймеры активации и снятия
+		if (current && id < current->signals.size() && same(id) && 
+			(current->signals[id].flags & (SIGNAL_ACTIVE | SIGNAL_PENDING)))
+		{
+			signal.flags = current->signals[id].flags;
+			book->revisions[id] = current->revisions[id];
+			book->frames[id] = current->frames[id];
+		}
+		else
+		{
+			changed = true;
+			book->revisions[id] = book->version;
+			SignalScheduler::schedule(m_channelId, signal, book->revisions[id]);
+			frame(*book, id);
+
+			MessageJson item;
+			if (signal.flags & SIGNAL_ACTIVE)
+			{
+				item[JsonValue::COMMAND] = JsonValue::ADD_SIGNAL;
+				item[JsonValue::TICKER] = tickerSymbol;
+				SignalCodec::toJson(signal, book->limits[id], item);
+				items.push_back(std::move(item));
+			}
+			else if (visible(id))
+			{
+				item[JsonValue::COMMAND] = JsonValue::DEL_SIGNAL;
+				item[JsonValue::TICKER] = tickerSymbol;
+				items.push_back(std::move(item));
+			}
+		}
+		book->count += (signal.flags & SIGNAL_ACTIVE) ? 1 : 0;
+	}
+
+	// Сигналы, удалённые из хранилища мимо сервера
+	for (uint32_t id = 0; current && id < current->signals.size(); ++id)
+	{
+		if ((id < seen.size() && seen[id]) || !(current->signals[id].flags & (SIGNAL_ACTIVE | SIGNAL_PENDING)))
+		{
+			continue;
+		}
+
+		changed = true;
+		if (visible(id))
+		{
+			MessageJson item;
+			item[JsonValue::COMMAND] = JsonValue::DEL_SIGNAL;
+			item[JsonValue::TICKER] = current->tickers[id];
+			items.push_back(std::move(item));
+		}
+	}
+
+	// Книга с тем же содержимым не подменяется: версия не растёт, файл снимка не переписывается
+	if (!changed)
+	{
+		return;
+	}
+
+	std::string message;
+	if (!items.empty())
+	{
+		MessageJson batch;
+		batch[JsonValue::COMMAND] = JsonValue::BATCH;
+		if (!m_channelName.empty())
+		{
+			batch[JsonValue::CHANNEL] = m_channelName;
+		}
+		batch[JsonValue::ITEMS] = std::move(items);
+		batch[JsonValue::VERSION] = book->version;
+		message = batch.dump();
+	}
+
+	store(book, [&reload, &message](const std::shared_ptr<const Book>& stored)
+		{
+			if (reload)
+			{
+				reload(stored, message);
+			}
+		}
+	);
+
+	m_log.info("Loaded " + std::to_string(book->count) + " signal(s) of the channel \"" + m_channelName + '"', 
+		m_log.getContext(), "SignalBook::rebuild " + std::to_string(__LINE__));
+}
+
+// Подменяет книгу, файл снимка перепишется главным потоком
+void SignalBook::store(			const std::shared_ptr<const Book>& book, 
+								const Publish& publish)
+{
+	m_book.store(book);
+	SnapshotFile::changed();
+	if (publish)
+	{
+		publish(book);
+	}
+}
+
+// Возвращает текущую книгу, не обращаясь к хранилищу
+std::shared_ptr<const SignalBook::Book> SignalBook::latest() const
+{
+	return m_book.load();
+}
+
+// Проверяет наличие сигнала по книге, не обращаясь к хранилищу
+bool SignalBook::holds(			const std::string& tickerSymbol)
+{
+	std::unique_lock ul(m_mtx);
+
+	std::shared_ptr<const Book> current = m_book.load();
+	auto id = m_ids.find(tickerSymbol);
+	if (!current || id == m_ids.end() || id->second >= current->signals.size())
+	{
+		return false;
+	}
+
+	return current->signals[id->second].flags & (SIGNAL_ACTIVE | SIGNAL_PENDING);
+}
+
+// Собирает новую книгу с применёнными изменениями
+void SignalBook::apply(			const std::vector<SignalChange>& changes, 
+								const std::vector<bool>& results, 
+								const Publish& publish)
+{
+	std::unique_lock ul(m_mtx);
+
+	++m_writes;
+	std::shared_ptr<const Book> current = m_book.load();
+	auto book = current ? std::make_shared<Book>(*current) : std::make_shared<Book>();
+	++book->version;
+
+	for (size_t index = 0; index < changes.size() && index < results.size(); ++index)
+	{
+		if (!results[index])
+		{
+			continue;
+		}
+
+		const SignalChange& change = changes[index];
+		uint32_t id = intern(*book, change.tickerSymbol);
+		bool active = book->signals[id].flags & SIGNAL_ACTIVE;
+		if (change.remove)
+		{
+			book->signals[id] = Signal{};
+			book->limits[id].clear();
+			book->count -= active ? 1 : 0;
+		}
+		else
+		{
+			book->signals[id] = change.signal;
+			book->limits[id] = change.limits;
+			book->count -= active ? 1 : 0;
+			book->count += (change.signal.flags & SIGNAL_ACTIVE) ? 1 : 0;
+		}
+		book->signals[id].tickerId = id;
+		book->revisions[id] = book->version;
+
+		if (!change.remove)
+		{
+			SignalScheduler::schedule(m_channelId, book->signals[id], book->revisions[id]);
+		}
+		frame(*book, id);
+	}
+
+	store(book, publish);
+}
+
+// Делает отложенный сигнал видимым
+bool SignalBook::activate(		uint32_t tickerId, 
+								uint64_t revision, 
+								SignalChange& change, 
+								const Publish& publish)
+{
+	std::unique_lock ul(m_mtx);
+
+	std::shared_ptr<const Book> current = m_book.load();
+	if (!current || tickerId >= current->signals.size())
+	{
+		return false;
+	}
+
+	const Signal& signal = current->signals[tickerId];
+	if (current->revisions[tickerId] != revision || !(signal.flags & SIGNAL_PENDING) || (signal.expiresAt && signal.expiresAt <= SignalCodec::now()))
+	{
+		return false;
+	}
+
+	++m_writes;
+	auto book = std::make_shared<Book>(*current);
+	++book->version;
+	++book->count;
+	book->signals[tickerId].flags = static_cast<uint8_t>((signal.flags & ~SIGNAL_PENDING) | SIGNAL_ACTIVE);
+	frame(*book, tickerId);
+
+	change.tickerSymbol = book->tickers[tickerId];
+	change.signal = book->signals[tickerId];
+	change.limits = book->limits[tickerId];
+
+	store(book, publish);
+
+	return true;
+}
+
+// Снимает сигнал по сроку
+bool SignalBook::expire(		uint32_t tickerId, 
+								uint64_t revision, 
+								SignalChange& change, 
+								bool& visible, 
+								const Publish& publish)
+{
+	std::unique_lock ul(m_mtx);
+
+	std::shared_ptr<const Book> current = m_book.load();
+	if (!current || tickerId >= current->signals.size())
+	{
+		return false;
+	}
+
+	const Signal& signal = current->signals[tickerId];
+	if (current->revisions[tickerId] != revision || !(signal.flags & (SIGNAL_ACTIVE | SIGNAL_PENDING)))
+	{
+		return false;
+	}
+	visible = signal.flags & SIGNAL_ACTIVE;
+
+	change.tickerSymbol = current->tickers[tickerId];
+	change.signal = signal;
+	change.limits = current->limits[tickerId];
+	change.remove = true;
+
+	++m_writes;
+	auto book = std::make_shared<Book>(*current);
+	++book->version;
+	book->count -= visible ? 1 : 0;
+	book->signals[tickerId] = Signal{};
+	book->signals[tickerId].tickerId = tickerId;
+	book->limits[tickerId].clear();
+	book->revisions[tickerId] = book->version;
+	book->frames[tickerId].reset();
+
+	store(book, publish);
+
+	return true;
+}
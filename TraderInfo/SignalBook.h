@@ -0,0 +1,131 @@
+#ifndef SIGNALBOOK_H
+#define SIGNALBOOK_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include "Logger.h"
+#include "Storage.h"
+#include "Signal.h"
+#include "Dao.h"
+
+
+// Книга активных сигналов канала в памяти
+// Тикеры получают постоянные номера, сигналы лежат в плоском массиве по номеру тикера
+// Книга неизменяема, изменение собирает новую копию и атомарно подменяет старую,
+// поэтому чтение не требует блокировок
+class SignalBook
+{
+public:
+	struct Book
+	{
+		uint64_t					version	= 0;	// растёт с каждым изменением
+		size_t						count	= 0;	// количество активных сигналов
+		std::vector<Signal>			signals;		// по номеру тикера, неактивные без SIGNAL_ACTIVE
+		std::vector<std::string>	tickers;		// имена тикеров по номеру
+		std::vector<std::string>	limits;			// текст limits по номеру тикера
+		// Версия книги, в которой сигнал тикера последний раз изменился, по номеру тикера
+		// Служит версией таймеров сигнала: время изменения не различает две записи одной миллисекунды
+		std::vector<uint64_t>		revisions;
+		// Готовые сообщения снимка по номеру тикера, пустые у неактивных
+		// Копия книги делит их с оригиналом, пересобираются только изменённые
+		std::vector<std::shared_ptr<const std::string>> frames;
+	};
+
+	// Получает новую книгу под блокировкой писателей, поэтому книги рассылаются в порядке версий
+	using Publish = std::function<void(const std::shared_ptr<const Book>&)>;
+	// Получает перечитанную книгу и сообщение подписчикам с изменёнными сигналами, пустое, если видимых изменений нет
+	using Reload = std::function<void(const std::shared_ptr<const Book>&, const std::string&)>;
+
+
+private:
+	static Logger								m_log;
+
+	const uint32_t								m_channelId;
+	const std::string							m_channelName;	// пустое у канала по умолчанию
+	const std::string							m_signalsDb;
+	// Блокировка писателей, читатели берут снимок без неё
+	std::mutex									m_mtx;
+	std::unordered_map<std::string, uint32_t>	m_ids;
+	std::atomic<std::shared_ptr<const Book>>	m_book;
+	uint64_t									m_writes	= 0;
+
+
+	// Выдаёт номер тикеру, вызывается под блокировкой
+	uint32_t intern(			Book& book, 
+								const std::string& tickerSymbol);
+
+	// Собирает сообщение снимка для сигнала тикера
+	void frame(					Book& book, 
+								uint32_t tickerId);
+
+	// Собирает книгу из значений хранилища, вызывается под блокировкой
+	// Книга не подменяется, если содержимое не изменилось
+	// uint64_t version - наименьшая версия новой книги
+	void rebuild(				const std::map<std::string, std::string>& stored, 
+								uint64_t version, 
+								const Reload& reload);
+
+	// Подменяет книгу, отмечает изменение для файла снимка и передаёт книгу рассылке
+	// Вызывается под блокировкой
+	void store(					const std::shared_ptr<const Book>& book, 
+								const Publish& publish);
+
+
+public:
+	SignalBook(					uint32_t channelId, 
+								const std::string& channelName, 
+								const std::string& signalsDb) : m_channelId(channelId), m_channelName(channelName), m_signalsDb(signalsDb)
+	{
+	}
+
+	SignalBook(const SignalBook&) = delete;
+	SignalBook& operator=(const SignalBook&) = delete;
+
+
+	// Загружает книгу из хранилища, вызывается при запуске и периодически
+	void load(					Storage& storage, 
+								const Reload& reload = nullptr);
+
+	// Восстанавливает книгу из файла снимка, если её не удалось загрузить из хранилища
+	void restore(				const std::map<std::string, std::string>& stored, 
+								uint64_t version, 
+								const Reload& reload = nullptr);
+
+	// Текущая книга без загрузки, пустая до первой загрузки
+	std::shared_ptr<const Book> latest() const;
+
+	// Есть ли у тикера сигнал, видимый или ждущий активации
+	bool holds(					const std::string& tickerSymbol);
+
+	// Применяет успешно записанные в хранилище изменения
+	void apply(					const std::vector<SignalChange>& changes, 
+								const std::vector<bool>& results, 
+								const Publish& publish = nullptr);
+
+	// Делает отложенный сигнал видимым, если он не менялся с постановки таймера
+	// uint64_t revision - версия сигнала из таймера
+	// SignalChange& change - параметр вывода
+	bool activate(				uint32_t tickerId, 
+								uint64_t revision, 
+								SignalChange& change, 
+								const Publish& publish = nullptr);
+
+	// Снимает сигнал по сроку, если он не менялся с постановки таймера
+	// SignalChange& change, bool& visible - параметры вывода
+	bool expire(				uint32_t tickerId, 
+								uint64_t revision, 
+								SignalChange& change, 
+								bool& visible, 
+								const Publish& publish = nullptr);
+
+};
+
+#endif // !SIGNALBOOK_H
@@ -0,0 +1,202 @@
+#include "SignalScheduler.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include <uwebsockets/App.h>
+#include <nlohmann/json.hpp>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "EventsConst.h"
+#include "Signal.h"
+#include "SignalBook.h"
+#include "ChannelRegistry.h"
+#include "SignalSettings.h"
+#include "TimerWheel.h"
+#include "LoopRegistry.h"
+#include "Dao.h"
+
+
+// Инициализация статических членов
+Logger SignalScheduler::m_log("SignalScheduler", LoggerSettings::TYPE_LOG);
+std::mutex SignalScheduler::m_mtx;
+TimerWheel<SignalTimer> SignalScheduler::m_wheel(SignalSettings::TIMER_TICK_MS, SignalCodec::now());
+us_timer_t* SignalScheduler::m_timer = nullptr;
+ServerLoop* SignalScheduler::m_loop = nullptr;
+
+
+// Ставит таймеры сигнала, срок в прошлом срабатывает на ближайшем тике
+void SignalScheduler::schedule(	uint32_t channelId, 
+								const Signal& signal, 
+								uint64_t revision)
+{
+	std::unique_lock ul(m_mtx);
+
+	if (signal.activateAt && (signal.flags & SIGNAL_PENDING) && (!signal.expiresAt || signal.activateAt < signal.expiresAt))
+	{
+		m_wheel.add({ signal.activateAt, revision, channelId, signal.tickerId, TIMER_ACTIVATE });
+	}
+	if (signal.expiresAt)
+	{
+		m_wheel.add({ signal.expiresAt, revision, channelId, signal.tickerId, TIMER_EXPIRE });
+	}
+}
+
+
+// Запускает таймер колеса на цикле событий
+void SignalScheduler::start(	ServerLoop* loop)
+{
+	{
+		std::unique_lock ul(m_mtx);
+		m_loop = loop;
+		m_timer = us_create_timer(reinterpret_cast<us_loop_t*>(loop), 0, 0);
+		us_timer_set(m_timer, onTick, SignalSettings::TIMER_TICK_MS, SignalSettings::TIMER_TICK_MS);
+	}
+
+	m_log.info("Signal scheduler started.", m_log.getContext(), "SignalScheduler::start " + std::to_string(__LINE__));
+}
+
+// Останавливает таймер колеса, чтобы цикл мог завершиться
+// Снятия, поставленные в очереди каналов, выполнит остановка StorageWorker,
+// пропущенные сроки выполнит следующий запуск при загрузке книг
+void SignalScheduler::stop(		ServerLoop* loop)
+{
+	std::unique_lock ul(m_mtx);
+	if (!m_timer || m_loop != loop)
+	{
+		return;
+	}
+
+	us_timer_close(m_timer);
+	m_timer = nullptr;
+	m_loop = nullptr;
+}
+
+// Таймер цикла колеса
+void SignalScheduler::onTick(	us_timer_t* /*timer*/)
+{
+	tick(Storage::instance());
+}
+
+// Продвигает колесо до текущего времени, сработавшие таймеры выполняются вне блокировки
+void SignalScheduler::tick(		Storage& storage)
+{
+	std::vector<SignalTimer> due;
+	{
+		std::unique_lock ul(m_mtx);
+		m_wheel.advance(SignalCodec::now(), due);
+	}
+
+	for (const SignalTimer& timer : due)
+	{
+		if (timer.type == TIMER_ACTIVATE)
+		{
+			activate(timer);
+
+			continue;
+		}
+
+		std::shared_ptr<Channel> channel = ChannelRegistry::get(timer.channelId);
+		if (channel)
+		{
+			ChannelRegistry::write(*channel, [&storage, &channel = *channel, timer]()
+				{
+					remove(storage, channel, timer);
+					expire(channel, timer);
+				}
+			);
+		}
+	}
+}
+
+
+// Активирует отложенный сигнал и рассылает его подписчикам процесса
+void SignalScheduler::activate(	const SignalTimer& timer)
+{
+	std::shared_ptr<Channel> channel = ChannelRegistry::get(timer.channelId);
+	if (!channel)
+	{
+		return;
+	}
+
+	SignalChange change;
+	bool activated = channel->book.activate(timer.tickerId, timer.version, change, 
+		[&](const std::shared_ptr<const SignalBook::Book>& book)
+		{
+			MessageJson resBroadcast;
+			resBroadcast[JsonValue::COMMAND] = JsonValue::ADD_SIGNAL;
+			channel->tag(resBroadcast);
+			resBroadcast[JsonValue::TICKER] = change.tickerSymbol;
+			resBroadcast[JsonValue::VERSION] = book->version;
+			SignalCodec::toJson(change.signal, change.limits, resBroadcast);
+			LoopRegistry::publish(BookUpdate{ channel->id, book, channel->topic, resBroadcast.dump() });
+		}
+	);
+	if (!activated)
+	{
+		return;
+	}
+
+	m_log.info("The signal for the ticker \"" + change.tickerSymbol + "\" is activated.", 
+		m_log.getContext(), "SignalScheduler::activate " + std::to_string(__LINE__));
+}
+
+// Удаляет значение из хранилища, только если его не заменили,
+// другие процессы с тем же хранилищем увидят, что сигнал уже снят
+// Проверка и удаление идут в очереди записей канала, поэтому новое значение администратора не удаляется
+void SignalScheduler::remove(	Storage& storage, 
+								const Channel& channel, 
+								const SignalTimer& timer)
+{
+	std::shared_ptr<const SignalBook::Book> book = channel.book.latest();
+	if (!book || timer.tickerId >= book->tickers.size() || book->revisions[timer.tickerId] != timer.version)
+	{
+		return;
+	}
+	const std::string& tickerSymbol = book->tickers[timer.tickerId];
+	const std::string& limits = book->limits[timer.tickerId];
+
+	// Значение, заменённое мимо сервера или другим процессом, отличается от сигнала книги и не удаляется
+	Dao db(storage);
+	if (db.getSignal(channel.keys, tickerSymbol, SignalSettings::SCHEDULER_AUTHOR) == SignalCodec::encode(book->signals[timer.tickerId], limits) && 
+		db.delSignal(channel.keys, tickerSymbol, SignalSettings::SCHEDULER_AUTHOR))
+	{
+		db.addHistory(channel.keys, JsonValue::EXPIRE, tickerSymbol, limits, SignalSettings::SCHEDULER_AUTHOR, SignalSettings::SCHEDULER_AUTHOR);
+	}
+}
+
+// Снимает сигнал и рассылает изменение подписчикам процесса
+// Снятие невидимого сигнала подписчикам не рассылается, циклы получают только новую книгу
+void SignalScheduler::expire(	Channel& channel, 
+								const SignalTimer& timer)
+{
+	SignalChange change;
+	bool visible = false;
+	bool expired = channel.book.expire(timer.tickerId, timer.version, change, visible, 
+		[&](const std::shared_ptr<const SignalBook::Book>& book)
+		{
+			BookUpdate update{ channel.id, book, channel.topic, {} };
+			if (visible)
+			{
+				MessageJson resBroadcast;
+				resBroadcast[JsonValue::COMMAND] = JsonValue::DEL_SIGNAL;
+				channel.tag(resBroadcast);
+				resBroadcast[JsonValue::TICKER] = change.tickerSymbol;
+				resBroadcast[JsonValue::VERSION] = book->version;
+				update.message = resBroadcast.dump();
+			}
+			LoopRegistry::publish(update);
+		}
+	);
+	if (!expired)
+	{
+		return;
+	}
+
+	m_log.info("The signal for the ticker \"" + change.tickerSymbol + "\" of the channel \"" + channel.name + "\" has expired.", 
+		m_log.getContext(), "SignalScheduler::expire " + std::to_string(__LINE__));
+}
@@ -0,0 +1,86 @@
+#ifndef SIGNALSCHEDULER_H
+#define SIGNALSCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+#include <uwebsockets/App.h>
+
+#include "Logger.h"
+#include "Signal.h"
+#include "TimerWheel.h"
+#include "Transport.h"
+#include "ChannelRegistry.h"
+#include "Storage.h"
+
+
+// Вид таймера сигнала
+enum SignalTimerType : uint8_t
+{
+	TIMER_ACTIVATE	= 1,
+	TIMER_EXPIRE	= 2
+};
+
+// Запись колеса таймеров сигналов
+struct SignalTimer
+{
+	uint64_t		due			= 0;	// срок, мс от эпохи Unix
+	uint64_t		version		= 0;	// версия сигнала в книге, устаревшие записи пропускаются
+	uint32_t		channelId	= 0;
+	uint32_t		tickerId	= 0;
+	SignalTimerType	type		= TIMER_ACTIVATE;
+};
+
+
+// Активация и снятие сигналов по времени
+// Колесо общее для процесса, его продвигает таймер одного цикла событий
+// Записи не отменяются: при срабатывании проверяется, что версия сигнала в книге не менялась
+// Снятие идёт через очередь записей канала, чтобы цикл не ждал Redis,
+// а удаление из хранилища и изменение книги шли в одном порядке с записями администраторов
+class SignalScheduler
+{
+private:
+	static Logger					m_log;
+	static std::mutex				m_mtx;		// колесо, таймер и цикл
+	static TimerWheel<SignalTimer>	m_wheel;
+	static us_timer_t*				m_timer;
+	static ServerLoop*				m_loop;		// цикл колеса, nullptr - колесо не запущено
+
+
+	static void onTick(			us_timer_t* timer);
+
+	// Делает отложенный сигнал видимым, выполняется в цикле колеса
+	static void activate(		const SignalTimer& timer);
+
+	// Удаляет снятый сигнал из хранилища, выполняется в очереди записей канала
+	static void remove(			Storage& storage, 
+								const Channel& channel, 
+								const SignalTimer& timer);
+
+	// Снимает сигнал с книги, выполняется в очереди записей канала после remove
+	static void expire(			Channel& channel, 
+								const SignalTimer& timer);
+
+
+public:
+	// Ставит таймеры активации и снятия сигнала, вызывается из любого потока
+	// uint64_t revision - версия сигнала в книге
+	static void schedule(		uint32_t channelId, 
+								const Signal& signal, 
+								uint64_t revision);
+
+	// Продвигает колесо до текущего времени и выполняет сработавшие таймеры
+	// Вызывается таймером цикла колеса с хранилищем процесса, тесты вызывают его напрямую
+	static void tick(			Storage& storage);
+
+	// Запускает колесо на цикле событий, вызывается из его потока
+	static void start(			ServerLoop* loop);
+
+	// Останавливает колесо, если оно запущено на этом цикле, вызывается из его потока
+	static void stop(			ServerLoop* loop);
+
+};
+
+#endif // !SIGNALSCHEDULER_H
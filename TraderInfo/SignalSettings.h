@@ -0,0 +1,39 @@
+#ifndef SIGNALSETTINGS_H
+#define SIGNALSETTINGS_H
+
+#include <string>
+#include <cstdint>
+
+
+// Настройки модели сигналов
+namespace SignalSettings
+{
+	// Количество и доля хранятся целыми числами с фиксированной точкой
+	const int64_t		QTY_SCALE		(10000);		// 4 знака после запятой
+	const int64_t		PCT_SCALE		(100);			// 2 знака после запятой
+	const int64_t		MAX_QUANTITY	(1000000000LL * QTY_SCALE);
+	const int64_t		MAX_PERCENT		(100 * PCT_SCALE);
+
+	const size_t		MAX_TICKER_LEN	(32U);
+	const size_t		MAX_LIMITS_LEN	(256U);
+
+	// Период перечитывания сигналов из хранилища
+	const unsigned int	REFRESH_MS		(5000U);
+
+	// Поля значения сигнала в хранилище, старые значения - просто текст limits
+	const std::string	FIELD_SIDE		{ "side" };
+	const std::string	FIELD_QTY		{ "qty" };
+	const std::string	FIELD_PCT		{ "pct" };
+	const std::string	FIELD_TIME		{ "ts" };
+	const std::string	FIELD_LIMITS	{ "limits" };
+	const std::string	FIELD_ACTIVATE	{ "activateAt" };
+	const std::string	FIELD_EXPIRE	{ "expiresAt" };
+
+	// Шаг колеса таймеров активации и снятия сигналов
+	const unsigned int	TIMER_TICK_MS	(10U);
+	// Автор записи журнала при снятии сигнала по сроку
+	const std::string	SCHEDULER_AUTHOR{ "scheduler" };
+
+}
+
+#endif // !SIGNALSETTINGS_H
@@ -0,0 +1,443 @@
+#include "SnapshotFile.h"
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "FailoverSettings.h"
+#include "Checksum.h"
+#include "ChannelRegistry.h"
+#include "SignalBook.h"
+#include "Signal.h"
+
+
+// Инициализация статических членов
+Logger SnapshotFile::m_log("SnapshotFile", LoggerSettings::TYPE_LOG);
+std::mutex SnapshotFile::m_mtx;
+std::atomic<bool> SnapshotFile::m_dirty{ false };
+char* SnapshotFile::m_data = nullptr;
+uint64_t SnapshotFile::m_sequence = 0;
+
+#if defined(_WIN32)
+// Файл остаётся открытым для сброса на диск
+static HANDLE s_file = INVALID_HANDLE_VALUE;
+#endif
+
+// Количество половин файла
+static const size_t SLOTS = 2;
+
+
+// Заголовок половины файла, за ним идёт содержимое снимка
+struct SlotHeader
+{
+	uint32_t	magic		= 0;
+	uint32_t	format		= 0;
+	uint64_t	sequence	= 0;	// номер снимка, растёт с каждой записью
+	uint64_t	length		= 0;	// длина содержимого
+	uint32_t	checksum	= 0;	// CRC-32 содержимого
+	uint32_t	reserved	= 0;
+};
+
+
+// Дописывает число или строку с длиной в содержимое снимка
+template <typename Number>
+static void put(std::string& out, Number value)
+{
+	out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void put(std::string& out, const std::string& value)
+{
+	put(out, static_cast<uint32_t>(value.size()));
+	out.append(value);
+}
+
+// Читает число или строку с длиной, false - содержимое кончилось
+template <typename Number>
+static bool take(std::string_view& in, Number& value)
+{
+	if (in.size() < sizeof(value))
+	{
+		return false;
+	}
+	std::memcpy(&value, in.data(), sizeof(value));
+	in.remove_prefix(sizeof(value));
+
+	return true;
+}
+
+static bool take(std::string_view& in, std::string& value)
+{
+	uint32_t length = 0;
+	if (!take(in, length) || in.size() < length)
+	{
+		return false;
+	}
+	value.assign(in.data(), length);
+	in.remove_prefix(length);
+
+	return true;
+}
+
+
+// Создаёт файл нужного размера и отображает его в память
+bool SnapshotFile::open()
+{
+	std::unique_lock ul(m_mtx);
+
+	if (m_data)
+	{
+		return true;
+	}
+
+	// Проверяем наличие директории для данных
+	if (!std::filesystem::exists(FailoverSettings::DIR))
+	{
+		std::filesystem::create_directories(FailoverSettings::DIR);
+	}
+
+	std::string path = FailoverSettings::DIR + "/" + FailoverSettings::SNAPSHOT_FILE;
+	size_t size = SLOTS * FailoverSettings::SLOT_SIZE;
+
+#if defined(__linux__)
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+		m_log.error("Failed to open the snapshot file \"" + path + "\": " + std::strerror(errno), 
+			m_log.getContext(), "SnapshotFile::open " + std::to_string(__LINE__));
+
+		return false;
+	}
+
+	// Отображение держит файл открытым само
+	void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		m_log.error("Failed to map the snapshot file \"" + path + "\": " + std::strerror(errno), 
+			m_log.getContext(), "SnapshotFile::open " + std::to_string(__LINE__));
+
+		return false;
+	}
+#elif defined(_WIN32)
+	s_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	// Отображение такого размера заодно растягивает файл
+	HANDLE mapping = (s_file == INVALID_HANDLE_VALUE) ? nullptr : 
+		CreateFileMappingA(s_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : nullptr;
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	if (!data)
+	{
+		m_log.error("Failed to map the snapshot file \"" + path + "\", error " + std::to_string(GetLastError()), 
+			m_log.getContext(), "SnapshotFile::open " + std::to_string(__LINE__));
+		if (s_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(s_file);
+			s_file = INVALID_HANDLE_VALUE;
+		}
+
+		return false;
+	}
+#else
+	void* data = nullptr;
+	m_log.warn("Memory-mapped snapshots are not supported on this platform.", 
+		m_log.getContext(), "SnapshotFile::open " + std::to_string(__LINE__));
+
+	return false;
+#endif
+
+	m_data = static_cast<char*>(data);
+
+	// Следующий снимок получит номер больше последнего целого
+	for (size_t slot = 0; slot < SLOTS; ++slot)
+	{
+		uint64_t sequence = 0;
+		std::string_view payload;
+		if (readSlot(slot, sequence, payload) && sequence > m_sequence)
+		{
+			m_sequence = sequence;
+		}
+	}
+
+	m_log.info("The snapshot file \"" + path + "\" is mapped, last snapshot " + std::to_string(m_sequence), 
+		m_log.getContext(), "SnapshotFile::open " + std::to_string(__LINE__));
+
+	return true;
+}
+
+// Снимает отображение файла
+void SnapshotFile::close()
+{
+	std::unique_lock ul(m_mtx);
+
+	if (!m_data)
+	{
+		return;
+	}
+
+#if defined(__linux__)
+	::munmap(m_data, SLOTS * FailoverSettings::SLOT_SIZE);
+#elif defined(_WIN32)
+	UnmapViewOfFile(m_data);
+	CloseHandle(s_file);
+	s_file = INVALID_HANDLE_VALUE;
+#endif
+	m_data = nullptr;
+}
+
+
+// Отмечает изменение книги
+void SnapshotFile::changed()
+{
+	m_dirty.store(true, std::memory_order_release);
+}
+
+// Записывает снимок в половину со старшим снимком и сбрасывает её на диск
+void SnapshotFile::flush()
+{
+	if (!m_dirty.exchange(false, std::memory_order_acq_rel))
+	{
+		return;
+	}
+
+	std::string payload = serialize();
+
+	std::unique_lock ul(m_mtx);
+
+	if (!m_data)
+	{
+		return;
+	}
+
+	if (payload.size() + sizeof(SlotHeader) > FailoverSettings::SLOT_SIZE)
+	{
+		m_log.error("The snapshot of " + std::to_string(payload.size()) + " bytes does not fit into FailoverSettings::SLOT_SIZE.", 
+			m_log.getContext(), "SnapshotFile::flush " + std::to_string(__LINE__));
+
+		return;
+	}
+
+	SlotHeader header;
+	header.magic = FailoverSettings::SNAPSHOT_MAGIC;
+	header.format = FailoverSettings::SNAPSHOT_FORMAT;
+	header.sequence = m_sequence + 1;
+	header.length = payload.size();
+	header.checksum = Checksum::crc32(payload);
+
+	char* slot = m_data + (header.sequence % SLOTS) * FailoverSettings::SLOT_SIZE;
+	std::memcpy(slot + sizeof(SlotHeader), payload.data(), payload.size());
+	std::memcpy(slot, &header, sizeof(SlotHeader));
+
+	size_t length = sizeof(SlotHeader) + payload.size();
+#if defined(__linux__)
+	bool synced = ::msync(slot, length, MS_SYNC) == 0;
+#elif defined(_WIN32)
+	bool synced = FlushViewOfFile(slot, length) && FlushFileBuffers(s_file);
+#else
+	bool synced = false;
+#endif
+	if (!synced)
+	{
+		m_log.error("Failed to sync the snapshot " + std::to_string(header.sequence) + " to disk.", 
+			m_log.getContext(), "SnapshotFile::flush " + std::to_string(__LINE__));
+	}
+
+	m_sequence = header.sequence;
+}
+
+// Читает последний целый снимок
+bool SnapshotFile::read(		std::vector<ChannelState>& channels)
+{
+	std::unique_lock ul(m_mtx);
+
+	if (!m_data)
+	{
+		return false;
+	}
+
+	// Берётся целая половина с большим номером, при ошибке разбора - другая
+	uint64_t sequences[SLOTS] = {};
+	std::string_view payloads[SLOTS];
+	bool valid[SLOTS] = {};
+	for (size_t slot = 0; slot < SLOTS; ++slot)
+	{
+		valid[slot] = readSlot(slot, sequences[slot], payloads[slot]);
+	}
+
+	size_t newest = (valid[1] && (!valid[0] || sequences[1] > sequences[0])) ? 1 : 0;
+	for (size_t slot : { newest, SLOTS - 1 - newest })
+	{
+		channels.clear();
+		if (valid[slot] && parse(payloads[slot], channels))
+		{
+			m_log.info("Read the snapshot " + std::to_string(sequences[slot]) + " with " + std::to_string(channels.size()) + " channel(s).", 
+				m_log.getContext(), "SnapshotFile::read " + std::to_string(__LINE__));
+
+			return true;
+		}
+	}
+
+	channels.clear();
+
+	return false;
+}
+
+// Проверяет заголовок и контрольную сумму половины файла, вызывается под блокировкой
+bool SnapshotFile::readSlot(	size_t slot, 
+								uint64_t& sequence, 
+								std::string_view& payload)
+{
+	const char* data = m_data + slot * FailoverSettings::SLOT_SIZE;
+
+	SlotHeader header;
+	std::memcpy(&header, data, sizeof(SlotHeader));
+	if (header.magic != FailoverSettings::SNAPSHOT_MAGIC || header.format != FailoverSettings::SNAPSHOT_FORMAT || 
+		header.length > FailoverSettings::SLOT_SIZE - sizeof(SlotHeader))
+	{
+		return false;
+	}
+
+	std::string_view content(data + sizeof(SlotHeader), static_cast<size_t>(header.length));
+	if (Checksum::crc32(content) != header.checksum)
+	{
+		m_log.warn("The snapshot " + std::to_string(header.sequence) + " has a wrong checksum, it is skipped.", 
+			m_log.getContext(), "SnapshotFile::readSlot " + std::to_string(__LINE__));
+
+		return false;
+	}
+
+	sequence = header.sequence;
+	payload = content;
+
+	return true;
+}
+
+
+// Сериализует каналы: имя, версия книги, участники и сигналы в формате хранилища
+std::string SnapshotFile::serialize()
+{
+	std::string out;
+	std::vector<std::shared_ptr<Channel>> channels = ChannelRegistry::all();
+	put(out, static_cast<uint32_t>(channels.size()));
+
+	for (const auto& channel : channels)
+	{
+		std::shared_ptr<const SignalBook::Book> book = channel->book.latest();
+		std::shared_ptr<const ChannelMembers> members = channel->members.load();
+
+		put(out, channel->name);
+		put(out, book ? book->version : uint64_t{ 0 });
+
+		for (const auto* logins : { &members->users, &members->admins })
+		{
+			put(out, static_cast<uint32_t>(logins->size()));
+			for (const std::string& login : *logins)
+			{
+				put(out, login);
+			}
+		}
+
+		// Сохраняются сигналы, которые лежат в хранилище: видимые и ждущие активации
+		std::vector<uint32_t> stored;
+		for (size_t id = 0; book && id < book->signals.size(); ++id)
+		{
+			if (book->signals[id].flags & (SIGNAL_ACTIVE | SIGNAL_PENDING))
+			{
+				stored.push_back(static_cast<uint32_t>(id));
+			}
+		}
+
+		put(out, static_cast<uint32_t>(stored.size()));
+		for (uint32_t id : stored)
+		{
+			put(out, book->tickers[id]);
+			put(out, SignalCodec::encode(book->signals[id], book->limits[id]));
+		}
+	}
+
+	return out;
+}
+
+// Разбирает содержимое снимка
+bool SnapshotFile::parse(		std::string_view payload, 
+								std::vector<ChannelState>& channels)
+{
+	uint32_t count = 0;
+	if (!take(payload, count))
+	{
+		return false;
+	}
+
+	for (uint32_t index = 0; index < count; ++index)
+	{
+		ChannelState channel;
+		if (!take(payload, channel.name) || !take(payload, channel.version))
+		{
+			return false;
+		}
+
+		for (auto* logins : { &channel.users, &channel.admins })
+		{
+			uint32_t size = 0;
+			if (!take(payload, size))
+			{
+				return false;
+			}
+			for (uint32_t item = 0; item < size; ++item)
+			{
+				std::string login;
+				if (!take(payload, login))
+				{
+					return false;
+				}
+				logins->insert(std::move(login));
+			}
+		}
+
+		uint32_t signals = 0;
+		if (!take(payload, signals))
+		{
+			return false;
+		}
+		for (uint32_t item = 0; item < signals; ++item)
+		{
+			std::string tickerSymbol;
+			std::string value;
+			if (!take(payload, tickerSymbol) || !take(payload, value))
+			{
+				return false;
+			}
+			channel.signals.emplace(std::move(tickerSymbol), std::move(value));
+		}
+
+		channels.push_back(std::move(channel));
+	}
+
+	return payload.empty();
+}
@@ -0,0 +1,73 @@
+#ifndef SNAPSHOTFILE_H
+#define SNAPSHOTFILE_H
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "Logger.h"
+
+
+// Снимок каналов и их книг сигналов в файле, отображённом в память
+// Файл делится на две половины с заголовком и контрольной суммой, новый снимок пишется на место старшего из двух,
+// поэтому оборванная запись не портит последний целый снимок
+// Снимок переписывает главный поток после изменения книг, при запуске без Redis книги восстанавливаются из него
+class SnapshotFile
+{
+public:
+	// Канал в снимке
+	struct ChannelState
+	{
+		std::string							name;		// пустое у канала по умолчанию
+		uint64_t							version	= 0;
+		std::set<std::string>				users;
+		std::set<std::string>				admins;
+		std::map<std::string, std::string>	signals;	// значения в формате хранилища
+	};
+
+
+private:
+	static Logger				m_log;
+	static std::mutex			m_mtx;
+	static std::atomic<bool>	m_dirty;
+	static char*				m_data;		// отображение файла, nullptr - файл не открыт
+	static uint64_t				m_sequence;	// номер последнего записанного снимка
+
+
+	// Собирает содержимое снимка из реестра каналов
+	static std::string serialize();
+
+	static bool parse(			std::string_view payload, 
+								std::vector<ChannelState>& channels);
+
+	// Проверяет половину файла и возвращает её содержимое
+	// uint64_t& sequence, std::string_view& payload - параметры вывода
+	static bool readSlot(		size_t slot, 
+								uint64_t& sequence, 
+								std::string_view& payload);
+
+
+public:
+	// Отображает файл в память, вызывается при запуске
+	static bool open();
+
+	// Отмечает изменение книги, вызывается под блокировкой книги и не обращается к диску
+	static void changed();
+
+	// Переписывает снимок, если книги менялись, вызывается главным потоком
+	static void flush();
+
+	// Читает последний целый снимок
+	// std::vector<ChannelState>& channels - параметр вывода
+	static bool read(			std::vector<ChannelState>& channels);
+
+	static void close();
+
+};
+
+#endif // !SNAPSHOTFILE_H
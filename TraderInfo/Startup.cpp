@@ -0,0 +1,261 @@
+#include "Startup.h"
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <chrono>
+
+#include <nlohmann/json.hpp>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "StartupSettings.h"
+#include "DaoSettings.h"
+#include "Storage.h"
+#include "Dao.h"
+#include "UserDirectory.h"
+#include "ChannelRegistry.h"
+#include "SnapshotFile.h"
+#include "FailoverSettings.h"
+
+
+// Инициализация статических членов
+Logger Startup::m_log("Startup", LoggerSettings::TYPE_LOG);
+std::mutex Startup::m_mtx;
+std::condition_variable Startup::m_cv;
+bool Startup::m_finished = false;
+bool Startup::m_warm = false;
+unsigned int Startup::m_loops = 0;
+unsigned int Startup::m_listening = 0;
+std::atomic<bool> Startup::m_ready{ false };
+std::atomic<bool> Startup::m_failed{ false };
+long long Startup::m_timings[Startup::PHASES] = {};
+
+// Имена этапов в отчёте
+static const char* const s_phaseNames[Startup::PHASES] = { "storage", "argon2", "users", "signals", "total" };
+
+
+// Выполняет функцию и возвращает её длительность в миллисекундах
+template <typename Function>
+static long long timed(Function&& function)
+{
+	auto start = std::chrono::steady_clock::now();
+	function();
+
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Подключается к хранилищу, повторяя попытки до успеха или сигнала остановки
+bool Startup::connectStorage(		const std::atomic<bool>& stop)
+{
+	while (!stop && !m_failed)
+	{
+		try
+		{
+			Storage::instance();
+
+			return true;
+		}
+		catch (const StorageError& err)
+		{
+			m_log.warn("Storage is unavailable, retrying in " + std::to_string(StartupSettings::STORAGE_RETRY_MS) + " ms: " + 
+				std::string(err.what()), m_log.getContext(), "Startup::connectStorage " + std::to_string(__LINE__));
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(StartupSettings::STORAGE_RETRY_MS));
+	}
+
+	return false;
+}
+
+// Будит ожидающие циклы событий
+void Startup::finish(				bool warm)
+{
+	{
+		std::unique_lock ul(m_mtx);
+		m_finished = true;
+		m_warm = warm;
+	}
+	m_cv.notify_all();
+}
+
+
+// Подключает хранилище, затем параллельно подбирает стоимость Argon2,
+// загружает справочник пользователей и каналы сигналов с готовыми сообщениями снимка
+bool Startup::run(					unsigned int loops, 
+									const std::atomic<bool>& stop)
+{
+	{
+		std::unique_lock ul(m_mtx);
+		m_loops = loops;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	if (FailoverSettings::SNAPSHOT)
+	{
+		SnapshotFile::open();
+	}
+
+	bool connected = false;
+	m_timings[PHASE_STORAGE] = timed([&]() { connected = connectStorage(stop); });
+	if (!connected)
+	{
+		m_log.warn("Startup is interrupted before the storage became available.", 
+			m_log.getContext(), "Startup::run " + std::to_string(__LINE__));
+		finish(false);
+
+		return false;
+	}
+
+	// Ошибки загрузки не останавливают запуск: справочник и книга загрузятся позже
+	auto argon2 = std::async(std::launch::async, []()
+		{
+			return timed([]()
+				{
+					if (DaoSettings::ARGON2_CALIBRATE)
+					{
+						Dao::calibrate();
+					}
+				}
+			);
+		}
+	);
+	auto users = std::async(std::launch::async, []()
+		{
+			return timed([]()
+				{
+					if (!DaoSettings::USER_DIRECTORY)
+					{
+						return;
+					}
+
+					try
+					{
+						UserDirectory::load(Storage::instance());
+					}
+					catch (const StorageError& err)
+					{
+						m_log.error("Failed to load the user directory: " + std::string(err.what()), 
+							m_log.getContext(), "Startup::run " + std::to_string(__LINE__));
+					}
+				}
+			);
+		}
+	);
+	auto signals = std::async(std::launch::async, []()
+		{
+			return timed([]()
+				{
+					try
+					{
+						ChannelRegistry::load(Storage::instance());
+					}
+					catch (const StorageError& err)
+					{
+						m_log.error("Failed to load the signal channels: " + std::string(err.what()), 
+							m_log.getContext(), "Startup::run " + std::to_string(__LINE__));
+
+						// Без хранилища книги восстанавливаются из файла снимка
+						if (FailoverSettings::SNAPSHOT && !ChannelRegistry::restore())
+						{
+							m_log.warn("No valid signal snapshot, the signal books stay empty until the storage is back.", 
+								m_log.getContext(), "Startup::run " + std::to_string(__LINE__));
+						}
+					}
+				}
+			);
+		}
+	);
+
+	m_timings[PHASE_ARGON2] = argon2.get();
+	m_timings[PHASE_USERS] = users.get();
+	m_timings[PHASE_SIGNALS] = signals.get();
+	m_timings[PHASE_TOTAL] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	std::string timings;
+	for (int phase = 0; phase < PHASES; ++phase)
+	{
+		timings += std::string(phase ? ", " : "") + s_phaseNames[phase] + ' ' + std::to_string(m_timings[phase]) + " ms";
+	}
+	m_log.info("Warm-up finished: " + timings, m_log.getContext(), "Startup::run " + std::to_string(__LINE__));
+
+	finish(true);
+
+	return true;
+}
+
+// Ожидает окончания прогрева
+bool Startup::wait()
+{
+	std::unique_lock ul(m_mtx);
+	m_cv.wait(ul, []() { return m_finished; });
+
+	return m_warm;
+}
+
+// Отмечает цикл, открывший порт
+void Startup::listening()
+{
+	std::unique_lock ul(m_mtx);
+
+	if (++m_listening == m_loops && m_warm && !m_failed)
+	{
+		m_ready = true;
+		m_log.info("All " + std::to_string(m_loops) + " event loop(s) are accepting connections.", 
+			m_log.getContext(), "Startup::listening " + std::to_string(__LINE__));
+	}
+}
+
+// Отмечает отказ цикла, готовность снимается до остановки
+void Startup::fail()
+{
+	m_ready = false;
+	if (!m_failed.exchange(true))
+	{
+		m_log.crit("An event loop failed to start, the server is stopping.", 
+			m_log.getContext(), "Startup::fail " + std::to_string(__LINE__));
+	}
+}
+
+bool Startup::failed()
+{
+	return m_failed;
+}
+
+// Снимает готовность
+void Startup::drain()
+{
+	m_ready = false;
+}
+
+bool Startup::ready()
+{
+	return m_ready;
+}
+
+// Формирует отчёт о готовности
+std::string Startup::report()
+{
+	nlohmann::json result;
+	result["ready"] = ready();
+	result["failed"] = failed();
+
+	std::unique_lock ul(m_mtx);
+
+	result["listening"] = m_listening;
+	result["loops"] = m_loops;
+	if (m_warm)
+	{
+		for (int phase = 0; phase < PHASES; ++phase)
+		{
+			result["startupMs"][s_phaseNames[phase]] = m_timings[phase];
+		}
+	}
+
+	return result.dump();
+}
@@ -0,0 +1,73 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "Logger.h"
+
+
+// Прогрев сервера перед приёмом соединений
+// Главный поток подключает хранилище и параллельно загружает данные,
+// циклы событий тем временем готовят свои ресурсы и ждут окончания прогрева до listen
+class Startup
+{
+public:
+	enum Phase
+	{
+		PHASE_STORAGE	= 0,	// подключение к хранилищу
+		PHASE_ARGON2	= 1,	// подбор стоимости хеширования
+		PHASE_USERS		= 2,	// справочник пользователей
+		PHASE_SIGNALS	= 3,	// каналы, их книги сигналов и сообщения снимка
+		PHASE_TOTAL		= 4,	// весь прогрев
+		PHASES			= 5		// количество этапов
+	};
+
+
+private:
+	static Logger					m_log;
+	static std::mutex				m_mtx;
+	static std::condition_variable	m_cv;
+	static bool						m_finished;		// прогрев завершён или прерван
+	static bool						m_warm;			// прогрев завершён успешно
+	static unsigned int				m_loops;		// количество циклов событий
+	static unsigned int				m_listening;	// циклы, открывшие порт
+	static std::atomic<bool>		m_ready;
+	static std::atomic<bool>		m_failed;		// цикл событий не смог запуститься
+	static long long				m_timings[PHASES];	// длительности этапов в миллисекундах
+
+
+	static bool connectStorage(		const std::atomic<bool>& stop);
+	static void finish(				bool warm);
+
+
+public:
+	// Выполняет прогрев, возвращает false, если запуск прерван сигналом остановки
+	static bool run(				unsigned int loops, 
+									const std::atomic<bool>& stop);
+
+	// Ожидает окончания прогрева, возвращает false, если запуск прерван
+	static bool wait();
+
+	// Отмечает цикл, открывший порт, сервер готов, когда порт открыли все циклы
+	static void listening();
+
+	// Отмечает цикл, который не смог создать приложение или открыть порт
+	// Сервер без всех циклов не станет готов, поэтому главный поток останавливает его с ошибкой
+	static void fail();
+
+	static bool failed();
+
+	// Снимает готовность перед остановкой
+	static void drain();
+
+	static bool ready();
+
+	// Готовность и длительности этапов в формате JSON
+	static std::string report();
+
+};
+
+#endif // !STARTUP_H
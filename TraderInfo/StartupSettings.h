@@ -0,0 +1,20 @@
+#ifndef STARTUPSETTINGS_H
+#define STARTUPSETTINGS_H
+
+#include <string>
+
+
+// Настройки запуска сервера
+namespace StartupSettings
+{
+	// Проверка готовности для балансировщика
+	const std::string	READY_ROUTE			{ "/ready" };
+	const std::string	CONTENT_TYPE		{ "application/json" };
+	const std::string	NOT_READY_STATUS	{ "503 Service Unavailable" };
+
+	// Пауза между попытками подключения к хранилищу
+	const unsigned int	STORAGE_RETRY_MS	(1000U);
+
+}
+
+#endif // !STARTUPSETTINGS_H
@@ -0,0 +1,64 @@
+#include "Storage.h"
+
+#include <string>
+#include <memory>
+#include <thread>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "DaoSettings.h"
+#include "RedisStorage.h"
+#include "LocalStorage.h"
+#include "FailoverStorage.h"
+#include "FailoverSettings.h"
+
+
+// Логгер создания хранилища
+static Logger s_log("Storage", LoggerSettings::TYPE_LOG);
+
+
+// Возвращает хранилище процесса, создавая его при первом обращении
+// При ошибке создания следующее обращение повторит попытку
+Storage& Storage::instance()
+{
+	static std::unique_ptr<Storage> storage = create();
+
+	return *storage;
+}
+
+// Создаёт хранилище по настройкам
+std::unique_ptr<Storage> Storage::create()
+{
+	if (DaoSettings::STORAGE == StorageType::STORAGE_LOCAL)
+	{
+		auto local = std::make_unique<LocalStorage>(DaoSettings::LOCAL_DIR, DaoSettings::LOCAL_FILE);
+
+		// Первый запуск встроенного хранилища заполняется данными из Redis, если он доступен
+		// Без Redis хранилище начинает пустым, заполнение повторится при следующем запуске
+		if (local->empty() && DaoSettings::LOCAL_SEED_FROM_REDIS)
+		{
+			try
+			{
+				RedisStorage redis(DaoSettings::REDIS_SOCKET, 1);
+				local->importFrom(redis);
+			}
+			catch (const StorageError& err)
+			{
+				s_log.warn("The local storage is not seeded from Redis, starting empty: " + std::string(err.what()), 
+					s_log.getContext(), "Storage::create " + std::to_string(__LINE__));
+			}
+		}
+
+		return local;
+	}
+
+	size_t poolSize = DaoSettings::POOL_SIZE ? DaoSettings::POOL_SIZE : std::thread::hardware_concurrency();
+
+	// Записи на время недоступности Redis откладываются в журнал
+	if (FailoverSettings::JOURNAL)
+	{
+		return std::make_unique<FailoverStorage>(DaoSettings::REDIS_SOCKET, poolSize, FailoverSettings::DIR, FailoverSettings::JOURNAL_FILE);
+	}
+
+	return std::make_unique<RedisStorage>(DaoSettings::REDIS_SOCKET, poolSize);
+}
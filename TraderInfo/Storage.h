@@ -0,0 +1,129 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <stdexcept>
+
+
+// Ошибка хранилища данных
+class StorageError : public std::runtime_error
+{
+public:
+	explicit StorageError(const std::string& message) : std::runtime_error(message)
+	{
+	}
+};
+
+// Хранилище недоступно: нет соединения или истекло время ожидания
+// Запрос можно повторить позже, в отличие от ошибок в ответе хранилища
+class StorageUnavailable : public StorageError
+{
+public:
+	explicit StorageUnavailable(const std::string& message) : StorageError(message)
+	{
+	}
+};
+
+
+// Запись потока событий хранилища
+struct StreamItem
+{
+	std::string											id;		// ИН записи ("время_мс-номер")
+	std::vector<std::pair<std::string, std::string>>	fields;
+};
+
+
+// Тип операции пакетной записи
+enum HashOpType
+{
+	HASH_SET	= 0,	// HSET
+	HASH_DEL	= 1		// HDEL
+};
+
+// Операция пакетной записи в хеш-таблицу
+struct HashOp
+{
+	HashOpType		type	= HashOpType::HASH_SET;
+	std::string		db;
+	std::string		key;
+	std::string		value;	// пустое для HASH_DEL
+};
+
+
+// Интерфейс хранилища данных с семантикой Redis
+// Реализации потокобезопасны и создаются один раз на процесс
+class Storage
+{
+public:
+	using Fields = std::vector<std::pair<std::string, std::string>>;
+
+	virtual ~Storage() = default;
+
+	virtual bool hExists(		const std::string& db, 
+								const std::string& key) = 0;
+
+	// Возвращает true, если поле создано, и false, если обновлено
+	virtual bool hSet(			const std::string& db, 
+								const std::string& key, 
+								const std::string& value) = 0;
+
+	virtual bool hDel(			const std::string& db, 
+								const std::string& key) = 0;
+
+	virtual std::optional<std::string> hGet(const std::string& db, 
+								const std::string& key) = 0;
+
+	// Увеличивает целое значение поля и возвращает новое значение
+	virtual long long hIncrBy(	const std::string& db, 
+								const std::string& key, 
+								long long increment) = 0;
+
+	virtual long long hGetAll(	const std::string& db, 
+								std::map<std::string, std::string>& output) = 0;
+
+	// Применяет операции атомарно и возвращает результат каждой:
+	// для HASH_SET - создано ли поле, для HASH_DEL - удалено ли оно
+	virtual std::vector<bool> hBatch(const std::vector<HashOp>& ops) = 0;
+
+	virtual bool sIsMember(		const std::string& db, 
+								const std::string& value) = 0;
+
+	virtual void sMembers(		const std::string& db, 
+								std::set<std::string>& output) = 0;
+
+	// Добавляет запись в поток, поток обрезается примерно до DaoSettings::HISTORY_MAXLEN последних записей
+	virtual std::string xAdd(	const std::string& db, 
+								const Fields& fields) = 0;
+
+	// Записи с ИН в диапазоне [start, end], "-" и "+" - границы потока
+	virtual void xRange(		const std::string& db, 
+								const std::string& start, 
+								const std::string& end, 
+								long long count, 
+								std::vector<StreamItem>& output) = 0;
+
+	// Повторяет отложенные записи, вызывается главным потоком периодически
+	virtual void recover()
+	{
+	}
+
+	// Обслуживает данные вне циклов событий, например сжимает журнал, вызывается главным потоком периодически
+	virtual void maintain()
+	{
+	}
+
+
+	// Хранилище процесса, выбирается настройкой DaoSettings::STORAGE
+	static Storage& instance();
+
+private:
+	static std::unique_ptr<Storage> create();
+
+};
+
+#endif // !STORAGE_H
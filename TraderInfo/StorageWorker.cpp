@@ -0,0 +1,105 @@
+#include "StorageWorker.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <exception>
+
+#include "Logger.h"
+#include "TypeLog.h"
+
+
+// Инициализация статических членов
+Logger StorageWorker::m_log("StorageWorker", LoggerSettings::TYPE_LOG);
+std::mutex StorageWorker::m_mtx;
+std::condition_variable StorageWorker::m_cv;
+std::vector<std::thread*> StorageWorker::m_threads;
+std::deque<std::function<void()>> StorageWorker::m_tasks;
+bool StorageWorker::m_stopping = false;
+
+
+// Выполняет задачи очереди до остановки
+void StorageWorker::work()
+{
+	std::unique_lock ul(m_mtx);
+	while (true)
+	{
+		m_cv.wait(ul, []() { return m_stopping || !m_tasks.empty(); });
+		if (m_tasks.empty())
+		{
+			return;
+		}
+
+		std::function<void()> task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+		ul.unlock();
+
+		try
+		{
+			task();
+		}
+		catch (const std::exception& ex)
+		{
+			m_log.error("Standard error: " + std::string(ex.what()), 
+				m_log.getContext(), "StorageWorker::work " + std::to_string(__LINE__));
+		}
+
+		ul.lock();
+	}
+}
+
+
+// Запускает потоки
+void StorageWorker::start(		unsigned int threads)
+{
+	{
+		std::unique_lock ul(m_mtx);
+		m_stopping = false;
+		for (unsigned int index = 0; index < threads; ++index)
+		{
+			m_threads.push_back(new std::thread(work));
+		}
+	}
+
+	m_log.info("Storage workers started: " + std::to_string(threads), 
+		m_log.getContext(), "StorageWorker::start " + std::to_string(__LINE__));
+}
+
+// Останавливает потоки после выполнения очереди
+void StorageWorker::stop()
+{
+	std::vector<std::thread*> threads;
+	{
+		std::unique_lock ul(m_mtx);
+		m_stopping = true;
+		threads.swap(m_threads);
+	}
+	m_cv.notify_all();
+
+	for (std::thread* thread : threads)
+	{
+		thread->join();
+		delete thread;
+	}
+}
+
+// Ставит задачу в очередь
+void StorageWorker::post(		std::function<void()>&& task)
+{
+	{
+		std::unique_lock ul(m_mtx);
+		if (!m_threads.empty())
+		{
+			m_tasks.push_back(std::move(task));
+			m_cv.notify_one();
+
+			return;
+		}
+	}
+
+	task();
+}
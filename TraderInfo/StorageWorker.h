@@ -0,0 +1,42 @@
+#ifndef STORAGEWORKER_H
+#define STORAGEWORKER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+#include "Logger.h"
+
+
+// Потоки для долгих чтений и записей хранилища, которые не должны задерживать циклы событий
+// Задача сама возвращает результат в свой цикл через LoopRegistry::defer
+class StorageWorker
+{
+private:
+	static Logger								m_log;
+	static std::mutex							m_mtx;
+	static std::condition_variable				m_cv;
+	static std::vector<std::thread*>			m_threads;
+	static std::deque<std::function<void()>>	m_tasks;
+	static bool									m_stopping;
+
+
+	static void work();
+
+
+public:
+	// Запускает потоки, вызывается главным потоком до запуска циклов
+	static void start(			unsigned int threads);
+
+	// Выполняет оставшиеся задачи и дожидается потоков
+	static void stop();
+
+	// Ставит задачу в очередь, без запущенных потоков выполняет её в вызывающем потоке
+	static void post(			std::function<void()>&& task);
+
+};
+
+#endif // !STORAGEWORKER_H
@@ -0,0 +1,112 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+
+// Иерархическое колесо таймеров
+// Уровень L хранит записи со сроком в пределах SLOTS^(L+1) тиков, запись верхнего уровня
+// переносится на уровень ниже, когда до её срока остаётся меньше оборота нижнего колеса,
+// поэтому постановка и срабатывание стоят O(1) на запись
+// Entry должен содержать поле due - срок в миллисекундах
+template <typename Entry>
+class TimerWheel
+{
+private:
+	static constexpr unsigned int	BITS	= 6;
+	static constexpr uint64_t		SLOTS	= 1ULL << BITS;
+	static constexpr uint64_t		MASK	= SLOTS - 1;
+	static constexpr unsigned int	LEVELS	= 4;
+	// Записи дальше этого горизонта ждут на верхнем уровне и переставляются при каждом его обороте
+	static constexpr uint64_t		HORIZON	= 1ULL << (BITS * LEVELS);
+
+	uint64_t	m_tickMs;
+	uint64_t	m_tick;		// последний обработанный тик
+	size_t		m_size	= 0;
+	std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> m_slots;
+
+
+	// Ставит запись не раньше тика first
+	void insert(const Entry& entry, 
+				uint64_t first)
+	{
+		uint64_t tick = std::max((entry.due + m_tickMs - 1) / m_tickMs, first);
+		uint64_t delta = std::min(tick - m_tick, HORIZON - 1);
+		tick = m_tick + delta;
+
+		unsigned int level = 0;
+		while (level + 1 < LEVELS && delta >= (1ULL << (BITS * (level + 1))))
+		{
+			++level;
+		}
+
+		m_slots[level][(tick >> (BITS * level)) & MASK].push_back(entry);
+	}
+
+	// Переносит ячейку уровня на нижние уровни
+	void cascade(unsigned int level)
+	{
+		std::vector<Entry> entries;
+		entries.swap(m_slots[level][(m_tick >> (BITS * level)) & MASK]);
+		for (const Entry& entry : entries)
+		{
+			insert(entry, m_tick);
+		}
+	}
+
+
+public:
+	TimerWheel(	uint64_t tickMs, 
+				uint64_t nowMs) : m_tickMs(tickMs), m_tick(nowMs / tickMs)
+	{
+	}
+
+	// Ставит запись, срок в прошлом срабатывает на следующем тике
+	void add(	const Entry& entry)
+	{
+		insert(entry, m_tick + 1);
+		++m_size;
+	}
+
+	// Продвигает колесо до момента nowMs и добавляет сработавшие записи в due
+	void advance(uint64_t nowMs, 
+				std::vector<Entry>& due)
+	{
+		uint64_t target = nowMs / m_tickMs;
+		while (m_tick < target && m_size)
+		{
+			++m_tick;
+
+			// Верхние уровни переносятся раньше нижних, чтобы запись дошла до нулевого уровня за один тик
+			for (unsigned int level = LEVELS - 1; level > 0; --level)
+			{
+				if ((m_tick & ((1ULL << (BITS * level)) - 1)) == 0)
+				{
+					cascade(level);
+				}
+			}
+
+			std::vector<Entry>& slot = m_slots[0][m_tick & MASK];
+			m_size -= slot.size();
+			due.insert(due.end(), slot.begin(), slot.end());
+			slot.clear();
+		}
+
+		// Пустое колесо перескакивает сразу к текущему моменту
+		if (!m_size && m_tick < target)
+		{
+			m_tick = target;
+		}
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+};
+
+#endif // !TIMERWHEEL_H
@@ -0,0 +1,119 @@
+#include "Tls.h"
+
+#include <string>
+#include <array>
+#include <optional>
+#include <fstream>
+
+#include <uwebsockets/App.h>
+#include <openssl/ssl.h>
+#include <openssl/rand.h>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "TlsSettings.h"
+
+
+// Инициализация логгера
+Logger Tls::m_log("Tls", LoggerSettings::TYPE_LOG);
+
+
+// Возвращает параметры сертификата, пустые пути не передаются
+uWS::SocketContextOptions Tls::options()
+{
+	auto path = [](const std::string& value) -> const char*
+	{
+		return value.empty() ? nullptr : value.c_str();
+	};
+
+	uWS::SocketContextOptions options;
+	options.cert_file_name = path(TlsSettings::CERT_FILE);
+	options.key_file_name = path(TlsSettings::KEY_FILE);
+	options.passphrase = path(TlsSettings::PASSPHRASE);
+	options.dh_params_file_name = path(TlsSettings::DH_PARAMS_FILE);
+	options.ca_file_name = path(TlsSettings::CA_FILE);
+	options.ssl_prefer_low_memory_usage = TlsSettings::LOW_MEMORY ? 1 : 0;
+
+	return options;
+}
+
+// Читает ключи билетов из файла, при его отсутствии создаёт случайные
+// Если случайные байты получить не удалось, ключей нет: нулевые ключи позволили бы подделывать билеты
+const Tls::TicketKeys* Tls::ticketKeys()
+{
+	static const std::optional<TicketKeys> keys = []() -> std::optional<TicketKeys>
+	{
+		TicketKeys result{};
+
+		std::ifstream file(TlsSettings::TICKET_KEY_FILE, std::ios::binary);
+		if (file && file.read(reinterpret_cast<char*>(result.data()), result.size()) && file.gcount() == static_cast<std::streamsize>(result.size()))
+		{
+			m_log.info("Session ticket keys are loaded from \"" + TlsSettings::TICKET_KEY_FILE + '"', 
+				m_log.getContext(), "Tls::ticketKeys " + std::to_string(__LINE__));
+
+			return result;
+		}
+
+		if (RAND_bytes(result.data(), static_cast<int>(result.size())) != 1)
+		{
+			m_log.crit("Failed to generate session ticket keys, session tickets are disabled.", 
+				m_log.getContext(), "Tls::ticketKeys " + std::to_string(__LINE__));
+
+			return std::nullopt;
+		}
+		m_log.warn("No session ticket key file, tickets will not survive a restart.", 
+			m_log.getContext(), "Tls::ticketKeys " + std::to_string(__LINE__));
+
+		return result;
+	}();
+
+	return keys ? &*keys : nullptr;
+}
+
+
+// Включает или выключает билеты сессий в контексте OpenSSL
+bool Tls::configure(			void* nativeHandle, 
+								const std::string& context)
+{
+	SSL_CTX* ctx = static_cast<SSL_CTX*>(nativeHandle);
+	if (!ctx)
+	{
+		m_log.error("No OpenSSL context in the application.", context, "Tls::configure " + std::to_string(__LINE__));
+
+		return false;
+	}
+
+	SSL_CTX_set_timeout(ctx, TlsSettings::SESSION_TIMEOUT_S);
+	if (!TlsSettings::TICKETS)
+	{
+		SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+		SSL_CTX_set_num_tickets(ctx, 0);
+		SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+
+		return true;
+	}
+
+	const TicketKeys* shared = ticketKeys();
+	if (!shared)
+	{
+		// Без ключей сессии возобновляются только через кеш своего цикла
+		SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+		SSL_CTX_set_num_tickets(ctx, 0);
+		SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+
+		return true;
+	}
+
+	// Ключи копируются в контекст, общий массив только читается
+	TicketKeys keys = *shared;
+	SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+	if (SSL_CTX_set_tlsext_ticket_keys(ctx, keys.data(), static_cast<long>(keys.size())) != 1)
+	{
+		m_log.error("Failed to set session ticket keys.", context, "Tls::configure " + std::to_string(__LINE__));
+
+		return false;
+	}
+
+	return true;
+}
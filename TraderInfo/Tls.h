@@ -0,0 +1,40 @@
+#ifndef TLS_H
+#define TLS_H
+
+#include <string>
+#include <array>
+
+#include <uwebsockets/App.h>
+
+#include "Logger.h"
+#include "TlsSettings.h"
+
+
+// Настройка TLS приложений uWS
+// У каждого цикла событий свой контекст OpenSSL, поэтому ключи билетов задаются
+// всем контекстам одинаковыми, иначе билет, выданный одним циклом, не примет другой
+class Tls
+{
+private:
+	static Logger m_log;
+
+	using TicketKeys = std::array<unsigned char, TlsSettings::TICKET_KEY_LEN>;
+
+
+	// Ключи билетов, читаются из файла или создаются один раз на процесс
+	// nullptr - ключей нет, билеты выключаются
+	static const TicketKeys* ticketKeys();
+
+
+public:
+	// Параметры сертификата для конструктора приложения
+	static uWS::SocketContextOptions options();
+
+	// Настраивает возобновление сессий в контексте OpenSSL приложения
+	// false - контекст не настроен, цикл с ним запускать нельзя
+	static bool configure(		void* nativeHandle, 
+								const std::string& context);
+
+};
+
+#endif // !TLS_H
@@ -0,0 +1,32 @@
+#ifndef TLSSETTINGS_H
+#define TLSSETTINGS_H
+
+#include <string>
+
+
+// Настройки TLS
+// Режим выбирается при сборке: от него зависят типы сокетов и приложения uWS
+namespace TlsSettings
+{
+	const bool			ENABLED			(false);
+
+	const std::string	CERT_FILE		{ "../tls/cert.pem" };
+	const std::string	KEY_FILE		{ "../tls/key.pem" };
+	const std::string	PASSPHRASE		{ "" };
+	const std::string	DH_PARAMS_FILE	{ "" };
+	const std::string	CA_FILE			{ "" };
+	// Экономия памяти на буферах OpenSSL при большом числе простаивающих соединений
+	const bool			LOW_MEMORY		(true);
+
+	// Возобновление сессий по билетам, переподключение обходится без полного рукопожатия
+	const bool			TICKETS			(true);
+	// Файл с 80 байтами ключей билетов, общий для перезапусков процесса
+	// Без файла ключи создаются при запуске и действуют до остановки
+	const std::string	TICKET_KEY_FILE	{ "../tls/ticket.key" };
+	const size_t		TICKET_KEY_LEN	(80U);
+	// Время жизни сессии, секунды
+	const long			SESSION_TIMEOUT_S(7200L);
+
+}
+
+#endif // !TLSSETTINGS_H
@@ -0,0 +1,245 @@
+#include "Trace.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "TraceSettings.h"
+
+
+// Ячейка кольцевого буфера, защищённая счётчиком как seqlock
+// Событие с номером n пишется при нечётном sequence = 2n + 1 и готово при 2n + 2,
+// поэтому сброс отличает целую запись от записи, которую писатель затирает во время копирования
+// Слова события атомарны, чтобы чтение во время записи не было гонкой данных,
+// порядок задают release-записи и acquire-чтения слов, отдельные барьеры не нужны
+struct TraceSlot
+{
+	static constexpr size_t WORDS = sizeof(TraceEvent) / sizeof(uint64_t);
+
+	std::atomic<uint64_t>			sequence{ 0 };
+	std::atomic<uint64_t>			words[WORDS];
+};
+
+static_assert(sizeof(TraceEvent) % sizeof(uint64_t) == 0, "TraceEvent must consist of whole 64-bit words");
+
+// Кольцевой буфер событий одного потока
+struct TraceRing
+{
+	unsigned int					id		= 0;
+	std::atomic<uint64_t>			head	{ 0 };	// номер следующей записи, пишет только владелец
+	uint64_t						flushed	= 0;	// номер первой несброшенной записи, меняет только сброс
+	std::unique_ptr<TraceSlot[]>	slots	{ std::make_unique<TraceSlot[]>(TraceSettings::RING_EVENTS) };
+};
+
+static_assert((TraceSettings::RING_EVENTS & (TraceSettings::RING_EVENTS - 1)) == 0, "RING_EVENTS must be a power of two");
+
+
+// Буферы всех потоков, удаляются только вместе с процессом
+static std::mutex s_mtxRings;
+static std::vector<std::unique_ptr<TraceRing>> s_rings;
+static std::ofstream s_file;
+
+static std::atomic<uint64_t> s_nextConnection{ 1 };
+static thread_local uint64_t s_connection = 0;
+
+// Инициализация логгера
+Logger Trace::m_log("Trace", LoggerSettings::TYPE_LOG);
+
+
+// Счётчик тактов процессора, на других архитектурах - наносекунды монотонных часов
+static uint64_t readTsc()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Регистрирует буфер нового потока
+static TraceRing* registerRing()
+{
+	std::unique_lock ul(s_mtxRings);
+
+	s_rings.push_back(std::make_unique<TraceRing>());
+	s_rings.back()->id = static_cast<unsigned int>(s_rings.size() - 1);
+
+	return s_rings.back().get();
+}
+
+
+Trace::Connection::Connection(uint64_t connection) : m_previous(s_connection)
+{
+	s_connection = connection;
+}
+
+Trace::Connection::~Connection()
+{
+	s_connection = m_previous;
+}
+
+
+// Новый ИН соединения
+uint64_t Trace::newConnection()
+{
+	return s_nextConnection.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Записывает событие в буфер текущего потока, при переполнении затираются старые события
+void Trace::write(				TraceType type, 
+								uint32_t arg)
+{
+	thread_local TraceRing* ring = registerRing();
+
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	TraceEvent event{ readTsc(), s_connection, arg, type, static_cast<uint16_t>(ring->id) };
+	uint64_t words[TraceSlot::WORDS];
+	std::memcpy(words, &event, sizeof(event));
+
+	// Нечётный счётчик объявляет запись начатой до изменения слов
+	TraceSlot& slot = ring->slots[head & (TraceSettings::RING_EVENTS - 1)];
+	slot.sequence.store(head * 2 + 1, std::memory_order_relaxed);
+	for (size_t word = 0; word < TraceSlot::WORDS; ++word)
+	{
+		slot.words[word].store(words[word], std::memory_order_release);
+	}
+	slot.sequence.store(head * 2 + 2, std::memory_order_release);
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+
+// Создаёт файл трассы и записывает заголовок с частотой счётчика тактов
+void Trace::start()
+{
+	if (!TraceSettings::ENABLED)
+	{
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(TraceSettings::DIR, error);
+	std::string path = TraceSettings::DIR + '/' + TraceSettings::FILE;
+
+	std::unique_lock ul(s_mtxRings);
+	s_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!s_file)
+	{
+		m_log.error("Failed to open the trace file \"" + path + '"', m_log.getContext(), "Trace::start " + std::to_string(__LINE__));
+
+		return;
+	}
+
+	// Частота счётчика тактов по монотонным часам
+	auto startTime = std::chrono::steady_clock::now();
+	uint64_t startTsc = readTsc();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	uint64_t endTsc = readTsc();
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+
+	TraceHeader header{ { 'T', 'I', 'T', 'R', 'A', 'C', 'E', '1' }, 
+		static_cast<double>(endTsc - startTsc) / static_cast<double>(elapsed.count()), startTsc, sizeof(TraceEvent) };
+	s_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	s_file.flush();
+
+	m_log.info("Tracing to \"" + path + "\", " + std::to_string(header.ticksPerUs) + " ticks/us", 
+		m_log.getContext(), "Trace::start " + std::to_string(__LINE__));
+}
+
+// Читает событие с номером index, false - ячейку уже затёр писатель
+static bool readSlot(			const TraceSlot& slot, 
+								uint64_t index,
+								TraceEvent& event)
+{
+	uint64_t expected = index * 2 + 2;
+	if (slot.sequence.load(std::memory_order_acquire) != expected)
+	{
+		return false;
+	}
+
+	uint64_t words[TraceSlot::WORDS];
+	for (size_t word = 0; word < TraceSlot::WORDS; ++word)
+	{
+		words[word] = slot.words[word].load(std::memory_order_acquire);
+	}
+
+	// Слово новой записи видно только вместе с её нечётным счётчиком,
+	// поэтому неизменный счётчик означает, что слова принадлежат одному событию
+	if (slot.sequence.load(std::memory_order_relaxed) != expected)
+	{
+		return false;
+	}
+	std::memcpy(&event, words, sizeof(event));
+
+	return true;
+}
+
+// Сбрасывает накопленные события всех потоков в файл
+// События, затёртые писателем до сброса или во время него, теряются и учитываются в журнале
+void Trace::flush()
+{
+	if (!TraceSettings::ENABLED)
+	{
+		return;
+	}
+
+	std::unique_lock ul(s_mtxRings);
+	if (!s_file.is_open())
+	{
+		return;
+	}
+
+	std::vector<TraceEvent> events;
+	uint64_t dropped = 0;
+	for (const auto& ring : s_rings)
+	{
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		uint64_t from = ring->flushed;
+		if (head - from > TraceSettings::RING_EVENTS)
+		{
+			dropped += head - TraceSettings::RING_EVENTS - from;
+			from = head - TraceSettings::RING_EVENTS;
+		}
+
+		// Писатель мог перезаписать начало диапазона во время копирования, такие ячейки пропускаются
+		events.clear();
+		for (uint64_t index = from; index < head; ++index)
+		{
+			TraceEvent event;
+			if (readSlot(ring->slots[index & (TraceSettings::RING_EVENTS - 1)], index, event))
+			{
+				events.push_back(event);
+			}
+			else
+			{
+				++dropped;
+			}
+		}
+
+		s_file.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(TraceEvent));
+		ring->flushed = head;
+	}
+	s_file.flush();
+
+	if (dropped)
+	{
+		m_log.warn("Trace ring overflow, " + std::to_string(dropped) + " event(s) lost.", 
+			m_log.getContext(), "Trace::flush " + std::to_string(__LINE__));
+	}
+}
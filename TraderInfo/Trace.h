@@ -0,0 +1,94 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <cstdint>
+
+#include "Logger.h"
+#include "TraceSettings.h"
+
+
+// Тип события трассы
+enum TraceType : uint16_t
+{
+	TRACE_OPEN			= 1,	// соединение открыто
+	TRACE_CLOSE			= 2,	// соединение закрыто
+	TRACE_MESSAGE_BEGIN	= 3,	// начало обработки сообщения, arg - размер
+	TRACE_MESSAGE_END	= 4,
+	TRACE_AUTH_BEGIN	= 5,
+	TRACE_AUTH_END		= 6,	// arg - 1 при успехе
+	TRACE_SPAN_BEGIN	= 7,	// начало замера Metrics::Timer, arg - Metrics::Histogram
+	TRACE_SPAN_END		= 8,
+	TRACE_PUBLISH		= 9,	// рассылка сигнала, arg - размер
+	TRACE_SEND			= 10,	// отправка пользователю, arg - размер
+	TRACE_DRAIN			= 11	// буфер сокета освободился
+};
+
+// Запись трассы фиксированного размера
+struct TraceEvent
+{
+	uint64_t	tsc;			// счётчик тактов процессора
+	uint64_t	connection;		// ИН соединения, 0 - вне соединения
+	uint32_t	arg;
+	uint16_t	type;
+	uint16_t	thread;			// номер кольцевого буфера потока
+};
+static_assert(sizeof(TraceEvent) == 24, "The trace file format expects 24-byte events");
+
+// Заголовок файла трассы
+struct TraceHeader
+{
+	char		magic[8];		// "TITRACE1"
+	double		ticksPerUs;		// тактов в микросекунде
+	uint64_t	baseTsc;		// такт начала трассы
+	uint64_t	eventSize;		// размер записи события
+};
+
+
+// Запись событий в кольцевые буферы потоков и их сброс в файл
+// Поток пишет только в свой буфер, поэтому запись не требует блокировок,
+// сброс из другого потока проверяет каждую ячейку по её счётчику, см. TraceSlot в Trace.cpp
+// Файл переводится в формат Chrome trace утилитой tools/trace2chrome.py
+class Trace
+{
+private:
+	static Logger m_log;
+
+	static void write(			TraceType type, 
+								uint32_t arg);
+
+
+public:
+	// Устанавливает текущее соединение потока на время обработки события
+	class Connection
+	{
+	private:
+		uint64_t m_previous;
+
+	public:
+		explicit Connection(uint64_t connection);
+		~Connection();
+
+		Connection(const Connection&) = delete;
+		Connection& operator=(const Connection&) = delete;
+	};
+
+
+	static void start();
+	static void flush();
+
+	// Новый ИН соединения, уникальный для процесса
+	static uint64_t newConnection();
+
+	static void record(			TraceType type, 
+								uint32_t arg = 0)
+	{
+		if (TraceSettings::ENABLED)
+		{
+			write(type, arg);
+		}
+	}
+
+};
+
+#endif // !TRACE_H
@@ -0,0 +1,24 @@
+#ifndef TRACESETTINGS_H
+#define TRACESETTINGS_H
+
+#include <string>
+#include <cstddef>
+
+
+// Настройки двоичной трассировки событий
+namespace TraceSettings
+{
+	// Трассировка включается только для диагностики
+	const bool			ENABLED		(false);
+
+	// Количество событий в кольцевом буфере потока, степень двойки
+	const size_t		RING_EVENTS	(1U << 16);
+	// Период сброса буферов в файл
+	const unsigned int	FLUSH_MS	(500U);
+
+	const std::string	DIR			{ "../trace" };
+	const std::string	FILE		{ "trace.bin" };
+
+}
+
+#endif // !TRACESETTINGS_H
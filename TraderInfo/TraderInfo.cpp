@@ -19,6 +19,10 @@
 #include <thread>
 #include <algorithm>
 #include <sstream>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 
 #include <uwebsockets/App.h>
 #include <nlohmann/json.hpp>
@@ -27,12 +31,50 @@
 #include "TypeLog.h"
 #include "PerSocketData.h"
 #include "Events.h"
+#include "Dispatcher.h"
+#include "Arena.h"
+#include "Trace.h"
+#include "TraceSettings.h"
 #include "Constants.h"
+#include "Metrics.h"
+#include "MetricsSettings.h"
+#include "RateLimiter.h"
+#include "Heartbeat.h"
+#include "SessionRegistry.h"
+#include "HeartbeatSettings.h"
+#include "Tls.h"
+#include "TlsSettings.h"
+#include "LimitSettings.h"
+#include "LoopRegistry.h"
+#include "Affinity.h"
+#include "Storage.h"
+#include "UserDirectory.h"
+#include "ChannelRegistry.h"
+#include "SignalSettings.h"
+#include "SignalScheduler.h"
+#include "DaoSettings.h"
+#include "Startup.h"
+#include "StorageWorker.h"
+#include "StartupSettings.h"
+#include "SnapshotFile.h"
+#include "FailoverSettings.h"
 
 
 // Инициализация логгера
 static Logger s_log("Main", LoggerSettings::TYPE_LOG);
 
+// Пометка о запросе остановки сервера
+static std::atomic<bool> s_stop{ false };
+// Количество завершившихся потоков
+static std::atomic<unsigned int> s_finished{ 0 };
+
+
+// Обработчик сигналов остановки
+static void onStopSignal(int /*signal*/)
+{
+	s_stop = true;
+}
+
 
 // Получает настройки для uWS
 static SettingsUWS getSettingsUWS()
@@ -45,7 +87,20 @@ static SettingsUWS getSettingsUWS()
 	// Порт сервера
 	settings.port = ServerSettings::PORT;
 	// Количество используемых потоков
-	settings.threads = std::thread::hardware_concurrency();
+	settings.threads = ServerSettings::THREADS ? ServerSettings::THREADS : std::thread::hardware_concurrency();
+	// Разделение порта с другими процессами
+	settings.reusePort = ServerSettings::REUSE_PORT;
+	// Без разделения порт слушает только один цикл, остальные получили бы EADDRINUSE и остановили сервер
+	if (!settings.reusePort && settings.threads > 1)
+	{
+		s_log.warn("REUSE_PORT is off, so only one event loop can listen on the port: using 1 thread instead of " + 
+			std::to_string(settings.threads), context, "getSettingsUWS " + std::to_string(__LINE__));
+		settings.threads = 1;
+	}
+	// Привязка потоков к процессорам
+	settings.pinMode = ServerSettings::PIN_MODE;
+	// Период отчёта о распределении соединений
+	settings.spreadReportMs = ServerSettings::SPREAD_REPORT_MS;
 
 	return settings;
 }
@@ -62,6 +117,18 @@ int main()
 	SettingsUWS uWsSettings = getSettingsUWS();
 	// Порт websocket'a
 	s_log.info("The port: " + std::to_string(uWsSettings.port), context, std::to_string(__LINE__));
+	s_log.info(std::string("SO_REUSEPORT mode: ") + (uWsSettings.reusePort ? "on" : "off"), context, std::to_string(__LINE__));
+
+	// Сигналы плавной остановки
+	std::signal(SIGTERM, onStopSignal);
+	std::signal(SIGINT, onStopSignal);
+
+
+	// Двоичная трасса событий, если включена
+	Trace::start();
+
+	// Потоки чтения журнала сигналов вне циклов событий
+	StorageWorker::start(DaoSettings::STORAGE_WORKERS);
 
 
 	// Задаём количество потоков для работы
@@ -69,114 +136,342 @@ int main()
 	s_log.info("Threads num: " + std::to_string(uWsSettings.threads), context, std::to_string(__LINE__));
 
 	// Инициализация потоков
-	std::transform(threads.begin(), threads.end(), threads.begin(), [&uWsSettings](std::thread*/*t*/)
+	unsigned int index = 0;
+	std::transform(threads.begin(), threads.end(), threads.begin(), [&uWsSettings, &index](std::thread*/*t*/)
 		{
-			return new std::thread([&uWsSettings]()
+			return new std::thread([&uWsSettings, id = index++]()
 				{
 					// Контекст для данного потока
 					std::string thContext{ s_log.getContext() + " "};
 
+					// Состояние цикла событий потока
+					LoopContext loopContext;
+					loopContext.id = id;
+					loopContext.context = thContext;
+					loopContext.affinity = Affinity::pin(id, uWsSettings.pinMode, thContext);
+					loopContext.loop = uWS::Loop::get();
+
+					// Приложение uWS, в режиме TLS с сертификатом из TlsSettings
+					ServerApp app(Tls::options());
+					if (app.constructorFailed())
+					{
+						s_log.crit("Failed to create the application, check the TLS certificate and key.", 
+							thContext, std::to_string(__LINE__));
+						Startup::fail();
+						++s_finished;
+
+						return;
+					}
+					if (TlsSettings::ENABLED && !Tls::configure(app.getNativeHandle(), thContext))
+					{
+						s_log.crit("Failed to configure TLS sessions of the application.", thContext, std::to_string(__LINE__));
+						Startup::fail();
+						++s_finished;
+
+						return;
+					}
+
+					// Пока главный поток прогревает данные, цикл готовит свою память
+					Arena::warm();
+					if (!Startup::wait())
+					{
+						s_log.info("Startup is interrupted, the event loop is not started.", thContext, std::to_string(__LINE__));
+						++s_finished;
+
+						return;
+					}
+
+					// Пинги соединений цикла по колесу таймеров
+					Heartbeat heartbeat(loopContext.loop, thContext);
+					loopContext.heartbeat = &heartbeat;
+
+					// Активацию и снятие сигналов по времени выполняет первый цикл
+					if (id == 0)
+					{
+						SignalScheduler::start(loopContext.loop);
+					}
+
 					// Запуск WebSocket сервера
-					uWS::App().ws<PerSocketData>("/*",
+					app.ws<PerSocketData>("/*",
 						{
 							// Настройки сервера
 							.compression = uWS::CompressOptions(uWS::DEDICATED_COMPRESSOR_4KB | uWS::DEDICATED_DECOMPRESSOR),
 							.maxPayloadLength = 100 * 1024 * 1024,
-							.idleTimeout = 16,
-							.maxBackpressure = 100 * 1024 * 1024,
+							.idleTimeout = HeartbeatSettings::ENABLED ? HeartbeatSettings::IDLE_TIMEOUT_S : 16,
+							.maxBackpressure = ServerSettings::MAX_BACKPRESSURE,
 							.closeOnBackpressureLimit = false,
 							.resetIdleTimeoutOnSend = false,
-							.sendPingsAutomatically = true,
+							.sendPingsAutomatically = !HeartbeatSettings::ENABLED,
 							// Хендлеры сервера
-							.upgrade = nullptr,
-							.open = [&thContext](auto* ws)
+							.upgrade = [&thContext](auto* res, auto* req, auto* context)
+							{
+								// Ограничиваем частоту подключений с одного адреса
+								std::string ip{ res->getRemoteAddressAsText() };
+								if (!RateLimiter::byIp().allow(ip))
+								{
+									Metrics::increment(Metrics::RATE_LIMITED);
+									s_log.warn("Connection rate limit exceeded for the IP \"" + ip + '"', 
+										thContext, ".upgrade " + std::to_string(__LINE__));
+
+									res->writeStatus(LimitSettings::HTTP_STATUS)->end();
+
+									return;
+								}
+
+								PerSocketData data;
+								data.ip = std::move(ip);
+
+								res->template upgrade<PerSocketData>(std::move(data),
+									req->getHeader("sec-websocket-key"),
+									req->getHeader("sec-websocket-protocol"),
+									req->getHeader("sec-websocket-extensions"),
+									context);
+							},
+							.open = [&thContext, &loopContext](auto* ws)
 							{
 								// Создание соединения
 								s_log.info("Processing a new connection.", thContext, ".open " + std::to_string(__LINE__));
 								
+								Metrics::increment(Metrics::CONNECTIONS_OPENED);
+
 								// Данные пользователя
 								PerSocketData* data = ws->getUserData();
 								
 								// Назначаем ИН пользователю
-								Events event;
-								data->userId = event.uuid();
+								data->userId = Events<ServerSocket>::local().uuid();
 								data->login = ConstValue::NONE;
+								data->traceId = Trace::newConnection();
+								Trace::Connection trace(data->traceId);
+								Trace::record(TraceType::TRACE_OPEN);
 
-								// Подписываем пользователя на персональный канал
-								ws->subscribe(ServerSettings::PREFIX_CHANNEL + data->userId);
+								loopContext.sockets.insert(ws);
+								++loopContext.connections;
+								loopContext.heartbeat->add(ws);
 
 								s_log.info("New user connected.", thContext + data->userId, ".open " + std::to_string(__LINE__));
 						    },
 						    .message = [&thContext](auto* ws, std::string_view message, uWS::OpCode opCode)
 						    {
-								// Обработка события
+								// Обработка события, временная память сообщения берётся из арены потока
+								Arena::Scope scope;
 								PerSocketData* data = ws->getUserData();
+								Trace::Connection trace(data->traceId);
+								Trace::record(TraceType::TRACE_MESSAGE_BEGIN, static_cast<uint32_t>(message.size()));
 								s_log.info("The event from the user.", thContext + data->userId, ".message " + std::to_string(__LINE__));
 
-								Events event;
 								try
 								{
-									if (data->auth)
-									{
-										// Пользователь уже авторизован
-										if (data->isAdmin)
-										{
-											// Команда по изменению списка активных сигналов
-											s_log.info("Changing signals.", thContext + data->userId, ".message " + std::to_string(__LINE__));
-											event.signalize(ws, message, data->userId);
-										}
-										else
-										{
-											s_log.info("The user does not have the right to publish signals.", 
-												thContext + data->userId, ".message " + std::to_string(__LINE__));
-										}
-									}
-									else
-									{
-										// Авторизация пользователя
-										s_log.info("User authorization.", thContext + data->userId, ".message " + std::to_string(__LINE__));
-										event.authorization(ws, message, data->userId);
-									}
+									// Команда выполняется, если у пользователя есть на неё права
+									Metrics::Timer timer(Metrics::MESSAGE_TIME);
+									Dispatcher<ServerSocket>::dispatch(ws, message, data->userId);
+								}
+								catch (const nlohmann::json::parse_error& exp)
+								{
+									Metrics::increment(Metrics::JSON_PARSE_FAILURES);
+									s_log.warn("Invalid JSON: " + std::string(exp.what()), 
+										thContext + data->userId, ".message " + std::to_string(__LINE__));
 								}
 								catch (const std::exception& exp)
 								{
 									s_log.error("Standard exception: " + std::string(exp.what()), 
 										thContext + data->userId, ".message " + std::to_string(__LINE__));
 								}
+								Trace::record(TraceType::TRACE_MESSAGE_END);
+						    },
+						    .drain = [](auto* ws)
+						    {
+								Trace::Connection trace(ws->getUserData()->traceId);
+								Trace::record(TraceType::TRACE_DRAIN);
+
+								// Буфер отправки освободился, продолжаем выдачу истории
+								if (ws->getUserData()->history.active)
+								{
+									Events<ServerSocket>::local().continueHistory(ws);
+								}
 						    },
 						    .ping = [](auto*/*ws*/, std::string_view)
 						    {
 							    // PING
 						    },
-						    .pong = [](auto*/*ws*/, std::string_view)
+						    .pong = [&loopContext](auto* ws, std::string_view message)
 						    {
-							    // PONG
+								// Ответ на пинг колеса, замеряем время оборота
+								loopContext.heartbeat->pong(ws, message);
 						    },
-						    .close = [](auto*/*ws*/, int /*code*/, std::string_view /*message*/)
+						    .close = [&loopContext](auto* ws, int /*code*/, std::string_view /*message*/)
 						    {
 							    // Закрытие соединение
+								Trace::Connection trace(ws->getUserData()->traceId);
+								Trace::record(TraceType::TRACE_CLOSE);
+
+								loopContext.sockets.erase(ws);
+								--loopContext.connections;
+								loopContext.heartbeat->remove(ws);
+								SessionRegistry::remove(ws);
+								Metrics::increment(Metrics::CONNECTIONS_CLOSED);
 						    }
 						}
-					).listen(uWsSettings.port, [&uWsSettings, &thContext](auto* listen_socket)
+					).get(MetricsSettings::ROUTE, [](auto* res, auto*/*req*/)
+						{
+							// Метрики в формате Prometheus
+							res->writeHeader("Content-Type", MetricsSettings::CONTENT_TYPE)->end(Metrics::render());
+						}
+					).get(StartupSettings::READY_ROUTE, [](auto* res, auto*/*req*/)
+						{
+							// Готовность для балансировщика, до открытия порта всеми циклами и при остановке - 503
+							if (!Startup::ready())
+							{
+								res->writeStatus(StartupSettings::NOT_READY_STATUS);
+							}
+							res->writeHeader("Content-Type", StartupSettings::CONTENT_TYPE)->end(Startup::report());
+						}
+					).listen(uWsSettings.port, uWsSettings.reusePort ? LIBUS_LISTEN_DEFAULT : LIBUS_LISTEN_EXCLUSIVE_PORT, 
+						[&uWsSettings, &thContext, &loopContext](auto* listen_socket)
 						{
 							if (listen_socket)
 							{
-								s_log.info("Listening on port " + std::to_string(uWsSettings.port), 
+								loopContext.listenSocket = listen_socket;
+								s_log.info("Loop " + std::to_string(loopContext.id) + " (" + loopContext.affinity + 
+									") is listening on port " + std::to_string(uWsSettings.port), 
 									thContext, ".listen " + std::to_string(__LINE__));
+								Startup::listening();
 							}
 							else
 							{
 								s_log.crit("Failed to listen on port " + std::to_string(uWsSettings.port), 
 									thContext, ".listen " + std::to_string(__LINE__));
+								Startup::fail();
+
+								// Без остановки таймеров цикл не завершится
+								loopContext.heartbeat->stop();
+								SignalScheduler::stop(loopContext.loop);
 							}
 						}
-					).run();
+					);
+
+					loopContext.app = &app;
+					LoopRegistry::add(&loopContext);
+
+					app.run();
 
+					LoopRegistry::remove(&loopContext);
+					s_log.info("The event loop is finished.", thContext, std::to_string(__LINE__));
+					++s_finished;
 				}
 			);
 		}
 	);
 
+	// Прогрев данных, циклы откроют порт после него
+	// Прерванный прогрев уже разбудил циклы, они завершатся без запуска
+	if (!Startup::run(uWsSettings.threads, s_stop))
+	{
+		s_log.info("Startup is interrupted, waiting for the threads.", context, std::to_string(__LINE__));
+	}
+
+	// Ожидание сигнала остановки или завершения всех потоков
+	auto lastReport = std::chrono::steady_clock::now();
+	auto lastUsersCheck = lastReport;
+	auto lastTraceFlush = lastReport;
+	auto lastReplay = lastReport;
+	auto lastSignalsLoad = lastReport;
+	auto lastCompactCheck = lastReport;
+	while (!s_stop && !Startup::failed() && s_finished < uWsSettings.threads)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(ServerSettings::SIGNAL_POLL_MS));
+
+		// Отчёт о распределении соединений по циклам
+		auto now = std::chrono::steady_clock::now();
+		if (uWsSettings.spreadReportMs && now - lastReport >= std::chrono::milliseconds(uWsSettings.spreadReportMs))
+		{
+			LoopRegistry::reportSpread();
+			lastReport = now;
+		}
+
+		// Проверка версии справочника пользователей
+		if (DaoSettings::USER_DIRECTORY && now - lastUsersCheck >= std::chrono::milliseconds(DaoSettings::USERS_REFRESH_MS))
+		{
+			try
+			{
+				UserDirectory::refresh(Storage::instance());
+			}
+			catch (const StorageError& err)
+			{
+				s_log.error("Failed to refresh the user directory: " + std::string(err.what()), context, std::to_string(__LINE__));
+			}
+			lastUsersCheck = now;
+		}
+
+		// Перечитывание каналов и сигналов, изменённых в хранилище в обход сервера
+		if (now - lastSignalsLoad >= std::chrono::milliseconds(SignalSettings::REFRESH_MS))
+		{
+			try
+			{
+				ChannelRegistry::load(Storage::instance());
+			}
+			catch (const StorageError& err)
+			{
+				s_log.error("Failed to reload the signal channels: " + std::string(err.what()), context, std::to_string(__LINE__));
+			}
+			lastSignalsLoad = now;
+		}
+
+		// Сброс трассы в файл
+		if (TraceSettings::ENABLED && now - lastTraceFlush >= std::chrono::milliseconds(TraceSettings::FLUSH_MS))
+		{
+			Trace::flush();
+			lastTraceFlush = now;
+		}
+
+		// Снимок книг сигналов переписывается после их изменения
+		if (FailoverSettings::SNAPSHOT)
+		{
+			SnapshotFile::flush();
+		}
+
+		// Переподключение к Redis и повтор отложенных записей
+		if (now - lastReplay >= std::chrono::milliseconds(FailoverSettings::REPLAY_MS))
+		{
+			try
+			{
+				Storage::instance().recover();
+			}
+			catch (const StorageError& err)
+			{
+				s_log.error("Failed to replay the journaled writes: " + std::string(err.what()), context, std::to_string(__LINE__));
+			}
+			lastReplay = now;
+		}
+
+		// Сжатие журнала встроенного хранилища вне циклов событий
+		if (now - lastCompactCheck >= std::chrono::milliseconds(DaoSettings::COMPACT_CHECK_MS))
+		{
+			try
+			{
+				Storage::instance().maintain();
+			}
+			catch (const StorageError& err)
+			{
+				s_log.error("Failed to maintain the storage: " + std::string(err.what()), context, std::to_string(__LINE__));
+			}
+			lastCompactCheck = now;
+		}
+	}
+
+	if (s_stop)
+	{
+		s_log.info("Shutdown requested, draining connections.", context, std::to_string(__LINE__));
+		Startup::drain();
+		LoopRegistry::drainAll();
+	}
+	else if (Startup::failed())
+	{
+		// Остальные циклы закрываются так же, как при остановке
+		s_log.crit("Stopping the server after an event loop failure.", context, std::to_string(__LINE__));
+		Startup::drain();
+		LoopRegistry::drainAll();
+	}
+
 	// Ожидание закрытия потоков
 	std::for_each(threads.begin(), threads.end(), [](std::thread* t) 
 		{
@@ -184,6 +479,14 @@ int main()
 		}
 	);
 	s_log.info("Threads closed.", context, std::to_string(__LINE__));
+	StorageWorker::stop();
+
+	Trace::flush();
+	if (FailoverSettings::SNAPSHOT)
+	{
+		SnapshotFile::flush();
+		SnapshotFile::close();
+	}
 
-	return 0;
+	return Startup::failed() ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,30 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <uwebsockets/App.h>
+
+#include "PerSocketData.h"
+#include "TlsSettings.h"
+
+
+// Цикл событий, приложение и сокет, с которыми работает сервер
+// Реестры и обработчики команд обращаются к uWS только через эти имена,
+// тесты собираются с TRADERINFO_FAKE_TRANSPORT и подставляют реализации из tests/FakeTransport.h
+#ifdef TRADERINFO_FAKE_TRANSPORT
+
+#include "FakeTransport.h"
+
+using ServerLoop = FakeLoop;
+using ServerApp = FakeApp;
+using ServerSocket = FakeSocket;
+
+#else
+
+// Приложение и сокет uWS выбранного режима TLS
+using ServerLoop = uWS::Loop;
+using ServerApp = uWS::TemplatedApp<TlsSettings::ENABLED>;
+using ServerSocket = uWS::WebSocket<TlsSettings::ENABLED, true, PerSocketData>;
+
+#endif // TRADERINFO_FAKE_TRANSPORT
+
+#endif // !TRANSPORT_H
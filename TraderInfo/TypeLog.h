@@ -8,7 +8,7 @@
 
 namespace LoggerSettings
 {
-	//   
+	// Способ вывода логов
 	const Logger::TypeLog TYPE_LOG{ Logger::TypeLog::STDOUT };
 
 }
@@ -0,0 +1,285 @@
+#include "UserDirectory.h"
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <vector>
+#include <span>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <charconv>
+
+#include "Logger.h"
+#include "TypeLog.h"
+#include "Storage.h"
+#include "DaoSettings.h"
+
+
+// Инициализация статических членов
+Logger UserDirectory::m_log("UserDirectory", LoggerSettings::TYPE_LOG);
+std::atomic<std::shared_ptr<const UserDirectory::Table>> UserDirectory::m_table;
+
+
+// Переводит шестнадцатеричную строку в байты
+bool UserDirectory::decodeHex(			std::string_view hex, 
+										std::span<uint8_t> output)
+{
+	size_t length = output.size();
+	if (hex.size() != length * 2)
+	{
+		return false;
+	}
+
+	auto nibble = [](char symbol) -> int
+	{
+		if (symbol >= '0' && symbol <= '9')
+		{
+			return symbol - '0';
+		}
+		if (symbol >= 'a' && symbol <= 'f')
+		{
+			return symbol - 'a' + 10;
+		}
+		if (symbol >= 'A' && symbol <= 'F')
+		{
+			return symbol - 'A' + 10;
+		}
+
+		return -1;
+	};
+
+	for (size_t index = 0; index < length; ++index)
+	{
+		int high = nibble(hex[index * 2]);
+		int low = nibble(hex[index * 2 + 1]);
+		if (high < 0 || low < 0)
+		{
+			return false;
+		}
+		output[index] = static_cast<uint8_t>((high << 4) | low);
+	}
+
+	return true;
+}
+
+// Проверяет, записан ли хеш в формате строки Argon2
+bool UserDirectory::isEncoded(			std::string_view passSalt)
+{
+	return passSalt.starts_with(DaoSettings::ARGON2ID_PREFIX) || passSalt.starts_with(DaoSettings::ARGON2I_PREFIX);
+}
+
+
+// Читает параметры стоимости из строки вида "$argon2id$v=19$m=19456,t=2,p=1$соль$хеш"
+bool UserDirectory::parseCost(			std::string_view encoded, 
+										Argon2Cost& cost)
+{
+	const std::pair<std::string_view, uint32_t*> fields[] = 
+	{
+		{ "$m=", &cost.mCost },
+		{ ",t=", &cost.tCost },
+		{ ",p=", &cost.parallelism }
+	};
+
+	size_t position = encoded.find(fields[0].first);
+	if (position == std::string_view::npos)
+	{
+		return false;
+	}
+
+	const char* current = encoded.data() + position;
+	const char* end = encoded.data() + encoded.size();
+	for (const auto& [name, value] : fields)
+	{
+		if (std::string_view(current, end - current).substr(0, name.size()) != name)
+		{
+			return false;
+		}
+
+		auto [next, error] = std::from_chars(current + name.size(), end, *value);
+		if (error != std::errc())
+		{
+			return false;
+		}
+		current = next;
+	}
+
+	return true;
+}
+
+// Разбирает значение "hash:salt", хеш переводится в двоичный вид
+// Строка Argon2 сохраняется как есть, её разбирает библиотека при проверке
+bool UserDirectory::parse(				const std::string& passSalt, 
+										UserRecord& record)
+{
+	if (isEncoded(passSalt))
+	{
+		record.encoded = passSalt;
+
+		return parseCost(passSalt, record.cost);
+	}
+	record.cost = { DaoSettings::LEGACY_T_COST, DaoSettings::LEGACY_M_COST, DaoSettings::LEGACY_PARALLELISM };
+
+	size_t delimiter = passSalt.find(':');
+	if (delimiter == std::string::npos || passSalt.size() - delimiter - 1 < DaoSettings::MIN_SALT_LEN)
+	{
+		return false;
+	}
+
+	if (!decodeHex(std::string_view(passSalt).substr(0, delimiter), record.hash))
+	{
+		return false;
+	}
+	record.salt.assign(passSalt.begin() + delimiter + 1, passSalt.end());
+
+	return true;
+}
+
+// Возвращает версию списка пользователей из хранилища
+std::string UserDirectory::readVersion(	Storage& storage)
+{
+	return storage.hGet(DaoSettings::META_DB, DaoSettings::USERS_VERSION).value_or("");
+}
+
+// Собирает таблицу пользователей из хранилища
+std::shared_ptr<const UserDirectory::Table> UserDirectory::build(Storage& storage, 
+										const std::string& version)
+{
+	std::map<std::string, std::string> users;
+	std::set<std::string> admins;
+	storage.hGetAll(DaoSettings::USERS_DB, users);
+	storage.sMembers(DaoSettings::ADMINS_DB, admins);
+
+	// Заполненность таблицы не больше половины
+	size_t capacity = 16;
+	while (capacity < users.size() * 2)
+	{
+		capacity <<= 1;
+	}
+
+	auto table = std::make_shared<Table>();
+	table->slots.resize(capacity);
+	table->mask = capacity - 1;
+	table->version = version;
+	table->loaded = std::chrono::steady_clock::now();
+
+	for (const auto& [login, passSalt] : users)
+	{
+		UserRecord record;
+		if (login.empty() || !parse(passSalt, record))
+		{
+			m_log.warn("Invalid password hash and salt in DB for username \"" + login + "\", skipped.", 
+				m_log.getContext(), "UserDirectory::build " + std::to_string(__LINE__));
+
+			continue;
+		}
+		record.login = login;
+		record.isAdmin = admins.count(login) > 0;
+
+		size_t index = std::hash<std::string_view>{}(login) & table->mask;
+		while (!table->slots[index].login.empty())
+		{
+			index = (index + 1) & table->mask;
+		}
+		table->slots[index] = std::move(record);
+		++table->count;
+	}
+
+	return table;
+}
+
+
+// Загружает справочник при запуске
+void UserDirectory::load(				Storage& storage)
+{
+	std::string version = readVersion(storage);
+	auto table = build(storage, version);
+	m_table.store(table);
+
+	m_log.info("Loaded " + std::to_string(table->count) + " user(s), version \"" + version + '"', 
+		m_log.getContext(), "UserDirectory::load " + std::to_string(__LINE__));
+}
+
+// Перезагружает справочник при смене версии или по истечении срока
+void UserDirectory::refresh(			Storage& storage)
+{
+	std::shared_ptr<const Table> current = m_table.load();
+	std::string version = readVersion(storage);
+
+	bool expired = !current || 
+		std::chrono::steady_clock::now() - current->loaded >= std::chrono::milliseconds(DaoSettings::USERS_MAX_AGE_MS);
+	if (!expired && version == current->version)
+	{
+		return;
+	}
+
+	load(storage);
+}
+
+// Заменяет запись пользователя в копии текущей таблицы
+// Без этого до перечитывания справочника каждый вход снова пересчитывал бы хеш со старыми параметрами
+void UserDirectory::update(				const std::string& login, 
+										const std::string& passSalt)
+{
+	UserRecord record;
+	if (login.empty() || !parse(passSalt, record))
+	{
+		return;
+	}
+	record.login = login;
+
+	std::shared_ptr<const Table> current = m_table.load();
+	while (current)
+	{
+		size_t index = std::hash<std::string_view>{}(login) & current->mask;
+		while (!current->slots[index].login.empty() && current->slots[index].login != login)
+		{
+			index = (index + 1) & current->mask;
+		}
+		if (current->slots[index].login.empty())
+		{
+			return;
+		}
+
+		// Таблица неизменяема, пересчёт хеша редок, поэтому запись меняется в копии
+		auto table = std::make_shared<Table>(*current);
+		record.isAdmin = current->slots[index].isAdmin;
+		table->slots[index] = record;
+		if (m_table.compare_exchange_weak(current, table))
+		{
+			return;
+		}
+	}
+}
+
+// Ищет пользователя в текущей таблице
+// Таблицу, которую давно не удаётся перечитать, отозванный пользователь мог пережить,
+// поэтому вместо неё вызывающий проверяет хранилище
+std::shared_ptr<const UserRecord> UserDirectory::find(std::string_view login)
+{
+	std::shared_ptr<const Table> table = m_table.load();
+	if (!table || login.empty())
+	{
+		return nullptr;
+	}
+	if (std::chrono::steady_clock::now() - table->loaded >= std::chrono::milliseconds(DaoSettings::USERS_STALE_MS))
+	{
+		return nullptr;
+	}
+
+	size_t index = std::hash<std::string_view>{}(login) & table->mask;
+	while (!table->slots[index].login.empty())
+	{
+		if (table->slots[index].login == login)
+		{
+			// Запись живёт, пока на неё ссылаются, даже если таблицу уже заменили
+			return std::shared_ptr<const UserRecord>(table, &table->slots[index]);
+		}
+		index = (index + 1) & table->mask;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,101 @@
+#ifndef USERDIRECTORY_H
+#define USERDIRECTORY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <span>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "Logger.h"
+#include "Storage.h"
+#include "DaoSettings.h"
+
+
+// Параметры стоимости Argon2
+struct Argon2Cost
+{
+	uint32_t	tCost		= 0;	// количество проходов
+	uint32_t	mCost		= 0;	// память в кибибайтах
+	uint32_t	parallelism	= 0;	// количество потоков и линий
+
+	bool operator==(const Argon2Cost& other) const = default;
+};
+
+
+// Учётные данные пользователя в памяти
+struct UserRecord
+{
+	std::string										login;		// пустой - свободная ячейка
+	std::array<uint8_t, DaoSettings::HASH_LEN>		hash{};		// хеш пароля в двоичном виде
+	std::vector<uint8_t>							salt;
+	std::string										encoded;	// хеш в формате $argon2id$..., пустой для "hash:salt"
+	Argon2Cost										cost;
+	bool											isAdmin = false;
+};
+
+
+// Справочник пользователей, загружаемый из хранилища при запуске
+// Таблица неизменяема, обновление собирает новую и подменяет указатель на неё в std::atomic<std::shared_ptr>
+// Такой указатель не lock-free: libstdc++ и MSVC защищают его внутренней блокировкой,
+// но она удерживается только на время копирования указателя, поиск по таблице идёт без блокировок
+// Устаревшая таблица не используется, см. DaoSettings::USERS_STALE_MS
+class UserDirectory
+{
+private:
+	// Хеш-таблица с открытой адресацией и линейным пробированием
+	struct Table
+	{
+		std::vector<UserRecord>					slots;
+		size_t									mask	= 0;
+		size_t									count	= 0;
+		std::string								version;
+		std::chrono::steady_clock::time_point	loaded;
+	};
+
+	static Logger								m_log;
+	static std::atomic<std::shared_ptr<const Table>> m_table;
+
+
+	static std::shared_ptr<const Table> build(	Storage& storage, 
+												const std::string& version);
+
+	static std::string readVersion(				Storage& storage);
+
+
+public:
+	// Переводит шестнадцатеричную строку в байты, длина строки должна совпадать с буфером
+	static bool decodeHex(						std::string_view hex, 
+												std::span<uint8_t> output);
+
+	// Проверяет, записан ли хеш в формате строки Argon2
+	static bool isEncoded(						std::string_view passSalt);
+
+	// Читает параметры "m=..,t=..,p=.." из строки Argon2
+	static bool parseCost(						std::string_view encoded, 
+												Argon2Cost& cost);
+
+	// Разбирает значение "hash:salt" или "$argon2id$..." из хранилища
+	static bool parse(							const std::string& passSalt, 
+												UserRecord& record);
+
+	static void load(							Storage& storage);
+
+	// Перезагружает справочник, если сменилась версия или он устарел
+	static void refresh(						Storage& storage);
+
+	// Заменяет хеш пользователя в текущей таблице после его пересчёта
+	// Версия таблицы не меняется, остальные изменения хранилища придут при перечитывании
+	static void update(							const std::string& login, 
+												const std::string& passSalt);
+
+	// Возвращает запись пользователя или nullptr, если его нет в справочнике или справочник устарел
+	static std::shared_ptr<const UserRecord> find(std::string_view login);
+
+};
+
+#endif // !USERDIRECTORY_H
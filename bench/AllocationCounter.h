@@ -0,0 +1,34 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "Arena.h"
+
+
+// Выводит в счётчик "allocs" обращения потока к глобальному распределителю на одну итерацию замера
+// Создаётся перед циклом замера, отчитывается при разрушении
+class AllocationCounter
+{
+private:
+	benchmark::State&	m_state;
+	uint64_t			m_start;
+
+public:
+	explicit AllocationCounter(benchmark::State& state) : m_state(state), m_start(Arena::allocations())
+	{
+	}
+
+	~AllocationCounter()
+	{
+		m_state.counters["allocs"] = benchmark::Counter(static_cast<double>(Arena::allocations() - m_start), 
+			benchmark::Counter::kAvgIterations);
+	}
+
+	AllocationCounter(const AllocationCounter&) = delete;
+	AllocationCounter& operator=(const AllocationCounter&) = delete;
+};
+
+#endif // !ALLOCATIONCOUNTER_H
@@ -0,0 +1,95 @@
+#include <string>
+#include <cstdint>
+#include <cstdio>
+
+#include <benchmark/benchmark.h>
+#include <argon2.h>
+
+#include "Dao.h"
+#include "DaoSettings.h"
+#include "UserDirectory.h"
+#include "FakeStorage.h"
+#include "TestLoop.h"
+#include "AllocationCounter.h"
+
+
+// Хеширование пароля Argon2id при перехешировании, аргументы - проходы и память в КиБ
+static void BM_EncodeArgon2(benchmark::State& state)
+{
+	Argon2Cost cost{ static_cast<uint32_t>(state.range(0)), static_cast<uint32_t>(state.range(1)), DaoSettings::ARGON2_PARALLELISM };
+	std::string encoded;
+
+	for (auto _ : state)
+	{
+		if (Dao::encodeArgon2("password", cost, encoded) != ARGON2_OK)
+		{
+			state.SkipWithError("argon2id_hash_encoded failed");
+			break;
+		}
+		benchmark::DoNotOptimize(encoded);
+	}
+}
+BENCHMARK(BM_EncodeArgon2)
+	->Args({ DaoSettings::LEGACY_T_COST, DaoSettings::LEGACY_M_COST })
+	->Args({ DaoSettings::ARGON2_T_COST, DaoSettings::ARGON2_MIN_M_COST })
+	->Args({ DaoSettings::ARGON2_T_COST, DaoSettings::ARGON2_M_COST })
+	->Args({ DaoSettings::ARGON2_T_COST, DaoSettings::ARGON2_MAX_M_COST })
+	->ArgNames({ "t", "m" })
+	->Unit(benchmark::kMillisecond);
+
+
+// Пользователь со старым хешем "hex_hash:salt" (Argon2i с параметрами LEGACY_*)
+static void addLegacyUser(		FakeStorage& storage, 
+								const std::string& login, 
+								const std::string& password)
+{
+	const std::string salt = "legacy-salt-" + login;
+	uint8_t hash[DaoSettings::HASH_LEN];
+	argon2i_hash_raw(DaoSettings::LEGACY_T_COST, DaoSettings::LEGACY_M_COST, DaoSettings::LEGACY_PARALLELISM, 
+		password.data(), password.size(), salt.data(), salt.size(), hash, DaoSettings::HASH_LEN);
+
+	std::string value;
+	char hex[3];
+	for (uint8_t byte : hash)
+	{
+		std::snprintf(hex, sizeof(hex), "%02x", byte);
+		value += hex;
+	}
+	storage.hSet(DaoSettings::USERS_DB, login, value + ':' + salt);
+}
+
+// Проверка пароля при входе по справочнику пользователей
+// Неверный пароль не приводит к перехешированию, поэтому старый хеш замеряется на нём
+// Время верного и неверного пароля не должно различаться, кроме перехеширования
+static void BM_CheckPass(		benchmark::State& state, 
+								bool legacy, 
+								bool valid)
+{
+	FakeStorage storage;
+	const std::string login = legacy ? "bench-legacy" : "bench-argon2id";
+	if (legacy)
+	{
+		addLegacyUser(storage, login, "password");
+	}
+	else
+	{
+		addUser(storage, login, "password", false);
+	}
+	UserDirectory::load(storage);
+	Dao dao(storage);
+	const std::string password = valid ? "password" : "passwore";
+	const std::string context = "bench";
+
+	AllocationCounter allocations(state);
+	for (auto _ : state)
+	{
+		if (dao.checkPass(login, password, context) != valid)
+		{
+			state.SkipWithError("unexpected checkPass result");
+			break;
+		}
+	}
+}
+BENCHMARK_CAPTURE(BM_CheckPass, legacy_mismatch, true, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_CheckPass, argon2id_match, false, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_CheckPass, argon2id_mismatch, false, false)->Unit(benchmark::kMillisecond);
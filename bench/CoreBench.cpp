@@ -0,0 +1,136 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "Arena.h"
+#include "Logger.h"
+#include "Events.h"
+#include "EventsConst.h"
+#include "LoopRegistry.h"
+#include "SignalBook.h"
+#include "FakeStorage.h"
+#include "FakeTransport.h"
+#include "TestLoop.h"
+#include "AllocationCounter.h"
+
+
+// ИН соединения, выдаётся при каждом подключении
+static void BM_Uuid(benchmark::State& state)
+{
+	FakeStorage storage;
+	Events<FakeSocket> events(storage);
+
+	AllocationCounter allocations(state);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(events.uuid());
+	}
+}
+BENCHMARK(BM_Uuid);
+
+
+// Разбор входящего сообщения в арене, как в Dispatcher::dispatch
+static void BM_Parse(benchmark::State& state, const std::string& message)
+{
+	AllocationCounter allocations(state);
+	for (auto _ : state)
+	{
+		Arena::Scope scope;
+		MessageJson parsed = MessageJson::parse(message);
+		benchmark::DoNotOptimize(parsed);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * message.size()));
+}
+
+static std::string batchMessage(size_t count)
+{
+	std::string message = R"({"command":"batch","items":[)";
+	for (size_t index = 0; index < count; ++index)
+	{
+		message += (index ? "," : "");
+		message += R"({"command":"add","tickerSymbol":"T)" + std::to_string(index) + R"(","limits":"100"})";
+	}
+
+	return message + "]}";
+}
+
+BENCHMARK_CAPTURE(BM_Parse, authorization, std::string(R"({"command":"authorization","username":"login","password":"password"})"));
+BENCHMARK_CAPTURE(BM_Parse, add, std::string(R"({"command":"add","tickerSymbol":"AAPL","limits":"100"})"));
+BENCHMARK_CAPTURE(BM_Parse, add_typed, std::string(R"({"command":"add","channel":"alpha","tickerSymbol":"AAPL","side":"buy",)"
+	R"("quantity":1.5,"percent":25,"activateAt":1800000000000,"expiresAt":1800003600000})"));
+BENCHMARK_CAPTURE(BM_Parse, delete, std::string(R"({"command":"delete","tickerSymbol":"AAPL"})"));
+BENCHMARK_CAPTURE(BM_Parse, batch_20, batchMessage(20));
+BENCHMARK_CAPTURE(BM_Parse, history, std::string(R"({"command":"history","tickerSymbol":"AAPL","from":1700000000000,"to":1800000000000})"));
+
+
+// Сериализация рассылки добавления сигнала
+static void BM_Dump(benchmark::State& state)
+{
+	AllocationCounter allocations(state);
+	for (auto _ : state)
+	{
+		Arena::Scope scope;
+		MessageJson message;
+		message[JsonValue::COMMAND] = JsonValue::ADD_SIGNAL;
+		message[JsonValue::CHANNEL] = "alpha";
+		message[JsonValue::TICKER] = "AAPL";
+		message[JsonValue::LIMITS] = "100";
+		message[JsonValue::SIDE] = JsonValue::SIDE_BUY;
+		message[JsonValue::QUANTITY] = 1.5;
+		message[JsonValue::VERSION] = 42;
+		benchmark::DoNotOptimize(dumpToArena(message));
+	}
+}
+BENCHMARK(BM_Dump);
+
+
+// Запись в лог с двумя контекстами NDC, как в обработчиках
+static void BM_LoggerPublish(benchmark::State& state)
+{
+	static Logger s_log("Bench", Logger::FILE, "bench.log");
+	const std::string context = s_log.getContext() + " ";
+	const std::string userId = "9b2f6c1e-5f0a-4c3d-8e7b-1a2b3c4d5e6f";
+
+	AllocationCounter allocations(state);
+	for (auto _ : state)
+	{
+		s_log.info("The signal was added.", context + userId, "Bench::logger " + std::to_string(__LINE__));
+	}
+}
+BENCHMARK(BM_LoggerPublish);
+
+
+// Рассылка изменения книги подписчикам цикла: задача цикла, подмена книги и публикация в тему
+static void BM_Fanout(benchmark::State& state)
+{
+	FakeStorage storage;
+	TestLoop loop(0, storage);
+	const std::string topic = "bench";
+	for (int64_t index = 0; index < state.range(0); ++index)
+	{
+		FakeSocket& ws = loop.open("10.2.0." + std::to_string(index % 250 + 1));
+		ws.keep = false;
+		ws.subscribe(topic);
+	}
+
+	BookUpdate update;
+	update.channelId = 0;
+	update.topic = topic;
+	update.message = R"({"command":"add","tickerSymbol":"AAPL","limits":"100","version":1})";
+	uint64_t version = 0;
+
+	AllocationCounter allocations(state);
+	for (auto _ : state)
+	{
+		auto book = std::make_shared<SignalBook::Book>();
+		book->version = ++version;
+		update.book = book;
+		LoopRegistry::publish(update);
+		loop.run();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Fanout)->Arg(1)->Arg(100)->Arg(1000)->Arg(10000);
@@ -0,0 +1,112 @@
+#include <string>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include "Tls.h"
+
+
+// Контекст сервера с самоподписанным сертификатом и настройкой сессий как у циклов событий
+static SSL_CTX* serverContext()
+{
+	SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+	EVP_PKEY* key = EVP_EC_gen("P-256");
+	X509* cert = X509_new();
+	X509_set_version(cert, 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+	X509_set_pubkey(cert, key);
+	X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC,
+		reinterpret_cast<const unsigned char*>("bench"), -1, -1, 0);
+	X509_set_issuer_name(cert, X509_get_subject_name(cert));
+	X509_sign(cert, key, EVP_sha256());
+
+	SSL_CTX_use_certificate(ctx, cert);
+	SSL_CTX_use_PrivateKey(ctx, key);
+	X509_free(cert);
+	EVP_PKEY_free(key);
+
+	Tls::configure(ctx, "bench");
+
+	return ctx;
+}
+
+// Рукопожатие клиента и сервера через пару BIO в памяти
+// session - сессия для возобновления, nullptr - полное рукопожатие
+// Возвращает сессию клиента вместе с билетом, false в reused - сессия не возобновлена
+static SSL_SESSION* handshake(	SSL_CTX* serverCtx,
+								SSL_CTX* clientCtx,
+								SSL_SESSION* session,
+								bool& reused)
+{
+	SSL* server = SSL_new(serverCtx);
+	SSL* client = SSL_new(clientCtx);
+	BIO* serverBio = nullptr;
+	BIO* clientBio = nullptr;
+	BIO_new_bio_pair(&serverBio, 0, &clientBio, 0);
+	SSL_set_bio(server, serverBio, serverBio);
+	SSL_set_bio(client, clientBio, clientBio);
+	SSL_set_accept_state(server);
+	SSL_set_connect_state(client);
+	if (session)
+	{
+		SSL_set_session(client, session);
+	}
+
+	bool serverDone = false;
+	bool clientDone = false;
+	while (!serverDone || !clientDone)
+	{
+		clientDone = clientDone || SSL_do_handshake(client) == 1;
+		serverDone = serverDone || SSL_do_handshake(server) == 1;
+	}
+
+	// Билеты TLS 1.3 приходят после рукопожатия, клиент читает их из канала
+	char byte;
+	SSL_read(client, &byte, 1);
+
+	reused = SSL_session_reused(client) == 1;
+	SSL_SESSION* result = SSL_get1_session(client);
+	// Соединение без закрытия OpenSSL считает оборванным и запрещает возобновлять его сессию
+	SSL_set_shutdown(client, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	SSL_set_shutdown(server, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	SSL_free(client);
+	SSL_free(server);
+
+	return result;
+}
+
+// Подключение клиента с возобновлением сессии по билету и без него
+static void BM_TlsHandshake(	benchmark::State& state,
+								bool resume)
+{
+	SSL_CTX* serverCtx = serverContext();
+	SSL_CTX* clientCtx = SSL_CTX_new(TLS_client_method());
+	SSL_CTX_set_verify(clientCtx, SSL_VERIFY_NONE, nullptr);
+
+	bool reused = false;
+	SSL_SESSION* session = handshake(serverCtx, clientCtx, nullptr, reused);
+	for (auto _ : state)
+	{
+		SSL_SESSION* next = handshake(serverCtx, clientCtx, resume ? session : nullptr, reused);
+		if (reused != resume)
+		{
+			SSL_SESSION_free(next);
+			state.SkipWithError(resume ? "the session was not resumed" : "the session was resumed");
+			break;
+		}
+
+		SSL_SESSION_free(session);
+		session = next;
+	}
+
+	SSL_SESSION_free(session);
+	SSL_CTX_free(clientCtx);
+	SSL_CTX_free(serverCtx);
+}
+BENCHMARK_CAPTURE(BM_TlsHandshake, resumption_on, true)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_TlsHandshake, resumption_off, false)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,61 @@
+#include <string>
+#include <optional>
+
+#include <gtest/gtest.h>
+
+#include "Arena.h"
+
+
+// Сообщение, созданное внутри обработки и разрушенное после неё, и наоборот
+TEST(ArenaTest, JsonOutlivesScope)
+{
+	std::optional<MessageJson> escaped;
+	{
+		Arena::Scope scope;
+		escaped.emplace(MessageJson::parse(R"({"command":"add","tickerSymbol":"AAPL","limits":"100"})"));
+	}
+
+	// Следующее сообщение не перезаписывает память уцелевшего объекта
+	{
+		Arena::Scope scope;
+		MessageJson other = MessageJson::parse(R"({"command":"delete","tickerSymbol":"MSFT","limits":"000000000000"})");
+		EXPECT_EQ(other["tickerSymbol"], "MSFT");
+	}
+	EXPECT_EQ((*escaped)["tickerSymbol"], "AAPL");
+	EXPECT_EQ(dumpToArena(*escaped), R"({"command":"add","limits":"100","tickerSymbol":"AAPL"})");
+
+	{
+		Arena::Scope scope;
+		(*escaped)["version"] = 1;
+		escaped.reset();
+	}
+}
+
+TEST(ArenaTest, JsonEntersScope)
+{
+	MessageJson outer = MessageJson::parse(R"({"items":["A1","A2"]})");
+	{
+		Arena::Scope scope;
+		outer["items"].push_back("A3");
+		MessageJson copy = outer;
+		outer = MessageJson::object();
+		EXPECT_EQ(copy["items"].size(), 3U);
+	}
+	outer["items"] = { "B1" };
+	EXPECT_EQ(dumpToArena(outer), R"({"items":["B1"]})");
+}
+
+// Выравнивание сверх max_align_t проходит через счётчик распределителя
+TEST(ArenaTest, AlignedNewIsCounted)
+{
+	struct alignas(64) Line
+	{
+		char bytes[64];
+	};
+
+	uint64_t before = Arena::allocations();
+	Line* line = new Line();
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(line) % 64, 0U);
+	EXPECT_EQ(Arena::allocations(), before + 1);
+	delete line;
+}
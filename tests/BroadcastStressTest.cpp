@@ -0,0 +1,188 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <latch>
+#include <random>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+
+#include "EventsConst.h"
+#include "UserDirectory.h"
+#include "ChannelRegistry.h"
+#include "SignalBook.h"
+#include "FakeStorage.h"
+#include "FakeTransport.h"
+#include "TestLoop.h"
+
+
+// Циклы событий в своих потоках: в каждом администратор публикует изменения, пока в цикл входят новые пользователи
+// Каждый подписчик должен получить снимок и затем все изменения канала без пропусков и повторов по версиям,
+// а собранное из них состояние - совпасть с книгой канала
+// Тест рассчитан на запуск под ThreadSanitizer (TRADERINFO_SANITIZER=thread)
+TEST(BroadcastStressTest, JoinersConvergeWithConcurrentPublishers)
+{
+	constexpr unsigned int LOOPS = 4;
+	constexpr unsigned int JOINERS = 6;
+	constexpr unsigned int CHANGES = 150;
+	constexpr unsigned int TICKERS = 12;
+
+	FakeStorage storage;
+	for (unsigned int loopId = 0; loopId < LOOPS; ++loopId)
+	{
+		addUser(storage, "stress-admin" + std::to_string(loopId), "password", true);
+		for (unsigned int joiner = 0; joiner < JOINERS; ++joiner)
+		{
+			addUser(storage, "stress-user" + std::to_string(loopId) + "-" + std::to_string(joiner), "password", false);
+		}
+	}
+	UserDirectory::load(storage);
+	ChannelRegistry::load(storage);
+	std::shared_ptr<Channel> channel = ChannelRegistry::find("");
+
+	std::latch started(LOOPS);
+	std::latch published(LOOPS);
+	std::latch checked(LOOPS);
+	std::vector<std::vector<std::string>> errors(LOOPS);
+	std::vector<std::map<std::string, std::string>> states(LOOPS * JOINERS);
+
+	auto worker = [&](unsigned int loopId)
+	{
+		TestLoop loop(loopId, storage);
+		auto ip = [loopId](unsigned int index) { return "10.1." + std::to_string(loopId) + "." + std::to_string(index + 1); };
+
+		FakeSocket& admin = loop.open(ip(0));
+		if (!loop.login(admin, "stress-admin" + std::to_string(loopId), "password"))
+		{
+			errors[loopId].push_back("admin login failed");
+		}
+		started.arrive_and_wait();
+
+		// Публикации перемежаются входом новых пользователей и итерациями цикла
+		std::mt19937 random(loopId);
+		std::vector<FakeSocket*> joiners;
+		for (unsigned int change = 0; change < CHANGES; ++change)
+		{
+			std::string ticker = "T" + std::to_string(random() % TICKERS);
+			if (random() % 3)
+			{
+				loop.command(admin, R"({"command":"add","tickerSymbol":")" + ticker + R"(","limits":")" +
+					std::to_string(loopId) + "-" + std::to_string(change) + R"("})");
+			}
+			else
+			{
+				loop.command(admin, R"({"command":"delete","tickerSymbol":")" + ticker + R"("})");
+			}
+
+			if (change % (CHANGES / JOINERS) == CHANGES / JOINERS / 2 && joiners.size() < JOINERS)
+			{
+				FakeSocket& ws = loop.open(ip(static_cast<unsigned int>(joiners.size()) + 1));
+				std::string login = "stress-user" + std::to_string(loopId) + "-" + std::to_string(joiners.size());
+				if (!loop.login(ws, login, "password"))
+				{
+					errors[loopId].push_back("login failed for " + login);
+				}
+				joiners.push_back(&ws);
+			}
+
+			if (random() % 2)
+			{
+				loop.context.loop->run();
+			}
+		}
+
+		// Остальные циклы ещё публикуют, их изменения выполняются задачами этого цикла
+		published.count_down();
+		while (!published.try_wait())
+		{
+			loop.context.loop->run();
+			std::this_thread::yield();
+		}
+		loop.run();
+
+		// Состояние подписчика: снимок, затем изменения с версиями строго подряд
+		for (size_t index = 0; index < joiners.size(); ++index)
+		{
+			std::map<std::string, std::string>& state = states[loopId * JOINERS + index];
+			uint64_t version = 0;
+			bool snapshot = false;
+			for (const nlohmann::json& message : received(*joiners[index]))
+			{
+				std::string command = message.value(JsonValue::COMMAND, std::string{});
+				if (command == JsonValue::ACTIVE_SIGNAL && !snapshot)
+				{
+					state[message[JsonValue::TICKER]] = message[JsonValue::LIMITS];
+				}
+				else if (command == JsonValue::SNAPSHOT)
+				{
+					snapshot = true;
+					version = message[JsonValue::VERSION];
+					if (message[JsonValue::COUNT] != state.size())
+					{
+						errors[loopId].push_back("snapshot count does not match its frames");
+					}
+				}
+				else if (command == JsonValue::ADD_SIGNAL || command == JsonValue::DEL_SIGNAL)
+				{
+					uint64_t next = message[JsonValue::VERSION];
+					if (!snapshot || next != version + 1)
+					{
+						errors[loopId].push_back("version " + std::to_string(next) + " after " + std::to_string(version));
+					}
+					version = next;
+
+					if (command == JsonValue::ADD_SIGNAL)
+					{
+						state[message[JsonValue::TICKER]] = message[JsonValue::LIMITS];
+					}
+					else
+					{
+						state.erase(message[JsonValue::TICKER]);
+					}
+				}
+			}
+			if (version != channel->book.latest()->version)
+			{
+				errors[loopId].push_back("stopped at version " + std::to_string(version) +
+					" of " + std::to_string(channel->book.latest()->version));
+			}
+		}
+
+		checked.arrive_and_wait();
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int loopId = 0; loopId < LOOPS; ++loopId)
+	{
+		threads.emplace_back(worker, loopId);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	for (unsigned int loopId = 0; loopId < LOOPS; ++loopId)
+	{
+		for (const std::string& error : errors[loopId])
+		{
+			ADD_FAILURE() << "loop " << loopId << ": " << error;
+		}
+	}
+
+	// Все подписчики сошлись с книгой канала
+	std::shared_ptr<const SignalBook::Book> book = channel->book.latest();
+	std::map<std::string, std::string> expected;
+	for (size_t id = 0; id < book->signals.size(); ++id)
+	{
+		if (book->signals[id].flags & SIGNAL_ACTIVE)
+		{
+			expected[book->tickers[id]] = book->limits[id];
+		}
+	}
+	for (const auto& state : states)
+	{
+		EXPECT_EQ(state, expected);
+	}
+}
@@ -0,0 +1,621 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <latch>
+#include <chrono>
+#include <filesystem>
+
+#include <gtest/gtest.h>
+#include <argon2.h>
+#include <nlohmann/json.hpp>
+
+#include "EventsConst.h"
+#include "DaoSettings.h"
+#include "ChannelSettings.h"
+#include "Constants.h"
+#include "UserDirectory.h"
+#include "ChannelRegistry.h"
+#include "SessionRegistry.h"
+#include "Signal.h"
+#include "SignalScheduler.h"
+#include "SignalSettings.h"
+#include "FakeStorage.h"
+#include "FailoverStorage.h"
+#include "FakeTransport.h"
+#include "TestLoop.h"
+
+
+// Обработчики команд на одном цикле событий с хранилищем в памяти
+// Каждый тест заводит своих пользователей и адреса: лимиты частоты и сессии общие для процесса
+class EventsTest : public ::testing::Test
+{
+protected:
+	FakeStorage					storage;
+	std::unique_ptr<TestLoop>	loop;
+	std::string					admin;
+	std::string					user;
+	unsigned int				nextIp	= 0;
+
+
+	void SetUp() override
+	{
+		static unsigned int s_test = 0;
+		++s_test;
+		admin = "admin" + std::to_string(s_test);
+		user = "user" + std::to_string(s_test);
+
+		addUser(storage, admin, "admin-password", true);
+		addUser(storage, user, "user-password", false);
+		UserDirectory::load(storage);
+		ChannelRegistry::load(storage);
+
+		loop = std::make_unique<TestLoop>(0, storage);
+	}
+
+	void TearDown() override
+	{
+		loop.reset();
+	}
+
+	// Новое соединение со своего адреса
+	FakeSocket& connect()
+	{
+		static unsigned int s_ip = 0;
+		++s_ip;
+
+		return loop->open("10.0." + std::to_string(s_ip / 250) + "." + std::to_string(s_ip % 250 + 1));
+	}
+
+	FakeSocket& loginAdmin()
+	{
+		FakeSocket& ws = connect();
+		EXPECT_TRUE(loop->login(ws, admin, "admin-password"));
+
+		return ws;
+	}
+
+	FakeSocket& loginUser()
+	{
+		FakeSocket& ws = connect();
+		EXPECT_TRUE(loop->login(ws, user, "user-password"));
+
+		return ws;
+	}
+
+	// Последнее сообщение соединения
+	static nlohmann::json last(const FakeSocket& ws)
+	{
+		return ws.sent.empty() ? nlohmann::json() : nlohmann::json::parse(ws.sent.back());
+	}
+
+	// Сообщения с заданной командой
+	static std::vector<nlohmann::json> commands(const FakeSocket& ws,
+												const std::string& command)
+	{
+		std::vector<nlohmann::json> result;
+		for (const nlohmann::json& message : received(ws))
+		{
+			if (message.value(JsonValue::COMMAND, std::string{}) == command)
+			{
+				result.push_back(message);
+			}
+		}
+
+		return result;
+	}
+
+	// Версия канала по умолчанию из конца снимка
+	static uint64_t snapshotVersion(const FakeSocket& ws)
+	{
+		std::vector<nlohmann::json> ends = commands(ws, JsonValue::SNAPSHOT);
+
+		return ends.empty() ? 0 : ends.back()[JsonValue::VERSION].get<uint64_t>();
+	}
+};
+
+
+TEST_F(EventsTest, AuthorizationSubscribesAndEndsSnapshot)
+{
+	FakeSocket& ws = loginUser();
+
+	EXPECT_TRUE(ws.data.auth);
+	EXPECT_FALSE(ws.data.isAdmin);
+	EXPECT_TRUE(ws.isSubscribed(ChannelRegistry::find("")->topic));
+	EXPECT_EQ(SessionRegistry::count(user), 1U);
+
+	nlohmann::json end = last(ws);
+	EXPECT_EQ(end[JsonValue::COMMAND], JsonValue::SNAPSHOT);
+	EXPECT_EQ(end[JsonValue::COUNT], 0);
+	EXPECT_EQ(end[JsonValue::VERSION], ChannelRegistry::find("")->book.latest()->version);
+}
+
+TEST_F(EventsTest, WrongPasswordIsRejected)
+{
+	FakeSocket& ws = connect();
+
+	EXPECT_FALSE(loop->login(ws, user, "wrong-password"));
+	EXPECT_EQ(last(ws)[JsonValue::AUTH], JsonValue::AUTH_FALSE);
+	EXPECT_FALSE(ws.isSubscribed(ChannelRegistry::find("")->topic));
+	EXPECT_EQ(SessionRegistry::count(user), 0U);
+}
+
+TEST_F(EventsTest, UnknownUserIsRejected)
+{
+	FakeSocket& ws = connect();
+
+	EXPECT_FALSE(loop->login(ws, "nobody", "password"));
+	EXPECT_EQ(last(ws)[JsonValue::AUTH], JsonValue::AUTH_FALSE);
+}
+
+TEST_F(EventsTest, AddIsStoredAndBroadcast)
+{
+	FakeSocket& subscriber = loginUser();
+	FakeSocket& publisher = loginAdmin();
+	uint64_t version = snapshotVersion(subscriber);
+
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"AAPL","limits":"100"})");
+	EXPECT_TRUE(storage.hExists(DaoSettings::SIGNALS_DB, "AAPL"));
+
+	// Ответ и рассылка приходят в цикл задачами, ответ - первым
+	EXPECT_TRUE(commands(publisher, JsonValue::ACTION_SUCCESS).empty());
+	EXPECT_TRUE(commands(subscriber, JsonValue::ADD_SIGNAL).empty());
+	loop->run();
+	EXPECT_EQ(commands(publisher, JsonValue::ACTION_SUCCESS).size(), 1U);
+	std::vector<nlohmann::json> sent = received(publisher);
+	ASSERT_FALSE(sent.empty());
+	EXPECT_EQ(sent.back()[JsonValue::COMMAND], JsonValue::ADD_SIGNAL);
+
+	std::vector<nlohmann::json> broadcasts = commands(subscriber, JsonValue::ADD_SIGNAL);
+	ASSERT_EQ(broadcasts.size(), 1U);
+	EXPECT_EQ(broadcasts[0][JsonValue::TICKER], "AAPL");
+	EXPECT_EQ(broadcasts[0][JsonValue::LIMITS], "100");
+	EXPECT_EQ(broadcasts[0][JsonValue::VERSION], version + 1);
+}
+
+TEST_F(EventsTest, DeleteIsStoredAndBroadcast)
+{
+	FakeSocket& publisher = loginAdmin();
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"MSFT","limits":"10"})");
+	loop->run();
+
+	FakeSocket& subscriber = loginUser();
+	loop->command(publisher, R"({"command":"delete","tickerSymbol":"MSFT"})");
+	EXPECT_FALSE(storage.hExists(DaoSettings::SIGNALS_DB, "MSFT"));
+	loop->run();
+	EXPECT_EQ(commands(publisher, JsonValue::ACTION_SUCCESS).size(), 2U);
+
+	std::vector<nlohmann::json> broadcasts = commands(subscriber, JsonValue::DEL_SIGNAL);
+	ASSERT_EQ(broadcasts.size(), 1U);
+	EXPECT_EQ(broadcasts[0][JsonValue::TICKER], "MSFT");
+	EXPECT_EQ(broadcasts[0][JsonValue::VERSION], snapshotVersion(subscriber) + 1);
+
+	// Удалённого сигнала нет в снимке нового пользователя
+	FakeSocket& late = loginUser();
+	EXPECT_TRUE(commands(late, JsonValue::ACTIVE_SIGNAL).empty());
+	EXPECT_EQ(last(late)[JsonValue::COUNT], 0);
+}
+
+TEST_F(EventsTest, DeleteOfMissingSignalFails)
+{
+	FakeSocket& publisher = loginAdmin();
+
+	loop->command(publisher, R"({"command":"delete","tickerSymbol":"NONE"})");
+	loop->run();
+	EXPECT_EQ(last(publisher)[JsonValue::COMMAND], JsonValue::ACTION_FAIL);
+}
+
+TEST_F(EventsTest, InvalidSignalIsRejectedBeforeStorage)
+{
+	FakeSocket& publisher = loginAdmin();
+	size_t calls = storage.calls;
+
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"bad ticker","limits":"1"})");
+	EXPECT_EQ(last(publisher)[JsonValue::COMMAND], JsonValue::ACTION_FAIL);
+	EXPECT_EQ(storage.calls, calls);
+}
+
+TEST_F(EventsTest, UserCannotPublish)
+{
+	FakeSocket& ws = loginUser();
+	size_t sent = ws.sent.size();
+
+	loop->command(ws, R"({"command":"add","tickerSymbol":"TSLA","limits":"1"})");
+	loop->run();
+	EXPECT_FALSE(storage.hExists(DaoSettings::SIGNALS_DB, "TSLA"));
+	EXPECT_EQ(ws.sent.size(), sent);
+}
+
+TEST_F(EventsTest, GuestCannotPublish)
+{
+	FakeSocket& ws = connect();
+
+	loop->command(ws, R"({"command":"add","tickerSymbol":"TSLA","limits":"1"})");
+	EXPECT_FALSE(storage.hExists(DaoSettings::SIGNALS_DB, "TSLA"));
+	EXPECT_TRUE(ws.sent.empty());
+}
+
+TEST_F(EventsTest, SnapshotContainsActiveSignals)
+{
+	FakeSocket& publisher = loginAdmin();
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"GOOG","limits":"5"})");
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"AMZN","limits":"7"})");
+	loop->run();
+
+	FakeSocket& ws = loginUser();
+	std::vector<nlohmann::json> frames = commands(ws, JsonValue::ACTIVE_SIGNAL);
+	ASSERT_EQ(frames.size(), 2U);
+	EXPECT_EQ(last(ws)[JsonValue::COUNT], 2);
+	EXPECT_EQ(last(ws)[JsonValue::VERSION], ChannelRegistry::find("")->book.latest()->version);
+}
+
+// Изменение, ещё не дошедшее до цикла, не попадает в снимок и приходит после него с большей версией
+TEST_F(EventsTest, LateJoinerGetsPendingChangeAfterSnapshot)
+{
+	FakeSocket& publisher = loginAdmin();
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"NFLX","limits":"3"})");
+
+	FakeSocket& late = loginUser();
+	EXPECT_TRUE(commands(late, JsonValue::ACTIVE_SIGNAL).empty());
+	uint64_t version = snapshotVersion(late);
+
+	loop->run();
+	std::vector<nlohmann::json> broadcasts = commands(late, JsonValue::ADD_SIGNAL);
+	ASSERT_EQ(broadcasts.size(), 1U);
+	EXPECT_EQ(broadcasts[0][JsonValue::VERSION], version + 1);
+}
+
+TEST_F(EventsTest, BatchIsBroadcastOnce)
+{
+	FakeSocket& subscriber = loginUser();
+	FakeSocket& publisher = loginAdmin();
+
+	loop->command(publisher, R"({"command":"batch","items":[)"
+		R"({"command":"add","tickerSymbol":"A1","limits":"1"},)"
+		R"({"command":"add","tickerSymbol":"bad ticker","limits":"1"},)"
+		R"({"command":"close","tickerSymbol":"A2"}]})");
+	loop->run();
+
+	// Ответ администратору приходит раньше рассылки пакета
+	std::vector<nlohmann::json> replies = commands(publisher, JsonValue::BATCH);
+	ASSERT_FALSE(replies.empty());
+	nlohmann::json response = replies[0];
+	ASSERT_EQ(response[JsonValue::ITEMS].size(), 3U);
+	EXPECT_EQ(response[JsonValue::ITEMS][0], JsonValue::ACTION_SUCCESS);
+	EXPECT_EQ(response[JsonValue::ITEMS][1], JsonValue::ACTION_FAIL);
+	EXPECT_EQ(response[JsonValue::ITEMS][2], JsonValue::ACTION_UNKNOWN);
+
+	std::vector<nlohmann::json> broadcasts = commands(subscriber, JsonValue::BATCH);
+	ASSERT_EQ(broadcasts.size(), 1U);
+	EXPECT_EQ(broadcasts[0][JsonValue::ITEMS].size(), 1U);
+}
+
+// Отложенный сигнал рассылается при активации и снимается по сроку из книги и хранилища
+TEST_F(EventsTest, ScheduledSignalActivatesAndExpires)
+{
+	FakeSocket& subscriber = loginUser();
+	FakeSocket& publisher = loginAdmin();
+	uint64_t now = SignalCodec::now();
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"SCHD","limits":"1","activateAt":)" + std::to_string(now + 50) + 
+		R"(,"expiresAt":)" + std::to_string(now + 100) + "}");
+	loop->run();
+	EXPECT_EQ(commands(publisher, JsonValue::ACTION_SUCCESS).size(), 1U);
+	EXPECT_TRUE(commands(subscriber, JsonValue::ADD_SIGNAL).empty());
+
+	auto tickAt = [&](uint64_t ms)
+	{
+		std::this_thread::sleep_until(std::chrono::system_clock::time_point(std::chrono::milliseconds(ms + SignalSettings::TIMER_TICK_MS)));
+		SignalScheduler::tick(storage);
+		loop->run();
+	};
+
+	tickAt(now + 50);
+	std::vector<nlohmann::json> added = commands(subscriber, JsonValue::ADD_SIGNAL);
+	ASSERT_EQ(added.size(), 1U);
+	EXPECT_EQ(added[0][JsonValue::TICKER], "SCHD");
+	EXPECT_TRUE(storage.hExists(DaoSettings::SIGNALS_DB, "SCHD"));
+
+	tickAt(now + 100);
+	std::vector<nlohmann::json> removed = commands(subscriber, JsonValue::DEL_SIGNAL);
+	ASSERT_EQ(removed.size(), 1U);
+	EXPECT_EQ(removed[0][JsonValue::TICKER], "SCHD");
+	EXPECT_FALSE(storage.hExists(DaoSettings::SIGNALS_DB, "SCHD"));
+	EXPECT_FALSE(ChannelRegistry::find("")->book.holds("SCHD"));
+}
+
+// Таймер сигнала, заменённого в ту же миллисекунду, устаревает: его проверяет версия книги, а не время изменения
+TEST_F(EventsTest, ReplacedSignalIsNotExpired)
+{
+	FakeSocket& publisher = loginAdmin();
+	uint64_t now = SignalCodec::now();
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"RPLC","limits":"1","expiresAt":)" + std::to_string(now + 30) + "}");
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"RPLC","limits":"2"})");
+	loop->run();
+	EXPECT_EQ(commands(publisher, JsonValue::ACTION_SUCCESS).size(), 2U);
+
+	std::this_thread::sleep_until(std::chrono::system_clock::time_point(std::chrono::milliseconds(now + 30 + SignalSettings::TIMER_TICK_MS)));
+	SignalScheduler::tick(storage);
+	loop->run();
+
+	EXPECT_TRUE(storage.hExists(DaoSettings::SIGNALS_DB, "RPLC"));
+	EXPECT_TRUE(ChannelRegistry::find("")->book.holds("RPLC"));
+	EXPECT_TRUE(commands(publisher, JsonValue::DEL_SIGNAL).empty());
+}
+
+TEST_F(EventsTest, DeliveryReportCountsSubscribers)
+{
+	loginUser();
+	loginUser();
+	FakeSocket& publisher = loginAdmin();
+
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"IBM","limits":"2","delivery":true})");
+	loop->run();
+
+	std::vector<nlohmann::json> reports = commands(publisher, JsonValue::DELIVERY);
+	ASSERT_EQ(reports.size(), 1U);
+	EXPECT_EQ(reports[0][JsonValue::TICKER], "IBM");
+	EXPECT_EQ(reports[0][JsonValue::QUEUED], 3);
+	EXPECT_EQ(reports[0][JsonValue::DROPPED], 0);
+	ASSERT_EQ(reports[0][JsonValue::LOOPS].size(), 1U);
+}
+
+// Поля сохранённого сигнала другого типа не прерывают загрузку книги
+TEST_F(EventsTest, MalformedStoredSignalDoesNotBreakLoad)
+{
+	storage.hSet(DaoSettings::SIGNALS_DB, "BAD", R"({"limits":5,"time":"now","side":1,"activateAt":-1,"expiresAt":[]})");
+	EXPECT_NO_THROW(ChannelRegistry::load(storage));
+
+	std::shared_ptr<const SignalBook::Book> book = ChannelRegistry::find("")->book.latest();
+	EXPECT_EQ(book->count, 1U);
+
+	storage.hDel(DaoSettings::SIGNALS_DB, "BAD");
+	ChannelRegistry::load(storage);
+}
+
+// Перечитывание без изменений не меняет книгу, изменения мимо сервера приходят подписчикам пакетом
+TEST_F(EventsTest, ReloadPublishesOnlyChanges)
+{
+	FakeSocket& publisher = loginAdmin();
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"ORCL","limits":"4"})");
+	loop->run();
+	FakeSocket& subscriber = loginUser();
+
+	std::shared_ptr<const SignalBook::Book> book = ChannelRegistry::find("")->book.latest();
+	ChannelRegistry::load(storage);
+	EXPECT_EQ(ChannelRegistry::find("")->book.latest(), book);
+
+	std::map<std::string, std::string> stored;
+	storage.hGetAll(DaoSettings::SIGNALS_DB, stored);
+	storage.hSet(DaoSettings::SIGNALS_DB, "INTC", stored["ORCL"]);
+	storage.hDel(DaoSettings::SIGNALS_DB, "ORCL");
+	ChannelRegistry::load(storage);
+	loop->run();
+
+	std::vector<nlohmann::json> batches = commands(subscriber, JsonValue::BATCH);
+	ASSERT_EQ(batches.size(), 1U);
+	EXPECT_EQ(batches[0][JsonValue::VERSION], book->version + 1);
+	ASSERT_EQ(batches[0][JsonValue::ITEMS].size(), 2U);
+	EXPECT_EQ(batches[0][JsonValue::ITEMS][0][JsonValue::COMMAND], JsonValue::ADD_SIGNAL);
+	EXPECT_EQ(batches[0][JsonValue::ITEMS][0][JsonValue::TICKER], "INTC");
+	EXPECT_EQ(batches[0][JsonValue::ITEMS][1][JsonValue::COMMAND], JsonValue::DEL_SIGNAL);
+	EXPECT_EQ(batches[0][JsonValue::ITEMS][1][JsonValue::TICKER], "ORCL");
+
+	storage.hDel(DaoSettings::SIGNALS_DB, "INTC");
+	ChannelRegistry::load(storage);
+}
+
+// Отброшенными считаются отправки, которые не приняло соединение, а не все буферизованные
+TEST_F(EventsTest, DeliveryReportCountsDroppedSends)
+{
+	FakeSocket& full = loginUser();
+	full.buffered = ServerSettings::MAX_BACKPRESSURE;
+	FakeSocket& slow = loginUser();
+	slow.stalled = true;
+	FakeSocket& publisher = loginAdmin();
+
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"HPQ","limits":"2","delivery":true})");
+	loop->run();
+
+	std::vector<nlohmann::json> reports = commands(publisher, JsonValue::DELIVERY);
+	ASSERT_EQ(reports.size(), 1U);
+	EXPECT_EQ(reports[0][JsonValue::QUEUED], 2);
+	EXPECT_EQ(reports[0][JsonValue::BACKPRESSURED], 1);
+	EXPECT_EQ(reports[0][JsonValue::DROPPED], 1);
+	EXPECT_TRUE(commands(full, JsonValue::ADD_SIGNAL).empty());
+}
+
+// Цикл, снятый с регистрации до выполнения задачи доставки, не задерживает отчёт
+TEST_F(EventsTest, DeliveryReportSurvivesRemovedLoop)
+{
+	FakeSocket& publisher = loginAdmin();
+
+	std::latch registered(1);
+	std::latch published(1);
+	std::thread other([&]()
+		{
+			TestLoop removed(1, storage);
+			registered.count_down();
+			published.wait();
+		}
+	);
+	registered.wait();
+
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"DELL","limits":"2","delivery":true})");
+	published.count_down();
+	other.join();
+	loop->run();
+
+	std::vector<nlohmann::json> reports = commands(publisher, JsonValue::DELIVERY);
+	ASSERT_EQ(reports.size(), 1U);
+	ASSERT_EQ(reports[0][JsonValue::LOOPS].size(), 1U);
+	EXPECT_EQ(reports[0][JsonValue::LOOPS][0][JsonValue::LOOP], 0);
+}
+
+// Пользователь, удалённый из канала, теряет права и подписку открытой сессии при перечитывании
+TEST_F(EventsTest, ReloadRevokesRemovedMember)
+{
+	const std::string usersDb = ChannelSettings::KEY_PREFIX + "revoked" + ChannelSettings::KEY_SEP + ChannelSettings::USERS_SUFFIX;
+	storage.sAdd(ChannelSettings::CHANNELS_DB, "revoked");
+	storage.sAdd(usersDb, user);
+	ChannelRegistry::load(storage);
+	std::shared_ptr<Channel> channel = ChannelRegistry::find("revoked");
+	ASSERT_TRUE(channel);
+
+	FakeSocket& ws = loginUser();
+	ASSERT_TRUE(ws.isSubscribed(channel->topic));
+
+	storage.sRem(usersDb, user);
+	ChannelRegistry::load(storage);
+	loop->run();
+
+	EXPECT_FALSE(ws.isSubscribed(channel->topic));
+	EXPECT_FALSE(ws.data.channels & ChannelRegistry::bit(channel->id));
+	EXPECT_TRUE(ws.isSubscribed(ChannelRegistry::find("")->topic));
+}
+
+// Журнал читается вне цикла, страницы приходят задачами цикла по порядку, последняя без продолжения
+TEST_F(EventsTest, HistoryIsPagedFromLoopTasks)
+{
+	FakeSocket& publisher = loginAdmin();
+	for (long long index = 0; index < HistorySettings::PAGE_SIZE + 5; ++index)
+	{
+		loop->command(publisher, R"({"command":"add","tickerSymbol":"HIST","limits":")" + std::to_string(index) + R"("})");
+	}
+	loop->command(publisher, R"({"command":"delete","tickerSymbol":"HIST"})");
+	loop->run();
+
+	FakeSocket& reader = loginUser();
+	loop->command(reader, R"({"command":"history","tickerSymbol":"HIST"})");
+	loop->run();
+
+	std::vector<nlohmann::json> pages = commands(reader, JsonValue::HISTORY);
+	ASSERT_EQ(pages.size(), 2U);
+	EXPECT_EQ(pages[0][JsonValue::ITEMS].size(), static_cast<size_t>(HistorySettings::PAGE_SIZE));
+	EXPECT_TRUE(pages[0][JsonValue::MORE]);
+	ASSERT_EQ(pages[1][JsonValue::ITEMS].size(), 6U);
+	EXPECT_FALSE(pages[1][JsonValue::MORE]);
+	EXPECT_EQ(pages[0][JsonValue::ITEMS][0][JsonValue::LIMITS], "0");
+	EXPECT_EQ(pages[1][JsonValue::ITEMS][5][JsonValue::ACTION], JsonValue::DEL_SIGNAL);
+}
+
+// Запись журнала с испорченным ИН пропускается, остальные записи страницы отправляются
+TEST_F(EventsTest, HistorySkipsBadEntryId)
+{
+	FakeSocket& publisher = loginAdmin();
+	for (int index = 0; index < 3; ++index)
+	{
+		loop->command(publisher, R"({"command":"add","tickerSymbol":"BADID","limits":")" + std::to_string(index) + R"("})");
+	}
+	loop->run();
+
+	storage.badStreamId = true;
+	FakeSocket& reader = loginUser();
+	loop->command(reader, R"({"command":"history","tickerSymbol":"BADID"})");
+	loop->run();
+
+	std::vector<nlohmann::json> pages = commands(reader, JsonValue::HISTORY);
+	ASSERT_EQ(pages.size(), 1U);
+	ASSERT_EQ(pages[0][JsonValue::ITEMS].size(), 2U);
+	EXPECT_EQ(pages[0][JsonValue::ITEMS][0][JsonValue::LIMITS], "1");
+	EXPECT_FALSE(pages[0][JsonValue::MORE]);
+}
+
+// Пересчитанный при входе хеш сразу попадает в справочник, следующий вход не пересчитывает его снова
+TEST_F(EventsTest, RehashUpdatesDirectory)
+{
+	const std::string login = "rehash-" + user;
+	const std::string password = "rehash-password";
+	const std::string salt = "salt-" + login + "-0123456789";
+	char encoded[DaoSettings::ENCODED_LEN];
+	argon2id_hash_encoded(1U, DaoSettings::ARGON2_M_COST, DaoSettings::ARGON2_PARALLELISM, 
+		password.data(), password.size(), salt.data(), salt.size(), DaoSettings::HASH_LEN, encoded, sizeof(encoded));
+	storage.hSet(DaoSettings::USERS_DB, login, encoded);
+	UserDirectory::load(storage);
+
+	ASSERT_TRUE(loop->login(connect(), login, password));
+	std::optional<std::string> stored = storage.hGet(DaoSettings::USERS_DB, login);
+	ASSERT_TRUE(stored);
+	EXPECT_NE(*stored, encoded);
+
+	std::shared_ptr<const UserRecord> record = UserDirectory::find(login);
+	ASSERT_TRUE(record);
+	EXPECT_EQ(record->encoded, *stored);
+	EXPECT_EQ(record->cost, (Argon2Cost{ DaoSettings::ARGON2_T_COST, DaoSettings::ARGON2_M_COST, DaoSettings::ARGON2_PARALLELISM }));
+
+	ASSERT_TRUE(loop->login(connect(), login, password));
+	EXPECT_EQ(storage.hGet(DaoSettings::USERS_DB, login), stored);
+}
+
+// Без Redis удаление уходит в журнал и считается выполненным, поэтому наличие сигнала решает книга канала
+TEST_F(EventsTest, DegradedDeleteOfMissingSignalFails)
+{
+	std::filesystem::create_directories("journal");
+	std::filesystem::remove("journal/degraded.log");
+	FakeStorage* primary = nullptr;
+	FailoverStorage failover([&primary]()
+		{
+			auto created = std::make_unique<FakeStorage>();
+			primary = created.get();
+
+			return created;
+		}, "journal", "degraded.log");
+	primary->unavailable = true;
+	loop.reset();
+	loop = std::make_unique<TestLoop>(0, failover);
+
+	FakeSocket& publisher = loginAdmin();
+	FakeSocket& subscriber = loginUser();
+	loop->command(publisher, R"({"command":"add","tickerSymbol":"DGRD","limits":"1"})");
+	loop->command(publisher, R"({"command":"delete","tickerSymbol":"DGRD"})");
+	loop->command(publisher, R"({"command":"delete","tickerSymbol":"NEVER"})");
+	loop->command(publisher, R"({"command":"batch","items":[{"command":"delete","tickerSymbol":"NEVER"},)"
+		R"({"command":"add","tickerSymbol":"NEVER","limits":"2"},{"command":"delete","tickerSymbol":"NEVER"}]})");
+	loop->run();
+
+	std::vector<std::string> results;
+	for (const nlohmann::json& message : received(publisher))
+	{
+		std::string command = message.value(JsonValue::COMMAND, std::string{});
+		if (command == JsonValue::ACTION_SUCCESS || command == JsonValue::ACTION_FAIL)
+		{
+			results.push_back(command);
+		}
+	}
+	EXPECT_EQ(results, (std::vector<std::string>{ JsonValue::ACTION_SUCCESS, JsonValue::ACTION_SUCCESS, JsonValue::ACTION_FAIL }));
+
+	std::vector<nlohmann::json> batches = commands(publisher, JsonValue::BATCH);
+	ASSERT_FALSE(batches.empty());
+	EXPECT_EQ(batches[0][JsonValue::ITEMS], (nlohmann::json{ JsonValue::ACTION_FAIL, JsonValue::ACTION_SUCCESS, JsonValue::ACTION_SUCCESS }));
+
+	for (const nlohmann::json& message : commands(subscriber, JsonValue::DEL_SIGNAL))
+	{
+		EXPECT_NE(message[JsonValue::TICKER], "NEVER");
+	}
+	loop.reset();
+}
+
+// Сбой записи пересчитанного хеша не мешает входу с верным паролем, справочник остаётся прежним
+TEST_F(EventsTest, RehashFailureKeepsLogin)
+{
+	const std::string login = "rehash-fail-" + user;
+	const std::string password = "rehash-password";
+	const std::string salt = "salt-" + login + "-0123456789";
+	char encoded[DaoSettings::ENCODED_LEN];
+	argon2id_hash_encoded(1U, DaoSettings::ARGON2_M_COST, DaoSettings::ARGON2_PARALLELISM, 
+		password.data(), password.size(), salt.data(), salt.size(), DaoSettings::HASH_LEN, encoded, sizeof(encoded));
+	storage.hSet(DaoSettings::USERS_DB, login, encoded);
+	UserDirectory::load(storage);
+
+	FakeSocket& ws = connect();
+	storage.unavailable = true;
+	bool loggedIn = loop->login(ws, login, password);
+	storage.unavailable = false;
+	EXPECT_TRUE(loggedIn);
+
+	std::shared_ptr<const UserRecord> record = UserDirectory::find(login);
+	ASSERT_TRUE(record);
+	EXPECT_EQ(record->encoded, encoded);
+	EXPECT_EQ(storage.hGet(DaoSettings::USERS_DB, login), encoded);
+}
@@ -0,0 +1,245 @@
+#include "FakeStorage.h"
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <mutex>
+#include <limits>
+#include <cstdint>
+
+#include "Storage.h"
+
+
+// Разбирает ИН записи потока "номер-порядок", "-" и "+" - границы потока
+// Номер без порядка - нижняя граница для начала диапазона и верхняя для конца
+static std::pair<uint64_t, uint64_t> parseId(const std::string& id, bool upper)
+{
+	constexpr uint64_t MAX = std::numeric_limits<uint64_t>::max();
+	if (id == "-")
+	{
+		return { 0, 0 };
+	}
+	if (id == "+")
+	{
+		return { MAX, MAX };
+	}
+
+	size_t delimiter = id.find('-');
+	if (delimiter == std::string::npos)
+	{
+		return { std::stoull(id), upper ? MAX : 0 };
+	}
+
+	return { std::stoull(id.substr(0, delimiter)), std::stoull(id.substr(delimiter + 1)) };
+}
+
+
+// Имитирует недоступный Redis
+void FakeStorage::check()
+{
+	++calls;
+	if (unavailable)
+	{
+		throw StorageUnavailable("FakeStorage is unavailable");
+	}
+}
+
+bool FakeStorage::sAdd(			const std::string& db,
+								const std::string& value)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	return m_sets[db].insert(value).second;
+}
+
+bool FakeStorage::sRem(			const std::string& db,
+								const std::string& value)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	return m_sets[db].erase(value) > 0;
+}
+
+bool FakeStorage::hExists(		const std::string& db,
+								const std::string& key)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	auto hash = m_hashes.find(db);
+
+	return hash != m_hashes.end() && hash->second.count(key);
+}
+
+bool FakeStorage::hSet(			const std::string& db,
+								const std::string& key,
+								const std::string& value)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	auto [field, created] = m_hashes[db].insert_or_assign(key, value);
+
+	return created;
+}
+
+bool FakeStorage::hDel(			const std::string& db,
+								const std::string& key)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	return m_hashes[db].erase(key) > 0;
+}
+
+std::optional<std::string> FakeStorage::hGet(const std::string& db,
+								const std::string& key)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	auto hash = m_hashes.find(db);
+	if (hash == m_hashes.end())
+	{
+		return std::nullopt;
+	}
+	auto field = hash->second.find(key);
+	if (field == hash->second.end())
+	{
+		return std::nullopt;
+	}
+
+	return field->second;
+}
+
+long long FakeStorage::hIncrBy(	const std::string& db,
+								const std::string& key,
+								long long increment)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	std::string& value = m_hashes[db][key];
+	long long result = (value.empty() ? 0 : std::stoll(value)) + increment;
+	value = std::to_string(result);
+
+	return result;
+}
+
+long long FakeStorage::hGetAll(	const std::string& db,
+								std::map<std::string, std::string>& output)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	auto hash = m_hashes.find(db);
+	if (hash == m_hashes.end())
+	{
+		return 0;
+	}
+	output.insert(hash->second.begin(), hash->second.end());
+
+	return static_cast<long long>(hash->second.size());
+}
+
+std::vector<bool> FakeStorage::hBatch(const std::vector<HashOp>& ops)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	std::vector<bool> results;
+	for (const HashOp& op : ops)
+	{
+		if (op.type == HashOpType::HASH_DEL)
+		{
+			results.push_back(m_hashes[op.db].erase(op.key) > 0);
+		}
+		else
+		{
+			results.push_back(m_hashes[op.db].insert_or_assign(op.key, op.value).second);
+		}
+	}
+
+	return results;
+}
+
+bool FakeStorage::sIsMember(	const std::string& db,
+								const std::string& value)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	auto set = m_sets.find(db);
+
+	return set != m_sets.end() && set->second.count(value);
+}
+
+void FakeStorage::sMembers(		const std::string& db,
+								std::set<std::string>& output)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	auto set = m_sets.find(db);
+	if (set != m_sets.end())
+	{
+		output.insert(set->second.begin(), set->second.end());
+	}
+}
+
+// ИН записей - возрастающие номера, как миллисекунды у Redis
+std::string FakeStorage::xAdd(	const std::string& db,
+								const Fields& fields)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	StreamItem item;
+	item.id = std::to_string(++m_lastId) + "-0";
+	item.fields = fields;
+	m_streams[db].push_back(item);
+
+	return item.id;
+}
+
+void FakeStorage::xRange(		const std::string& db,
+								const std::string& start,
+								const std::string& end,
+								long long count,
+								std::vector<StreamItem>& output)
+{
+	check();
+	std::unique_lock ul(m_mtx);
+
+	auto stream = m_streams.find(db);
+	if (stream == m_streams.end())
+	{
+		return;
+	}
+
+	auto from = parseId(start, false);
+	auto to = parseId(end, true);
+	for (const StreamItem& item : stream->second)
+	{
+		if (count <= 0)
+		{
+			break;
+		}
+
+		auto id = parseId(item.id, false);
+		if (id >= from && id <= to)
+		{
+			output.push_back(item);
+			--count;
+		}
+	}
+
+	if (badStreamId && !output.empty())
+	{
+		output.front().id = "x" + output.front().id;
+	}
+}
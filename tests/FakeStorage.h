@@ -0,0 +1,82 @@
+#ifndef FAKESTORAGE_H
+#define FAKESTORAGE_H
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include "Storage.h"
+
+
+// Хранилище в памяти для тестов с семантикой Redis для команд, которыми пользуется сервер
+// Недоступность Redis имитируется флагом unavailable: каждое обращение бросает StorageUnavailable
+class FakeStorage : public Storage
+{
+private:
+	std::mutex												m_mtx;
+	std::map<std::string, std::map<std::string, std::string>> m_hashes;
+	std::map<std::string, std::set<std::string>>			m_sets;
+	std::map<std::string, std::vector<StreamItem>>			m_streams;
+	uint64_t												m_lastId	= 0;
+
+
+	void check();
+
+
+public:
+	std::atomic<bool>	unavailable{ false };
+	std::atomic<size_t>	calls{ 0 };		// обращения к хранилищу
+	std::atomic<bool>	badStreamId{ false };	// xRange портит ИН первой выданной записи
+
+
+	bool sAdd(					const std::string& db,
+								const std::string& value);
+
+	bool sRem(					const std::string& db,
+								const std::string& value);
+
+	bool hExists(				const std::string& db,
+								const std::string& key) override;
+
+	bool hSet(					const std::string& db,
+								const std::string& key,
+								const std::string& value) override;
+
+	bool hDel(					const std::string& db,
+								const std::string& key) override;
+
+	std::optional<std::string> hGet(const std::string& db,
+								const std::string& key) override;
+
+	long long hIncrBy(			const std::string& db,
+								const std::string& key,
+								long long increment) override;
+
+	long long hGetAll(			const std::string& db,
+								std::map<std::string, std::string>& output) override;
+
+	std::vector<bool> hBatch(	const std::vector<HashOp>& ops) override;
+
+	bool sIsMember(				const std::string& db,
+								const std::string& value) override;
+
+	void sMembers(				const std::string& db,
+								std::set<std::string>& output) override;
+
+	std::string xAdd(			const std::string& db,
+								const Fields& fields) override;
+
+	void xRange(				const std::string& db,
+								const std::string& start,
+								const std::string& end,
+								long long count,
+								std::vector<StreamItem>& output) override;
+
+};
+
+#endif // !FAKESTORAGE_H
@@ -0,0 +1,196 @@
+#include "FakeTransport.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <utility>
+
+#include "Constants.h"
+
+
+// Возвращает цикл текущего потока
+FakeLoop* FakeLoop::get()
+{
+	thread_local FakeLoop loop;
+
+	return &loop;
+}
+
+// Ставит задачу в очередь цикла
+void FakeLoop::defer(			std::function<void()>&& task)
+{
+	std::unique_lock ul(m_mtx);
+
+	m_tasks.push_back(std::move(task));
+}
+
+// Выполняет одну итерацию, задачи, поставленные во время итерации, ждут следующей
+size_t FakeLoop::run()
+{
+	std::vector<std::function<void()>> tasks;
+	{
+		std::unique_lock ul(m_mtx);
+		tasks.swap(m_tasks);
+	}
+
+	for (auto& task : tasks)
+	{
+		task();
+	}
+
+	return tasks.size();
+}
+
+// Выполняет итерации до пустой очереди
+size_t FakeLoop::runAll()
+{
+	size_t total = 0;
+	while (size_t done = run())
+	{
+		total += done;
+	}
+
+	return total;
+}
+
+
+// Отправляет сообщение подписчикам темы
+bool FakeApp::publish(			std::string_view topic,
+								std::string_view message,
+								uWS::OpCode opCode,
+								bool /*compress*/)
+{
+	auto found = m_topics.find(topic);
+	if (found == m_topics.end())
+	{
+		return false;
+	}
+
+	for (FakeSocket* ws : found->second)
+	{
+		ws->send(message, opCode);
+	}
+
+	return true;
+}
+
+// Количество подписчиков темы
+unsigned int FakeApp::numSubscribers(std::string_view topic)
+{
+	auto found = m_topics.find(topic);
+
+	return found == m_topics.end() ? 0 : static_cast<unsigned int>(found->second.size());
+}
+
+void FakeApp::close()
+{
+	closed = true;
+}
+
+
+FakeSocket::FakeSocket(			FakeApp& app) : m_app(app)
+{
+}
+
+// Соединение покидает темы приложения
+FakeSocket::~FakeSocket()
+{
+	for (const std::string& topic : m_topics)
+	{
+		auto found = m_app.m_topics.find(topic);
+		if (found != m_app.m_topics.end())
+		{
+			found->second.erase(this);
+		}
+	}
+}
+
+PerSocketData* FakeSocket::getUserData()
+{
+	return &data;
+}
+
+// Сохраняет текстовое сообщение, пинги и прочие кадры не сохраняются
+FakeSocket::SendStatus FakeSocket::send(std::string_view message,
+								uWS::OpCode opCode,
+								bool /*compress*/,
+								bool /*fin*/)
+{
+	if (closed || buffered >= ServerSettings::MAX_BACKPRESSURE)
+	{
+		return SendStatus::DROPPED;
+	}
+
+	if (opCode == uWS::OpCode::TEXT && keep)
+	{
+		sent.emplace_back(message);
+	}
+	if (stalled)
+	{
+		buffered += static_cast<unsigned int>(message.size());
+
+		return SendStatus::BACKPRESSURE;
+	}
+
+	return SendStatus::SUCCESS;
+}
+
+bool FakeSocket::subscribe(		std::string_view topic,
+								bool /*nonStrict*/)
+{
+	m_app.m_topics[std::string(topic)].insert(this);
+
+	return m_topics.emplace(topic).second;
+}
+
+bool FakeSocket::unsubscribe(	std::string_view topic,
+								bool /*nonStrict*/)
+{
+	auto found = m_app.m_topics.find(topic);
+	if (found != m_app.m_topics.end())
+	{
+		found->second.erase(this);
+	}
+
+	auto own = m_topics.find(topic);
+	if (own == m_topics.end())
+	{
+		return false;
+	}
+	m_topics.erase(own);
+
+	return true;
+}
+
+bool FakeSocket::isSubscribed(	std::string_view topic)
+{
+	return m_topics.find(topic) != m_topics.end();
+}
+
+unsigned int FakeSocket::getBufferedAmount()
+{
+	return buffered;
+}
+
+void FakeSocket::close()
+{
+	closed = true;
+}
+
+void FakeSocket::end(			int /*code*/,
+								std::string_view /*message*/)
+{
+	closed = true;
+}
+
+std::string_view FakeSocket::getRemoteAddressAsText()
+{
+	return data.ip;
+}
+
+void FakeSocket::cork(			std::function<void()>&& handler)
+{
+	handler();
+}
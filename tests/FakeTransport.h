@@ -0,0 +1,130 @@
+#ifndef FAKETRANSPORT_H
+#define FAKETRANSPORT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <functional>
+
+#include <uwebsockets/App.h>
+
+#include "PerSocketData.h"
+
+class FakeSocket;
+
+
+// Цикл событий для тестов
+// Задачи defer копятся в очереди и выполняются вызовом run в потоке, который обслуживает цикл
+class FakeLoop
+{
+private:
+	std::mutex							m_mtx;
+	std::vector<std::function<void()>>	m_tasks;
+
+
+public:
+	// Цикл текущего потока, как uWS::Loop::get()
+	static FakeLoop* get();
+
+	// Ставит задачу в очередь, вызывается из любого потока
+	void defer(				std::function<void()>&& task);
+
+	// Выполняет задачи, поставленные до вызова, - одна итерация цикла
+	// Возвращает количество выполненных задач
+	size_t run();
+
+	// Выполняет итерации, пока очередь не опустеет
+	size_t runAll();
+
+};
+
+
+// Приложение для тестов: темы и их подписчики в одном цикле
+class FakeApp
+{
+private:
+	friend class FakeSocket;
+
+	std::map<std::string, std::set<FakeSocket*>, std::less<>> m_topics;
+
+
+public:
+	// Отправляет сообщение всем подписчикам темы, как uWS::TemplatedApp::publish
+	bool publish(			std::string_view topic,
+							std::string_view message,
+							uWS::OpCode opCode,
+							bool compress = false);
+
+	unsigned int numSubscribers(std::string_view topic);
+
+	void close();
+
+	bool closed = false;
+
+};
+
+
+// Соединение для тестов с интерфейсом uWS::WebSocket
+// Отправленные текстовые сообщения сохраняются, буфер отправки имитируется счётчиком
+class FakeSocket
+{
+private:
+	FakeApp&					m_app;
+	std::set<std::string, std::less<>> m_topics;
+
+
+public:
+	enum SendStatus : int
+	{
+		BACKPRESSURE,
+		SUCCESS,
+		DROPPED
+	};
+
+	PerSocketData				data;
+	std::vector<std::string>	sent;					// отправленные текстовые сообщения
+	bool						keep		= true;		// сохранять ли сообщения в sent
+	unsigned int				buffered	= 0;		// байты в буфере отправки
+	bool						stalled		= false;	// клиент не читает, сообщения копятся в буфере
+	bool						closed		= false;
+
+
+	explicit FakeSocket(	FakeApp& app);
+	~FakeSocket();
+
+	FakeSocket(const FakeSocket&) = delete;
+	FakeSocket& operator=(const FakeSocket&) = delete;
+
+	PerSocketData* getUserData();
+
+	// Буфер на пределе ServerSettings::MAX_BACKPRESSURE - сообщение отбрасывается, как в uWS
+	SendStatus send(		std::string_view message,
+							uWS::OpCode opCode = uWS::OpCode::BINARY,
+							bool compress = false,
+							bool fin = true);
+
+	bool subscribe(			std::string_view topic,
+							bool nonStrict = false);
+
+	bool unsubscribe(		std::string_view topic,
+							bool nonStrict = false);
+
+	bool isSubscribed(		std::string_view topic);
+
+	unsigned int getBufferedAmount();
+
+	void close();
+
+	void end(				int code = 0,
+							std::string_view message = {});
+
+	std::string_view getRemoteAddressAsText();
+
+	void cork(				std::function<void()>&& handler);
+
+};
+
+#endif // !FAKETRANSPORT_H
@@ -0,0 +1,250 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "JournalFile.h"
+#include "FailoverStorage.h"
+#include "LocalStorage.h"
+#include "Storage.h"
+#include "FakeStorage.h"
+#include "DaoSettings.h"
+
+
+// Журналы пишутся в рабочий каталог теста
+static const std::string DIR{ "journal" };
+
+static std::string pathOf(const std::string& name)
+{
+	std::filesystem::create_directories(DIR);
+	std::filesystem::remove(DIR + "/" + name);
+
+	return DIR + "/" + name;
+}
+
+static std::string readFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& path, const std::string& content)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+
+TEST(JournalFileTest, RecordsSurviveReopen)
+{
+	std::string path = pathOf("reopen.log");
+	{
+		JournalFile file;
+		file.open(path, true);
+		file.append(1, { "users", "login", "value" });
+		file.append(2, { "users", "login" });
+	}
+	{
+		JournalFile file;
+		file.open(path, false);
+		file.append(3, {});
+	}
+
+	std::vector<JournalFile::Record> records;
+	ASSERT_TRUE(JournalFile::read(path, records));
+	ASSERT_EQ(records.size(), 3U);
+	EXPECT_EQ(records[0].operation, 1);
+	EXPECT_EQ(records[0].args, (std::vector<std::string>{ "users", "login", "value" }));
+	EXPECT_EQ(records[1].args.size(), 2U);
+	EXPECT_TRUE(records[2].args.empty());
+}
+
+// Повреждённая запись и всё после неё отбрасываются
+TEST(JournalFileTest, DamagedRecordIsDropped)
+{
+	std::string path = pathOf("damaged.log");
+	{
+		JournalFile file;
+		file.open(path, true);
+		file.append(1, { "users", "first", "1" });
+		file.append(1, { "users", "second", "2" });
+		file.append(1, { "users", "third", "3" });
+	}
+
+	std::string content = readFile(path);
+	size_t second = content.find("second");
+	ASSERT_NE(second, std::string::npos);
+	content[second] = 'S';
+	writeFile(path, content);
+
+	std::vector<JournalFile::Record> records;
+	EXPECT_FALSE(JournalFile::read(path, records));
+	ASSERT_EQ(records.size(), 1U);
+	EXPECT_EQ(records[0].args[1], "first");
+}
+
+// Длины из повреждённого файла не больше его остатка
+TEST(JournalFileTest, LengthsAreBoundedByFileSize)
+{
+	std::string path = pathOf("bounds.log");
+	std::string content;
+	uint8_t operation = 1;
+	uint32_t argc = 0xFFFFFFFFU;
+	content.append(reinterpret_cast<const char*>(&operation), sizeof(operation));
+	content.append(reinterpret_cast<const char*>(&argc), sizeof(argc));
+	content.append(16, '\0');
+	writeFile(path, content);
+
+	std::vector<JournalFile::Record> records;
+	EXPECT_FALSE(JournalFile::read(path, records));
+	EXPECT_TRUE(records.empty());
+}
+
+// Файл без метки читается в прежнем формате без контрольных сумм
+TEST(JournalFileTest, LegacyFileIsRead)
+{
+	std::string path = pathOf("legacy.log");
+	std::string content;
+	uint8_t operation = 2;
+	uint32_t argc = 2;
+	content.append(reinterpret_cast<const char*>(&operation), sizeof(operation));
+	content.append(reinterpret_cast<const char*>(&argc), sizeof(argc));
+	for (std::string_view arg : { std::string_view("users"), std::string_view("login") })
+	{
+		uint32_t length = static_cast<uint32_t>(arg.size());
+		content.append(reinterpret_cast<const char*>(&length), sizeof(length));
+		content.append(arg);
+	}
+	writeFile(path, content);
+
+	std::vector<JournalFile::Record> records;
+	EXPECT_TRUE(JournalFile::read(path, records));
+	ASSERT_EQ(records.size(), 1U);
+	EXPECT_EQ(records[0].args[1], "login");
+}
+
+// Без Redis записи, включая приращения, уходят в журнал и переживают перезапуск
+TEST(JournalFileTest, FailoverJournalsIncrements)
+{
+	std::string path = pathOf("outage.log");
+	const std::string unreachable{ "tcp://127.0.0.1:1" };
+	{
+		FailoverStorage storage(unreachable, 1, DIR, "outage.log");
+		EXPECT_TRUE(storage.hSet("users", "login", "hash"));
+		EXPECT_EQ(storage.hIncrBy("meta", "users_version", 1), 1);
+		EXPECT_EQ(storage.hIncrBy("meta", "users_version", 1), 2);
+		EXPECT_THROW(storage.hGet("meta", "users_version"), StorageError);
+	}
+
+	FailoverStorage storage(unreachable, 1, DIR, "outage.log");
+	EXPECT_THROW(storage.hGet("meta", "users_version"), StorageError);
+
+	std::vector<JournalFile::Record> records;
+	ASSERT_TRUE(JournalFile::read(path, records));
+	ASSERT_EQ(records.size(), 3U);
+	EXPECT_EQ(records[2].args, (std::vector<std::string>{ "meta", "users_version", "1" }));
+}
+
+// Хранилище, доступное при создании, сразу обслуживает чтение без восстановления
+TEST(JournalFileTest, FailoverReadsAfterConstruction)
+{
+	pathOf("connected.log");
+	FailoverStorage storage([]()
+		{
+			auto primary = std::make_unique<FakeStorage>();
+			primary->hSet("users", "login", "hash");
+
+			return primary;
+		}, DIR, "connected.log");
+
+	EXPECT_EQ(storage.hGet("users", "login"), "hash");
+	EXPECT_TRUE(storage.hSet("users", "other", "hash"));
+
+	std::vector<JournalFile::Record> records;
+	EXPECT_TRUE(JournalFile::read(DIR + "/connected.log", records));
+	EXPECT_TRUE(records.empty());
+}
+
+// После отказа Redis следующие записи идут в журнал за отказавшей, даже если Redis снова отвечает,
+// и повтор оставляет в Redis последнее значение
+TEST(JournalFileTest, FailoverKeepsWriteOrder)
+{
+	pathOf("order.log");
+	FakeStorage* primary = nullptr;
+	FailoverStorage storage([&primary]()
+		{
+			auto created = std::make_unique<FakeStorage>();
+			primary = created.get();
+
+			return created;
+		}, DIR, "order.log");
+	ASSERT_NE(primary, nullptr);
+
+	primary->unavailable = true;
+	storage.hSet("signals", "AAPL", "first");
+	primary->unavailable = false;
+	storage.hSet("signals", "AAPL", "second");
+	EXPECT_FALSE(primary->hExists("signals", "AAPL"));
+
+	storage.recover();
+	EXPECT_EQ(primary->hGet("signals", "AAPL"), "second");
+	EXPECT_EQ(storage.hGet("signals", "AAPL"), "second");
+}
+
+// Встроенное хранилище восстанавливается из журнала и отбрасывает повреждённый хвост
+TEST(JournalFileTest, LocalStorageReplaysJournal)
+{
+	std::string path = pathOf("local.log");
+	{
+		LocalStorage storage(DIR, "local.log");
+		storage.hSet("users", "first", "1");
+		EXPECT_EQ(storage.hIncrBy("meta", "users_version", 5), 5);
+		storage.hSet("users", "second", "2");
+	}
+
+	std::string content = readFile(path);
+	content[content.size() - 1] ^= 0x5A;
+	writeFile(path, content);
+
+	LocalStorage storage(DIR, "local.log");
+	EXPECT_EQ(storage.hGet("users", "first"), "1");
+	EXPECT_EQ(storage.hGet("meta", "users_version"), "5");
+	EXPECT_FALSE(storage.hExists("users", "second"));
+}
+
+// Журнал сжимает maintain главного потока, запись только дописывает его
+TEST(JournalFileTest, LocalStorageCompactsOnMaintain)
+{
+	std::string path = pathOf("compact.log");
+	const size_t writes = DaoSettings::COMPACT_MIN * 2;
+	{
+		LocalStorage storage(DIR, "compact.log");
+		for (size_t index = 1; index <= writes; ++index)
+		{
+			storage.hSet("users", "first", std::to_string(index));
+		}
+
+		std::vector<JournalFile::Record> records;
+		EXPECT_TRUE(JournalFile::read(path, records));
+		EXPECT_EQ(records.size(), writes);
+
+		storage.maintain();
+		records.clear();
+		EXPECT_TRUE(JournalFile::read(path, records));
+		EXPECT_EQ(records.size(), 1U);
+		EXPECT_FALSE(std::filesystem::exists(JournalFile::tempPath(path)));
+
+		// Журнал после подмены открыт для записи
+		storage.hSet("users", "second", "2");
+	}
+
+	LocalStorage storage(DIR, "compact.log");
+	EXPECT_EQ(storage.hGet("users", "first"), std::to_string(writes));
+	EXPECT_EQ(storage.hGet("users", "second"), "2");
+}
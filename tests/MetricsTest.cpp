@@ -0,0 +1,49 @@
+#include <string>
+#include <set>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "Metrics.h"
+
+
+// Имя семейства ряда: без меток и суффиксов гистограммы
+static std::string family(const std::string& line)
+{
+	std::string name = line.substr(0, line.find_first_of("{ "));
+	for (const std::string suffix : { "_bucket", "_sum", "_count" })
+	{
+		if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+		{
+			return name.substr(0, name.size() - suffix.size());
+		}
+	}
+
+	return name;
+}
+
+// HELP и TYPE выводятся один раз на имя, все ряды имени идут сразу за ними,
+// иначе Prometheus отвергает весь ответ
+TEST(MetricsTest, RenderGroupsSeriesByName)
+{
+	Metrics::observe(Metrics::REDIS_HGET, 10);
+	Metrics::observe(Metrics::REDIS_XRANGE, 10);
+
+	std::istringstream text(Metrics::render());
+	std::set<std::string> types;
+	std::string current;
+	std::string line;
+	while (std::getline(text, line))
+	{
+		if (line.rfind("# TYPE ", 0) == 0)
+		{
+			current = line.substr(7, line.find(' ', 7) - 7);
+			EXPECT_TRUE(types.insert(current).second) << "duplicate TYPE " << current;
+		}
+		else if (!line.empty() && line[0] != '#')
+		{
+			EXPECT_EQ(family(line), current) << line;
+		}
+	}
+	EXPECT_FALSE(types.empty());
+}
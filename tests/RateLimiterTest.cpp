@@ -0,0 +1,63 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+#include "RateLimiter.h"
+#include "LimitSettings.h"
+
+
+// Без пополнения ключ получает ровно свой запас
+TEST(RateLimiterTest, BurstIsSpentOnce)
+{
+	RateLimiter limiter(0.0, 3.0, LimitSettings::STRIPES * LimitSettings::PROBES);
+
+	EXPECT_TRUE(limiter.allow("10.0.0.1"));
+	EXPECT_TRUE(limiter.allow("10.0.0.1"));
+	EXPECT_TRUE(limiter.allow("10.0.0.1"));
+	EXPECT_FALSE(limiter.allow("10.0.0.1"));
+	EXPECT_TRUE(limiter.allow("10.0.0.2"));
+}
+
+// Ключи сверх таблицы вытесняют старые корзины, но не получают нового запаса
+TEST(RateLimiterTest, EvictionDoesNotRefill)
+{
+	constexpr size_t SIZE = LimitSettings::STRIPES * LimitSettings::PROBES;
+	RateLimiter limiter(0.0, 1.0, SIZE);
+
+	size_t allowed = 0;
+	for (size_t index = 0; index < SIZE * 8; ++index)
+	{
+		allowed += limiter.allow("key-" + std::to_string(index)) ? 1 : 0;
+	}
+	EXPECT_LE(allowed, SIZE);
+}
+
+// Таблица общая для потоков: запас ключа не умножается на количество циклов
+TEST(RateLimiterTest, LimitIsSharedAcrossThreads)
+{
+	constexpr unsigned int THREADS = 4;
+	RateLimiter limiter(0.0, 10.0);
+
+	std::atomic<unsigned int> allowed{ 0 };
+	std::vector<std::thread> threads;
+	for (unsigned int thread = 0; thread < THREADS; ++thread)
+	{
+		threads.emplace_back([&]()
+			{
+				for (int attempt = 0; attempt < 10; ++attempt)
+				{
+					allowed += limiter.allow("login") ? 1 : 0;
+				}
+			}
+		);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	EXPECT_EQ(allowed, 10U);
+}
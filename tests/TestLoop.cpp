@@ -0,0 +1,125 @@
+#include "TestLoop.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+#include <argon2.h>
+
+#include "Storage.h"
+#include "Events.h"
+#include "EventsConst.h"
+#include "TypeLog.h"
+#include "Dispatcher.h"
+#include "LoopRegistry.h"
+#include "SessionRegistry.h"
+#include "DaoSettings.h"
+#include "Arena.h"
+#include "FakeTransport.h"
+#include "FakeStorage.h"
+
+
+// Регистрирует цикл потока, после чего он получает рассылки
+TestLoop::TestLoop(				unsigned int id, 
+								Storage& storage) : events(storage)
+{
+	context.id = id;
+	context.context = "test-loop-" + std::to_string(id) + " ";
+	context.loop = FakeLoop::get();
+	context.app = &app;
+
+	LoopRegistry::add(&context);
+}
+
+// Закрывает соединения и снимает цикл с регистрации
+TestLoop::~TestLoop()
+{
+	while (!m_sockets.empty())
+	{
+		close(*m_sockets.back());
+	}
+
+	LoopRegistry::remove(&context);
+	context.loop->runAll();
+}
+
+FakeSocket& TestLoop::open(		const std::string& ip)
+{
+	auto ws = std::make_unique<FakeSocket>(app);
+	ws->data.userId = "user-" + std::to_string(context.id) + "-" + std::to_string(++m_nextUser);
+	ws->data.login = ConstValue::NONE;
+	ws->data.ip = ip;
+
+	context.sockets.insert(ws.get());
+	++context.connections;
+	m_sockets.push_back(std::move(ws));
+
+	return *m_sockets.back();
+}
+
+void TestLoop::close(			FakeSocket& ws)
+{
+	context.sockets.erase(&ws);
+	--context.connections;
+	SessionRegistry::remove(&ws);
+
+	m_sockets.erase(std::find_if(m_sockets.begin(), m_sockets.end(), [&ws](const auto& socket) { return socket.get() == &ws; }));
+}
+
+// Память сообщения берётся из арены потока, как в обработчике .message
+void TestLoop::command(			FakeSocket& ws, 
+								const std::string& message)
+{
+	Arena::Scope scope;
+	Dispatcher<FakeSocket>::dispatch(&ws, message, ws.data.userId, events);
+}
+
+bool TestLoop::login(			FakeSocket& ws, 
+								const std::string& username, 
+								const std::string& password)
+{
+	nlohmann::json message;
+	message[JsonValue::COMMAND] = JsonValue::AUTH;
+	message[JsonValue::USERNAME] = username;
+	message[JsonValue::PASSWORD] = password;
+	command(ws, message.dump());
+
+	return ws.data.auth;
+}
+
+size_t TestLoop::run()
+{
+	return context.loop->runAll();
+}
+
+
+// Хеш с параметрами по умолчанию не перехешируется при входе
+void addUser(					FakeStorage& storage, 
+								const std::string& login, 
+								const std::string& password, 
+								bool admin)
+{
+	const std::string salt = "salt-" + login + "-0123456789";
+	char encoded[DaoSettings::ENCODED_LEN];
+	argon2id_hash_encoded(DaoSettings::ARGON2_T_COST, DaoSettings::ARGON2_M_COST, DaoSettings::ARGON2_PARALLELISM, 
+		password.data(), password.size(), salt.data(), salt.size(), DaoSettings::HASH_LEN, encoded, sizeof(encoded));
+
+	storage.hSet(DaoSettings::USERS_DB, login, encoded);
+	if (admin)
+	{
+		storage.sAdd(DaoSettings::ADMINS_DB, login);
+	}
+}
+
+std::vector<nlohmann::json> received(const FakeSocket& ws)
+{
+	std::vector<nlohmann::json> messages;
+	for (const std::string& message : ws.sent)
+	{
+		messages.push_back(nlohmann::json::parse(message));
+	}
+
+	return messages;
+}
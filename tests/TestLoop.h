@@ -0,0 +1,69 @@
+#ifndef TESTLOOP_H
+#define TESTLOOP_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <nlohmann/json.hpp>
+
+#include "Storage.h"
+#include "Events.h"
+#include "LoopRegistry.h"
+#include "FakeTransport.h"
+#include "FakeStorage.h"
+
+
+// Цикл событий сервера в потоке теста
+// Создаётся, работает и разрушается в одном потоке, как цикл в потоке сервера
+class TestLoop
+{
+private:
+	std::vector<std::unique_ptr<FakeSocket>> m_sockets;
+	unsigned int	m_nextUser	= 0;
+
+
+public:
+	LoopContext				context;
+	FakeApp					app;
+	Events<FakeSocket>		events;
+
+
+	TestLoop(				unsigned int id, 
+							Storage& storage);
+	~TestLoop();
+
+	TestLoop(const TestLoop&) = delete;
+	TestLoop& operator=(const TestLoop&) = delete;
+
+	// Открывает соединение, как обработчик .open
+	FakeSocket& open(		const std::string& ip);
+
+	// Закрывает соединение, как обработчик .close
+	void close(				FakeSocket& ws);
+
+	// Передаёт сообщение диспетчеру с проверкой прав, как обработчик .message
+	void command(			FakeSocket& ws, 
+							const std::string& message);
+
+	// Открывает соединение и авторизует пользователя, true - вход успешен
+	bool login(				FakeSocket& ws, 
+							const std::string& username, 
+							const std::string& password);
+
+	// Выполняет задачи цикла до пустой очереди
+	size_t run();
+
+};
+
+
+// Добавляет пользователя с хешем Argon2id текущих параметров
+void addUser(				FakeStorage& storage, 
+							const std::string& login, 
+							const std::string& password, 
+							bool admin);
+
+// Разбирает сообщения, отправленные соединению
+std::vector<nlohmann::json> received(const FakeSocket& ws);
+
+#endif // !TESTLOOP_H
@@ -0,0 +1,95 @@
+#include <vector>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "TimerWheel.h"
+
+
+struct TestTimer
+{
+	uint64_t	due	= 0;
+	int			id	= 0;
+};
+
+// Продвигает колесо и возвращает номера сработавших записей
+static std::vector<int> advance(TimerWheel<TestTimer>& wheel,
+								uint64_t nowMs)
+{
+	std::vector<TestTimer> due;
+	wheel.advance(nowMs, due);
+
+	std::vector<int> ids;
+	for (const TestTimer& timer : due)
+	{
+		ids.push_back(timer.id);
+	}
+
+	return ids;
+}
+
+
+// Запись срабатывает на тике, которым заканчивается её срок, и не раньше
+TEST(TimerWheelTest, FiresAtDue)
+{
+	TimerWheel<TestTimer> wheel(10, 1000);
+	wheel.add({ 1055, 1 });
+
+	EXPECT_TRUE(advance(wheel, 1050).empty());
+	EXPECT_EQ(advance(wheel, 1060), std::vector<int>{ 1 });
+	EXPECT_EQ(wheel.size(), 0U);
+}
+
+// Срок в прошлом срабатывает на следующем тике
+TEST(TimerWheelTest, PastDueFiresOnNextTick)
+{
+	TimerWheel<TestTimer> wheel(10, 1000);
+	wheel.add({ 500, 1 });
+
+	EXPECT_TRUE(advance(wheel, 1009).empty());
+	EXPECT_EQ(advance(wheel, 1010), std::vector<int>{ 1 });
+}
+
+// Записи верхних уровней переносятся вниз и срабатывают точно в срок, в том числе с невыровненного начала
+TEST(TimerWheelTest, CascadeKeepsDue)
+{
+	for (uint64_t start : { 0ULL, 100ULL, 4000ULL })
+	{
+		TimerWheel<TestTimer> wheel(1, start);
+		std::vector<uint64_t> deltas{ 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 524293 };
+		for (size_t index = 0; index < deltas.size(); ++index)
+		{
+			wheel.add({ start + deltas[index], static_cast<int>(index) });
+		}
+
+		for (size_t index = 0; index < deltas.size(); ++index)
+		{
+			EXPECT_TRUE(advance(wheel, start + deltas[index] - 1).empty()) << "start " << start << ", delta " << deltas[index];
+			EXPECT_EQ(advance(wheel, start + deltas[index]), std::vector<int>{ static_cast<int>(index) }) << "start " << start << ", delta " << deltas[index];
+		}
+		EXPECT_EQ(wheel.size(), 0U);
+	}
+}
+
+// Запись дальше горизонта ждёт на верхнем уровне и срабатывает в свой срок
+TEST(TimerWheelTest, BeyondHorizonIsClamped)
+{
+	constexpr uint64_t HORIZON = 1ULL << 24;
+	TimerWheel<TestTimer> wheel(1, 0);
+	wheel.add({ HORIZON + 100, 1 });
+
+	EXPECT_TRUE(advance(wheel, HORIZON + 99).empty());
+	EXPECT_EQ(wheel.size(), 1U);
+	EXPECT_EQ(advance(wheel, HORIZON + 100), std::vector<int>{ 1 });
+}
+
+// Пустое колесо перескакивает к текущему моменту, новая запись считается от него
+TEST(TimerWheelTest, EmptyWheelSkipsAhead)
+{
+	TimerWheel<TestTimer> wheel(10, 0);
+
+	EXPECT_TRUE(advance(wheel, 1000000).empty());
+	wheel.add({ 1000020, 1 });
+	EXPECT_TRUE(advance(wheel, 1000010).empty());
+	EXPECT_EQ(advance(wheel, 1000020), std::vector<int>{ 1 });
+}
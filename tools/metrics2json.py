@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# Сводит гистограммы TraderInfo (GET /metrics) в JSON и сравнивает прогон с базовым
+# Использование:
+#   metrics2json.py snapshot http://127.0.0.1:9001/metrics run.json [--since before.prom]
+#   metrics2json.py compare baseline.json run.json [--threshold 0.1]
+# compare читает и вывод traderinfo_bench --benchmark_out=run.json --benchmark_out_format=json:
+# время итерации по повторам (--benchmark_repetitions) и счётчик allocs сводятся в те же медиану, p99 и среднее
+# Источник - адрес или сохранённый текст метрик; --since вычитает метрики, снятые до нагрузки,
+# чтобы в сводку попал только прогон
+# compare завершается с кодом 1, если медиана или p99 какого-либо ряда выросли больше порога
+
+import argparse
+import json
+import re
+import sys
+import urllib.request
+
+SAMPLE = re.compile(r'^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{(.*)\})?\s+(\S+)$')
+LABEL = re.compile(r'(\w+)="((?:[^"\\]|\\.)*)"')
+QUANTILES = (0.5, 0.9, 0.99)
+TIME_UNITS = {'ns': 1e-9, 'us': 1e-6, 'ms': 1e-3, 's': 1.0}
+
+
+def read(source):
+    if source.startswith('http://') or source.startswith('https://'):
+        with urllib.request.urlopen(source) as response:
+            return response.read().decode()
+    with open(source) as file:
+        return file.read()
+
+
+# Ряды гистограмм по имени с метками: границы корзин, накопленные счётчики, сумма
+def parse(text):
+    series = {}
+    counters = {}
+    histograms = set()
+    for line in text.splitlines():
+        if line.startswith('# TYPE'):
+            parts = line.split()
+            if parts[3] == 'histogram':
+                histograms.add(parts[2])
+            continue
+        match = SAMPLE.match(line)
+        if not match:
+            continue
+
+        name, labels, value = match.group(1), match.group(3) or '', float(match.group(4))
+        pairs = [(key, val) for key, val in LABEL.findall(labels) if key != 'le']
+        key_labels = ','.join('%s="%s"' % pair for pair in pairs)
+        for suffix in ('_bucket', '_sum', '_count'):
+            base = name[:-len(suffix)]
+            if name.endswith(suffix) and base in histograms:
+                key = base + ('{' + key_labels + '}' if key_labels else '')
+                entry = series.setdefault(key, {'buckets': [], 'sum': 0.0, 'count': 0.0})
+                if suffix == '_bucket':
+                    bound = dict(LABEL.findall(labels))['le']
+                    entry['buckets'].append((float('inf') if bound == '+Inf' else float(bound), value))
+                else:
+                    entry[suffix[1:]] = value
+                break
+        else:
+            counters[name + ('{' + key_labels + '}' if key_labels else '')] = value
+
+    return series, counters
+
+
+# Квантиль по накопленным корзинам с линейной интерполяцией внутри корзины
+def quantile(buckets, count, q):
+    if count <= 0:
+        return 0.0
+
+    rank = q * count
+    lower, previous = 0.0, 0.0
+    for bound, cumulative in buckets:
+        if cumulative >= rank:
+            if bound == float('inf'):
+                return lower
+            share = (rank - previous) / (cumulative - previous) if cumulative > previous else 1.0
+            return lower + (bound - lower) * share
+        lower, previous = bound, cumulative
+
+    return lower
+
+
+def snapshot(args):
+    series, counters = parse(read(args.source))
+    if args.since:
+        before, before_counters = parse(read(args.since))
+        for key, entry in series.items():
+            old = before.get(key)
+            if old:
+                entry['buckets'] = [(bound, value - old_value) for (bound, value), (_, old_value) in zip(entry['buckets'], old['buckets'])]
+                entry['sum'] -= old['sum']
+                entry['count'] -= old['count']
+        for key in counters:
+            counters[key] -= before_counters.get(key, 0.0)
+
+    result = {'histograms': {}, 'counters': counters}
+    for key, entry in sorted(series.items()):
+        count = entry['count']
+        summary = {'count': count, 'sum': entry['sum'], 'mean': entry['sum'] / count if count else 0.0}
+        for q in QUANTILES:
+            summary['p%g' % (q * 100)] = quantile(entry['buckets'], count, q)
+        result['histograms'][key] = summary
+
+    with open(args.target, 'w') as file:
+        json.dump(result, file, indent=2, sort_keys=True)
+
+    print('%d histogram(s) written to %s' % (len(result['histograms']), args.target))
+
+
+# Повторы замеров Google Benchmark: время итерации в секундах и обращения к распределителю на итерацию
+def benchmarks(rows):
+    samples = {}
+    for row in rows:
+        if row.get('run_type', 'iteration') != 'iteration' or row.get('error_occurred'):
+            continue
+        name = row.get('run_name', row['name'])
+        samples.setdefault(name, []).append(row['real_time'] * TIME_UNITS[row.get('time_unit', 'ns')])
+        if 'allocs' in row:
+            samples.setdefault(name + ':allocs', []).append(row['allocs'])
+
+    result = {}
+    for key, values in sorted(samples.items()):
+        values.sort()
+        count = len(values)
+        summary = {'count': count, 'sum': sum(values), 'mean': sum(values) / count}
+        for q in QUANTILES:
+            summary['p%g' % (q * 100)] = values[min(count - 1, int(q * count))]
+        result[key] = summary
+
+    return result
+
+
+# Сводка прогона из snapshot или из вывода Google Benchmark
+def load(path):
+    with open(path) as file:
+        data = json.load(file)
+
+    return benchmarks(data['benchmarks']) if 'benchmarks' in data else data['histograms']
+
+
+def compare(args):
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    print('%-60s %8s %12s %12s %8s' % ('series', 'stat', 'baseline', 'current', 'change'))
+    for key in sorted(set(baseline) & set(current)):
+        if not baseline[key]['count'] or not current[key]['count']:
+            continue
+        for stat in ('p50', 'p99', 'mean'):
+            old, new = baseline[key][stat], current[key][stat]
+            change = (new - old) / old if old else (float('inf') if new > old else 0.0)
+            regressed = stat != 'mean' and change > args.threshold
+            regressions += regressed
+            print('%-60s %8s %12.6g %12.6g %+7.1f%%%s' % (key, stat, old, new, change * 100, '  REGRESSION' if regressed else ''))
+
+    if regressions:
+        sys.exit('%d regression(s) above %.0f%%' % (regressions, args.threshold * 100))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='TraderInfo metrics summary and comparison')
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    parser_snapshot = commands.add_parser('snapshot')
+    parser_snapshot.add_argument('source')
+    parser_snapshot.add_argument('target')
+    parser_snapshot.add_argument('--since')
+    parser_snapshot.set_defaults(handler=snapshot)
+
+    parser_compare = commands.add_parser('compare')
+    parser_compare.add_argument('baseline')
+    parser_compare.add_argument('current')
+    parser_compare.add_argument('--threshold', type=float, default=0.1)
+    parser_compare.set_defaults(handler=compare)
+
+    args = parser.parse_args()
+    args.handler(args)
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Переводит двоичную трассу TraderInfo (TraceSettings::FILE) в формат Chrome trace / Perfetto
+# Использование: trace2chrome.py trace.bin trace.json
+# Полученный файл открывается в chrome://tracing или https://ui.perfetto.dev
+
+import json
+import struct
+import sys
+
+HEADER = struct.Struct('<8sdQQ')    # TraceHeader
+EVENT = struct.Struct('<QQIHH')     # TraceEvent: tsc, connection, arg, type, thread
+
+# Порядок совпадает с enum Metrics::Histogram
+SPANS = [
+    'argon2', 'broadcast', 'redis hCheck', 'redis hSet', 'redis hDel', 'redis hGet',
+    'redis hGetAll', 'redis sCheck', 'buffered bytes', 'redis xAdd', 'redis xRange',
+    'redis hIncrBy', 'redis hBatch', 'arena bytes', 'message allocations', 'pong rtt',
+    'dispatch', 'snapshot',
+]
+
+# Тип события: (фаза, имя); фаза B/E - начало и конец интервала, i - мгновенное событие
+EVENTS = {
+    1: ('i', 'open'),
+    2: ('i', 'close'),
+    3: ('B', 'message'),
+    4: ('E', 'message'),
+    5: ('B', 'auth'),
+    6: ('E', 'auth'),
+    7: ('B', None),
+    8: ('E', None),
+    9: ('i', 'publish'),
+    10: ('i', 'send'),
+    11: ('i', 'drain'),
+}
+
+
+def convert(source, target):
+    with open(source, 'rb') as file:
+        data = file.read()
+
+    magic, ticks_per_us, base_tsc, event_size = HEADER.unpack_from(data, 0)
+    if magic != b'TITRACE1' or event_size != EVENT.size:
+        sys.exit('Unknown trace format: ' + source)
+
+    events = []
+    for offset in range(HEADER.size, len(data) - EVENT.size + 1, EVENT.size):
+        tsc, connection, arg, kind, thread = EVENT.unpack_from(data, offset)
+        if kind not in EVENTS:
+            continue
+
+        phase, name = EVENTS[kind]
+        if name is None:
+            name = SPANS[arg] if arg < len(SPANS) else 'span %d' % arg
+        event = {
+            'name': name,
+            'ph': phase,
+            'ts': (tsc - base_tsc) / ticks_per_us,
+            'pid': 1,
+            'tid': thread,
+            'args': {'connection': connection},
+        }
+        if phase == 'i':
+            event['s'] = 't'
+            event['args']['arg'] = arg
+        elif kind == 6:
+            event['args']['success'] = bool(arg)
+        events.append(event)
+
+    # Потоки сбрасываются по очереди, поэтому события упорядочиваются по времени
+    events.sort(key=lambda item: item['ts'])
+    with open(target, 'w') as file:
+        json.dump({'traceEvents': events, 'displayTimeUnit': 'ms'}, file)
+
+    print('%d event(s) written to %s' % (len(events), target))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit('Usage: trace2chrome.py trace.bin trace.json')
+    convert(sys.argv[1], sys.argv[2])